@@ -24,13 +24,54 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include "JlCompress.h"
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QBuffer>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QSemaphore>
+#include <QtCore/QTemporaryFile>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+#include <algorithm>
 #include <memory>
+#include <vector>
 
-bool JlCompress::copyData(QIODevice &inFile, QIODevice &outFile)
+namespace {
+
+const qint64 COPY_BUFFER_MIN_SIZE = 256 * 1024;
+const qint64 COPY_BUFFER_MAX_SIZE = 4 * 1024 * 1024;
+/// Gathers the headers and the data of small files into large writes.
+const int ARCHIVE_WRITE_BUFFER_SIZE = 1024 * 1024;
+/// Reads the archive in large pieces when extracting everything in order.
+const int ARCHIVE_READ_AHEAD_SIZE = 1024 * 1024;
+
+/// The copy buffer size for \a dataSize bytes, unless \a bufferSize is set.
+qint64 copyBufferSize(qint64 dataSize, qint64 bufferSize)
 {
+    if (bufferSize > 0)
+        return bufferSize;
+    // about 8 reads per file, but no more than the file needs
+    const qint64 size = std::min(std::max(dataSize / 8, COPY_BUFFER_MIN_SIZE),
+                                 COPY_BUFFER_MAX_SIZE);
+    return dataSize > 0 ? std::min(size, dataSize) : COPY_BUFFER_MIN_SIZE;
+}
+
+/// JlCompress::copyData() with a buffer of \a bufferSize, see copyBufferSize().
+bool copyData(QIODevice &inFile, QIODevice &outFile, qint64 bufferSize)
+{
+    bufferSize = copyBufferSize(inFile.isSequential() && !qobject_cast<QuaZipFile*>(&inFile)
+                                    ? 0 : inFile.size(), bufferSize);
+    // one buffer per thread, reused for every file it copies
+    thread_local QByteArray cachedBuffer;
+    QByteArray ownBuffer;
+    QByteArray &buffer = bufferSize <= COPY_BUFFER_MAX_SIZE ? cachedBuffer : ownBuffer;
+    if (buffer.size() < bufferSize)
+        buffer.resize(bufferSize);
+    char *buf = buffer.data();
     while (!inFile.atEnd()) {
-        char buf[4096];
-        qint64 readLen = inFile.read(buf, 4096);
+        qint64 readLen = inFile.read(buf, bufferSize);
         if (readLen <= 0)
             return false;
         if (outFile.write(buf, readLen) != readLen)
@@ -39,6 +80,13 @@ bool JlCompress::copyData(QIODevice &inFile, QIODevice &outFile)
     return true;
 }
 
+} // namespace
+
+bool JlCompress::copyData(QIODevice &inFile, QIODevice &outFile)
+{
+    return ::copyData(inFile, outFile, 0);
+}
+
 bool JlCompress::compressFile(QuaZip* zip, QString fileName, QString fileDest) {
   return compressFile(zip, fileName, fileDest, Options());
 }
@@ -74,7 +122,11 @@ bool JlCompress::compressFile(QuaZip* zip, QString fileName, QString fileDest, c
         inFile.setFileName(fileName);
         if (!inFile.open(QIODevice::ReadOnly))
             return false;
-        if (!copyData(inFile, outFile) || outFile.getZipError()!=UNZ_OK)
+        // stored files may be copied by the kernel
+        const bool copied = options.getCompressionMethod() == 0
+            ? outFile.copyFrom(&inFile)
+            : ::copyData(inFile, outFile, options.getBufferSize());
+        if (!copied || outFile.getZipError()!=UNZ_OK)
             return false;
         inFile.close();
     }
@@ -145,28 +197,29 @@ bool JlCompress::compressSubDir(QuaZip* zip, QString dir, QString origDir, bool
     return true;
 }
 
-bool JlCompress::extractFile(QuaZip* zip, QString fileName, QString fileDest) {
-    // zip: object where to add the file
-    // filename: real file name
-    // fileincompress: file name of the compressed file
-
-    if (!zip) return false;
-    if (zip->getMode()!=QuaZip::mdUnzip) return false;
+namespace {
 
-    if (!fileName.isEmpty())
-        zip->setCurrentFile(fileName);
+/// Extracts the current file of \a zip to \a fileDest.
+/**
+  The directory it goes to is created first if \a makePath is set,
+  otherwise it must already exist.
+  */
+bool extractCurrentFile(QuaZip *zip, const QString &fileDest, bool makePath)
+{
     QuaZipFile inFile(zip);
     if(!inFile.open(QIODevice::ReadOnly) || inFile.getZipError()!=UNZ_OK) return false;
 
     // Check existence of resulting file
-    QDir curDir;
-    if (fileDest.endsWith(QLatin1String("/"))) {
-        if (!curDir.mkpath(fileDest)) {
-            return false;
-        }
-    } else {
-        if (!curDir.mkpath(QFileInfo(fileDest).absolutePath())) {
-            return false;
+    if (makePath) {
+        QDir curDir;
+        if (fileDest.endsWith(QLatin1String("/"))) {
+            if (!curDir.mkpath(fileDest)) {
+                return false;
+            }
+        } else {
+            if (!curDir.mkpath(QFileInfo(fileDest).absolutePath())) {
+                return false;
+            }
         }
     }
 
@@ -192,10 +245,11 @@ bool JlCompress::extractFile(QuaZip* zip, QString fileName, QString fileDest) {
     outFile.setFileName(fileDest);
     if(!outFile.open(QIODevice::WriteOnly)) return false;
 
-    // Copy data
-    if (!copyData(inFile, outFile) || inFile.getZipError()!=UNZ_OK) {
+    // Copy data, stored files possibly from the mapping or in the kernel
+    const bool copied = info.method == 0 ? inFile.copyTo(&outFile) : copyData(inFile, outFile, 0);
+    if (!copied || inFile.getZipError()!=UNZ_OK) {
         outFile.close();
-        removeFile(QStringList(fileDest));
+        JlCompress::removeFile(QStringList(fileDest));
         return false;
     }
     outFile.close();
@@ -203,7 +257,7 @@ bool JlCompress::extractFile(QuaZip* zip, QString fileName, QString fileDest) {
     // Close file
     inFile.close();
     if (inFile.getZipError()!=UNZ_OK) {
-        removeFile(QStringList(fileDest));
+        JlCompress::removeFile(QStringList(fileDest));
         return false;
     }
 
@@ -213,6 +267,21 @@ bool JlCompress::extractFile(QuaZip* zip, QString fileName, QString fileDest) {
     return true;
 }
 
+} // namespace
+
+bool JlCompress::extractFile(QuaZip* zip, QString fileName, QString fileDest) {
+    // zip: object where to add the file
+    // filename: real file name
+    // fileincompress: file name of the compressed file
+
+    if (!zip) return false;
+    if (zip->getMode()!=QuaZip::mdUnzip) return false;
+
+    if (!fileName.isEmpty())
+        zip->setCurrentFile(fileName);
+    return extractCurrentFile(zip, fileDest, true);
+}
+
 bool JlCompress::removeFile(QStringList listFile) {
     bool ret = true;
     // For each file
@@ -230,6 +299,7 @@ bool JlCompress::compressFile(QString fileCompressed, QString file) {
 bool JlCompress::compressFile(QString fileCompressed, QString file, const Options& options) {
     // Create zip
     QuaZip zip(fileCompressed);
+    zip.setWriteBufferSize(ARCHIVE_WRITE_BUFFER_SIZE);
     QDir().mkpath(QFileInfo(fileCompressed).absolutePath());
     if(!zip.open(QuaZip::mdCreate)) {
         QFile::remove(fileCompressed);
@@ -259,6 +329,8 @@ bool JlCompress::compressFiles(QString fileCompressed, QStringList files) {
 bool JlCompress::compressFiles(QString fileCompressed, QStringList files, const Options& options) {
   // Create zip
   QuaZip zip(fileCompressed);
+  zip.setWriteBufferSize(ARCHIVE_WRITE_BUFFER_SIZE);
+  zip.setExpectedEntryCount(files.size());
   QDir().mkpath(QFileInfo(fileCompressed).absolutePath());
   if(!zip.open(QuaZip::mdCreate)) {
     QFile::remove(fileCompressed);
@@ -286,6 +358,214 @@ bool JlCompress::compressFiles(QString fileCompressed, QStringList files, const
   return true;
 }
 
+namespace {
+
+/// An entry of a directory being compressed, in the archive order.
+struct DirEntry {
+    QString fileName;
+    QString fileDest;
+    bool isDir;
+};
+
+/// Lists what JlCompress::compressSubDir() would add, in the same order.
+bool listSubDir(QList<DirEntry> &entries, const QString &zipName, const QString &dir,
+                const QString &origDir, bool recursive, QDir::Filters filters)
+{
+    QDir directory(dir);
+    if (!directory.exists()) return false;
+
+    QDir origDirectory(origDir);
+    if (dir != origDir)
+        entries.append(DirEntry{dir, origDirectory.relativeFilePath(dir) + QLatin1String("/"), true});
+
+    if (recursive) {
+        QFileInfoList files = directory.entryInfoList(QDir::AllDirs|QDir::NoDotAndDotDot|filters);
+        for (const auto& file : files) {
+            if (!file.isDir())
+                continue;
+            if (!listSubDir(entries, zipName, file.absoluteFilePath(), origDir, recursive, filters))
+                return false;
+        }
+    }
+
+    QFileInfoList files = directory.entryInfoList(QDir::Files|filters);
+    for (const auto& file : files) {
+        if(!file.isFile()||file.absoluteFilePath()==zipName) continue;
+        entries.append(DirEntry{file.absoluteFilePath(),
+                                origDirectory.relativeFilePath(file.absoluteFilePath()), false});
+    }
+    return true;
+}
+
+/// A file compressed by a worker, waiting to be copied to the archive.
+struct CompressedEntry {
+    /// A whole one-file archive, in memory or in a temporary file.
+    std::unique_ptr<QIODevice> device;
+    /// How much of the memory budget the device holds, in KiB.
+    int reserved = 0;
+    bool ok = false;
+    bool finished = false;
+};
+
+/// Files larger than this are compressed to a temporary file, not to memory.
+const qint64 COMPRESS_SPILL_SIZE = 16 * 1024 * 1024;
+/// How much all the files compressed to memory may take at once, in KiB.
+/** A file that doesn't fit goes to a temporary file too, however many
+    threads there are. */
+const int COMPRESS_MEMORY_BUDGET = 64 * 1024;
+
+/// The part of the memory budget a file of \a size bytes compresses to, at worst.
+int compressedReserve(qint64 size)
+{
+    // stored blocks and the headers of the one-file archive
+    return static_cast<int>((size + size / 64 + 4096 + 1023) / 1024);
+}
+
+QuaZipNewInfo newInfo(const DirEntry &entry, const JlCompress::Options &options)
+{
+    return options.getDateTime().isNull()
+            ? QuaZipNewInfo(entry.fileDest, entry.fileName)
+            : QuaZipNewInfo(entry.fileDest, entry.fileName, options.getDateTime());
+}
+
+/// Copies the only file in \a device to \a zip without recompressing it.
+/**
+  \a level only goes to the flags of the entry, as it would if the file
+  were compressed straight into \a zip.
+  */
+bool copyCompressed(QuaZip *zip, QIODevice *device, QuaZipNewInfo info, int level)
+{
+    QuaZip compressed(device);
+    if (!compressed.open(QuaZip::mdUnzip) || !compressed.goToFirstFile())
+        return false;
+    QuaZipFileInfo64 compressedInfo;
+    if (!compressed.getCurrentFileInfo(&compressedInfo))
+        return false;
+    int method;
+    QuaZipFile inFile(&compressed);
+    if (!inFile.open(QIODevice::ReadOnly, &method, nullptr, true))
+        return false;
+    info.uncompressedSize = compressedInfo.uncompressedSize;
+    // the text flag, which deflate sets only when it compresses
+    info.internalAttr = compressedInfo.internalAttr;
+    QuaZipFile outFile(zip);
+    if (!outFile.open(QIODevice::WriteOnly, info, nullptr, compressedInfo.crc, method, level, true))
+        return false;
+    if (!JlCompress::copyData(inFile, outFile) || inFile.getZipError() != UNZ_OK
+            || outFile.getZipError() != UNZ_OK)
+        return false;
+    outFile.close();
+    if (outFile.getZipError() != UNZ_OK)
+        return false;
+    inFile.close();
+    compressed.close();
+    return inFile.getZipError() == UNZ_OK;
+}
+
+/// compressSubDir() for the whole directory, compressing in several threads.
+/**
+  The workers compress every file into a one-file archive of its own, in
+  memory or in a temporary file, and the calling thread copies the
+  compressed data in the archive order to \a zip, raw, so that the
+  result is the same as if the files were compressed one by one.
+  */
+bool compressDirThreaded(QuaZip *zip, const QString &dir, bool recursive,
+                         QDir::Filters filters, const JlCompress::Options &options,
+                         int threadCount)
+{
+    QList<DirEntry> entries;
+    if (!listSubDir(entries, zip->getZipName(), dir, dir, recursive, filters))
+        return false;
+    std::vector<CompressedEntry> compressed(entries.size());
+    QMutex mutex;
+    QWaitCondition finished;
+    // limits how far ahead of the writer the workers can get
+    QSemaphore ahead(threadCount * 4);
+    // limits how much the entries waiting for the writer hold in memory;
+    // never waited for, since the writer may be waiting for this very entry
+    QSemaphore memory(COMPRESS_MEMORY_BUDGET);
+    QAtomicInteger<int> next(0);
+    QAtomicInteger<int> cancelled(0);
+    QThread *writerThread = QThread::currentThread();
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    for (int i = 0; i < threadCount; ++i) {
+        pool.start(QRunnable::create([&]() {
+            for (;;) {
+                ahead.acquire();
+                const int j = next.fetchAndAddRelaxed(1);
+                if (j >= entries.size() || cancelled.loadRelaxed()) {
+                    ahead.release();
+                    return;
+                }
+                const DirEntry &entry = entries.at(j);
+                std::unique_ptr<QIODevice> device;
+                int reserved = 0;
+                bool ok = true;
+                if (!entry.isDir) {
+                    const qint64 size = QFileInfo(entry.fileName).size();
+                    if (size <= COMPRESS_SPILL_SIZE
+                            && memory.tryAcquire(compressedReserve(size))) {
+                        reserved = compressedReserve(size);
+                        device.reset(new QBuffer());
+                    } else {
+                        device.reset(new QTemporaryFile());
+                    }
+                    QuaZip single(device.get());
+                    // the temporary archive itself is thrown away
+                    single.setZip64Enabled(true);
+                    ok = single.open(QuaZip::mdCreate)
+                            && JlCompress::compressFile(&single, entry.fileName, entry.fileDest, options);
+                    single.close();
+                    ok = ok && single.getZipError() == ZIP_OK;
+                    device->moveToThread(writerThread);
+                }
+                QMutexLocker locker(&mutex);
+                compressed[j].device = std::move(device);
+                compressed[j].reserved = reserved;
+                compressed[j].ok = ok;
+                compressed[j].finished = true;
+                finished.wakeAll();
+            }
+        }));
+    }
+    bool ok = true;
+    for (int j = 0; ok && j < entries.size(); ++j) {
+        std::unique_ptr<QIODevice> device;
+        int reserved;
+        {
+            QMutexLocker locker(&mutex);
+            while (!compressed[j].finished)
+                finished.wait(&mutex);
+            ok = compressed[j].ok;
+            device = std::move(compressed[j].device);
+            reserved = compressed[j].reserved;
+        }
+        const DirEntry &entry = entries.at(j);
+        if (ok && entry.isDir) {
+            QuaZipFile dirZipFile(zip);
+            ok = dirZipFile.open(QIODevice::WriteOnly, newInfo(entry, options), nullptr, 0, 0);
+            if (ok)
+                dirZipFile.close();
+        } else if (ok) {
+            ok = copyCompressed(zip, device.get(), newInfo(entry, options),
+                                options.getCompressionLevel());
+        }
+        device.reset();
+        memory.release(reserved);
+        ahead.release();
+    }
+    if (!ok) {
+        cancelled.storeRelaxed(1);
+        // wake up the workers waiting for the writer
+        ahead.release(threadCount);
+    }
+    pool.waitForDone();
+    return ok;
+}
+
+} // namespace
+
 bool JlCompress::compressDir(QString fileCompressed, QString dir, bool recursive) {
     return compressDir(fileCompressed, dir, recursive, QDir::Filters());
 }
@@ -301,14 +581,21 @@ bool JlCompress::compressDir(QString fileCompressed, QString dir,
 {
   // Create zip
   QuaZip zip(fileCompressed);
+  zip.setWriteBufferSize(ARCHIVE_WRITE_BUFFER_SIZE);
   QDir().mkpath(QFileInfo(fileCompressed).absolutePath());
   if(!zip.open(QuaZip::mdCreate)) {
     QFile::remove(fileCompressed);
     return false;
   }
 
+  int threadCount = options.getThreadCount();
+  if (threadCount <= 0)
+    threadCount = QThread::idealThreadCount();
+
   // Add the files and subdirectories
-  if (!compressSubDir(&zip,dir,dir,recursive, filters, options)) {
+  if (threadCount > 1
+          ? !compressDirThreaded(&zip, dir, recursive, filters, options, threadCount)
+          : !compressSubDir(&zip,dir,dir,recursive, filters, options)) {
     QFile::remove(fileCompressed);
     return false;
   }
@@ -387,6 +674,8 @@ QStringList JlCompress::extractFiles(QuaZip &zip, const QStringList &files, cons
 QStringList JlCompress::extractDir(QString fileCompressed, QString dir) {
     // Open zip
     QuaZip zip(fileCompressed);
+    zip.setReadAheadSize(ARCHIVE_READ_AHEAD_SIZE);
+    zip.setPrefetchEnabled(true);
     return extractDir(zip, dir);
 }
 
@@ -468,6 +757,148 @@ QStringList JlCompress::extractDir(QIODevice* ioDevice, QString dir)
     return extractDir(zip, dir);
 }
 
+QStringList JlCompress::extractDir(QString fileCompressed, QString dir, const Options& options)
+{
+    QuaZip zip(fileCompressed);
+    zip.setReadAheadSize(ARCHIVE_READ_AHEAD_SIZE);
+    zip.setPrefetchEnabled(true);
+    return extractDir(zip, dir, options);
+}
+
+QStringList JlCompress::extractDir(QIODevice* ioDevice, QString dir, const Options& options)
+{
+    QuaZip zip(ioDevice);
+    return extractDir(zip, dir, options);
+}
+
+QStringList JlCompress::extractDir(QuaZip &zip, const QString &dir, const Options& options)
+{
+    int threadCount = options.getThreadCount();
+    if (threadCount <= 0)
+        threadCount = QThread::idealThreadCount();
+    if (threadCount <= 1)
+        return extractDir(zip, dir);
+    // the catalog lets every thread go to its files directly
+    const bool catalogEnabled = zip.isCatalogEnabled();
+    zip.setCatalogEnabled(true);
+    const bool opened = zip.open(QuaZip::mdUnzip);
+    zip.setCatalogEnabled(catalogEnabled);
+    if (!opened)
+        return QStringList();
+    const QList<QuaZipFileInfo64> infos = zip.getFileInfoList64();
+    if (infos.isEmpty() && zip.getZipError() != UNZ_OK) {
+        zip.close();
+        return QStringList();
+    }
+    QString cleanDir = QDir::cleanPath(dir);
+    QDir directory(cleanDir);
+    QString absCleanDir = directory.absolutePath();
+    if (!absCleanDir.endsWith(QLatin1Char('/'))) // It only ends with / if it's the FS root.
+        absCleanDir += QLatin1Char('/');
+
+    struct Entry {
+        qint64 index;
+        QString path;
+        qint64 size;
+    };
+    std::vector<Entry> entries;
+    QStringList extracted;
+    // the last entry with a given path wins, as when extracting in order
+    QHash<QString, size_t> lastEntry;
+    for (int i = 0; i < infos.size(); ++i) {
+        const QuaZipFileInfo64 &info = infos.at(i);
+        if (info.isSymbolicLink()) {
+            zip.close();
+            return extractDir(zip, dir);
+        }
+        QString absFilePath = directory.absoluteFilePath(info.name);
+        QString absCleanPath = QDir::cleanPath(absFilePath);
+        if (!absCleanPath.startsWith(absCleanDir))
+            continue;
+        extracted.append(absFilePath);
+        lastEntry.insert(absFilePath, entries.size());
+        entries.push_back(Entry{i, absFilePath, static_cast<qint64>(info.uncompressedSize)});
+    }
+
+    // create the directories once, instead of in every thread for every file
+    QDir curDir;
+    std::vector<const Entry*> files, dirs;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry &entry = entries[i];
+        if (lastEntry.value(entry.path) != i)
+            continue;
+        const bool isDir = entry.path.endsWith(QLatin1Char('/'));
+        if (!curDir.mkpath(isDir ? entry.path : QFileInfo(entry.path).absolutePath())) {
+            zip.close();
+            return QStringList();
+        }
+        (isDir ? dirs : files).push_back(&entry);
+    }
+    // largest first, so that the big ones don't end up all in one thread
+    std::stable_sort(files.begin(), files.end(), [](const Entry *a, const Entry *b) {
+        return a->size > b->size;
+    });
+
+    const int workerCount = static_cast<int>(std::min<size_t>(threadCount, files.size()));
+    std::vector<std::unique_ptr<QuaZip>> handles;
+    for (int i = 0; i < workerCount; ++i) {
+        std::unique_ptr<QuaZip> handle(new QuaZip());
+        // no read-ahead: the files are taken by size, not in archive order,
+        // so a window would mostly be read for nothing
+        handle->setMemoryMappingEnabled(zip.isMemoryMappingEnabled());
+        if (!handle->openShared(zip)) {
+            handles.clear();
+            zip.close();
+            return extractDir(zip, dir);
+        }
+        handles.push_back(std::move(handle));
+    }
+    // written by the one thread that extracted the file, read after waitForDone()
+    std::vector<char> done(files.size(), 0);
+    QAtomicInteger<int> next(0);
+    QAtomicInteger<int> failed(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(workerCount);
+    for (int i = 0; i < workerCount; ++i) {
+        QuaZip *handle = handles[i].get();
+        pool.start(QRunnable::create([handle, &files, &done, &next, &failed]() {
+            for (int j = next.fetchAndAddRelaxed(1);
+                    j < static_cast<int>(files.size()) && !failed.loadRelaxed();
+                    j = next.fetchAndAddRelaxed(1)) {
+                const Entry *entry = files[j];
+                // the directories are all there already
+                if (!handle->setCurrentFileIndex(entry->index)
+                        || !extractCurrentFile(handle, entry->path, false)) {
+                    failed.storeRelaxed(1);
+                    return;
+                }
+                done[j] = 1;
+            }
+        }));
+    }
+    pool.waitForDone();
+    handles.clear();
+    // now that the files are there, set the permissions of the directories
+    bool ok = !failed.loadRelaxed();
+    for (size_t i = 0; ok && i < dirs.size(); ++i) {
+        ok = zip.setCurrentFileIndex(dirs[i]->index)
+                && extractFile(&zip, QString(), dirs[i]->path);
+    }
+
+    zip.close();
+    if (!ok || zip.getZipError() != 0) {
+        QStringList written;
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (done[i])
+                written.append(files[i]->path);
+        }
+        removeFile(written);
+        return QStringList();
+    }
+
+    return extracted;
+}
+
 QStringList JlCompress::getFileList(QIODevice *ioDevice)
 {
     QuaZip *zip = new QuaZip(ioDevice);
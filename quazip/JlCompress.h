@@ -78,10 +78,11 @@ public:
 
     public:
       	explicit Options(const CompressionStrategy& strategy)
-          : m_compressionStrategy(strategy) {}
+          : m_compressionStrategy(strategy), m_threadCount(1), m_bufferSize(0) {}
 
         explicit Options(const QDateTime& dateTime = QDateTime(), const CompressionStrategy& strategy = Default)
-            : m_dateTime(dateTime), m_compressionStrategy(strategy) {}
+            : m_dateTime(dateTime), m_compressionStrategy(strategy), m_threadCount(1),
+              m_bufferSize(0) {}
 
         QDateTime getDateTime() const {
             return m_dateTime;
@@ -107,15 +108,69 @@ public:
             m_compressionStrategy = strategy;
         }
 
+        /// Returns the number of threads to use, see setThreadCount().
+        int getThreadCount() const {
+            return m_threadCount;
+        }
+
+        /// Sets the number of threads to use.
+        /**
+          1 (the default) means everything is done in the calling thread,
+          0 or less means QThread::idealThreadCount().
+          */
+        void setThreadCount(int threadCount) {
+            m_threadCount = threadCount;
+        }
+
+        /// Returns the size of the buffer to copy the data with, see setBufferSize().
+        int getBufferSize() const {
+            return m_bufferSize;
+        }
+
+        /// Sets the size of the buffer to copy the data of each file with.
+        /**
+          0 or less (the default) means that it is chosen from the size of
+          the file, from 256 KiB to 4 MiB. When extracting, it is always
+          chosen this way. Stored files are copied with QuaZipFile::copyTo()
+          and QuaZipFile::copyFrom() instead, which may leave it to the
+          kernel.
+          */
+        void setBufferSize(int bufferSize) {
+            m_bufferSize = bufferSize;
+        }
+
     private:
         // If set, used as last modified on file inside the archive.
         // If compressing a directory, used for all files.
         QDateTime m_dateTime;
         CompressionStrategy m_compressionStrategy;
+        // The number of worker threads, 1 for none, 0 or less for the ideal count.
+        int m_threadCount;
+        // The copy buffer size, 0 or less to choose it from the file size.
+        int m_bufferSize;
     };
 
     static bool copyData(QIODevice &inFile, QIODevice &outFile);
     static QStringList extractDir(QuaZip &zip, const QString &dir);
+    /// Extract a whole archive using several threads.
+    /**
+      Same as extractDir(QuaZip&, const QString&), but the files are
+      extracted by options.getThreadCount() threads, each reading the
+      archive through its own QuaZip::openShared() handle. Directories are
+      created before any file is extracted, and the files are handed to the
+      threads largest first, so that one huge file doesn't end up being
+      extracted last. The returned list is in the archive order, exactly as
+      it is when extracting in one thread.
+
+      Archives containing symbolic links are extracted in one thread,
+      because a link may redirect the entries that follow it.
+
+      \param zip The archive, not open yet.
+      \param dir The directory to extract to.
+      \param options The options, only the thread count is used.
+      \return The list of the full paths of the files extracted, empty on failure.
+      */
+    static QStringList extractDir(QuaZip &zip, const QString &dir, const Options& options);
     static QStringList getFileList(QuaZip *zip);
     static QString extractFile(QuaZip &zip, QString fileName, QString fileDest);
     static QStringList extractFiles(QuaZip &zip, const QStringList &files, const QString &dir);
@@ -246,6 +301,12 @@ public:
      * <tt>%QDir::AllDirs|%QDir::NoDotAndDotDot</tt> when searching for dirs
      * and with <tt>QDir::Files</tt> when searching for files.
      *
+     * If the options specify more than one thread, the files are
+     * compressed by that many threads at once, each to memory (or to a
+     * temporary file if it's large, or if the files waiting to be copied
+     * already take 64 MiB of memory), and copied to the archive as is
+     * by the calling thread, in the same order as with one thread.
+     *
      * @param fileCompressed path to the resulting archive
      * @param dir path to the directory being compressed
      * @param recursive if true, then the subdirectories are packed as well
@@ -283,6 +344,16 @@ public:
       \return The list of the full paths of the files extracted, empty on failure.
       */
     static QStringList extractDir(QString fileCompressed, QString dir = QString());
+    /// Extract a whole archive using several threads.
+    /**
+      \param fileCompressed The name of the archive.
+      \param dir The directory to extract to, the current directory if
+      left empty.
+      \param options The options, only the thread count is used, see
+      extractDir(QuaZip&, const QString&, const Options&).
+      \return The list of the full paths of the files extracted, empty on failure.
+      */
+    static QStringList extractDir(QString fileCompressed, QString dir, const Options& options);
     /// Get the file list.
     /**
       \return The list of the files in the archive, or, more precisely, the
@@ -316,6 +387,16 @@ public:
       \return The list of the full paths of the files extracted, empty on failure.
       */
     static QStringList extractDir(QIODevice *ioDevice, QString dir = QString());
+    /// Extract a whole archive using several threads.
+    /**
+      \param ioDevice pointer to device with compressed data.
+      \param dir The directory to extract to, the current directory if
+      left empty.
+      \param options The options, only the thread count is used, see
+      extractDir(QuaZip&, const QString&, const Options&).
+      \return The list of the full paths of the files extracted, empty on failure.
+      */
+    static QStringList extractDir(QIODevice *ioDevice, QString dir, const Options& options);
     /// Get the file list.
     /**
       \return The list of the files in the archive, or, more precisely, the
@@ -167,6 +167,35 @@ typedef struct zlib_filefunc64_def_s
 
 void fill_qiodevice64_filefunc OF((zlib_filefunc64_def* pzlib_filefunc_def));
 void fill_qiodevice_filefunc OF((zlib_filefunc_def* pzlib_filefunc_def));
+/* Read-only functions that map the whole file into memory if the device is
+   a QFileDevice, so that reads don't go through the device. */
+void fill_qiodevice64_mapped_filefunc OF((zlib_filefunc64_def* pzlib_filefunc_def));
+/* Read-only functions that read at an offset with pread() instead of
+   seeking the device, so that several zipfiles opened on the same device
+   can be read from different threads. */
+void fill_qiodevice64_positional_filefunc OF((zlib_filefunc64_def* pzlib_filefunc_def));
+
+/* Positional read functions that read window_size bytes at once and serve
+   the smaller reads from that window. If prefetch is non-zero and the
+   device has a native handle, the next window is read by a background
+   thread while the current one is used. */
+void fill_qiodevice64_readahead_filefunc OF((zlib_filefunc64_def* pzlib_filefunc_def, int window_size, int prefetch));
+
+/* Functions that gather small writes into a buffer of buffer_size bytes
+   and write it to the device in large chunks aligned to its size. Seeks
+   within the buffer, such as to patch a header written shortly before,
+   don't reach the device at all. The buffer is written out by the flush
+   function below, on seeks outside it, on reads and on close. */
+void fill_qiodevice64_buffered_filefunc OF((zlib_filefunc64_def* pzlib_filefunc_def, int buffer_size));
+
+/* Returns a pointer to the data at offset and stores the number of bytes
+   available from there in *psize, or returns NULL if the data can't be
+   accessed directly. The pointer stays valid until the file is closed. */
+typedef const void* (ZCALLBACK *view64_file_func) OF((voidpf opaque, voidpf stream, ZPOS64_T offset, ZPOS64_T* psize));
+
+/* Writes out whatever the functions have buffered, so that the stream
+   can be written to directly. Returns 0 on success. */
+typedef int (ZCALLBACK *flush64_file_func) OF((voidpf opaque, voidpf stream));
 
 /* now internal definition, only for zip.c and unzip.h */
 typedef struct zlib_filefunc64_32_def_s
@@ -175,6 +204,8 @@ typedef struct zlib_filefunc64_32_def_s
     open_file_func      zopen32_file;
     tell_file_func      ztell32_file;
     seek_file_func      zseek32_file;
+    view64_file_func    zview64_file; /* optional, may be NULL */
+    flush64_file_func   zflush64_file; /* optional, may be NULL */
 } zlib_filefunc64_32_def;
 
 voidpf   ZCALLBACK qiodevice_open_file_func      OF((voidpf opaque, voidpf file, int mode));
@@ -187,6 +218,8 @@ int      ZCALLBACK qiodevice64_seek_file_func    OF((voidpf opaque, voidpf strea
 int      ZCALLBACK qiodevice_close_file_func     OF((voidpf opaque, voidpf stream));
 int      ZCALLBACK qiodevice_fakeclose_file_func OF((voidpf opaque, voidpf stream));
 int      ZCALLBACK qiodevice_error_file_func     OF((voidpf opaque, voidpf stream));
+const void* ZCALLBACK qiodevice_mapped_view_file_func OF((voidpf opaque, voidpf stream, ZPOS64_T offset, ZPOS64_T* psize));
+int      ZCALLBACK qiodevice_buffered_flush_file_func OF((voidpf opaque, voidpf stream));
 
 #define ZREAD64(filefunc,filestream,buf,size)     ((*((filefunc).zfile_func64.zread_file))   ((filefunc).zfile_func64.opaque,filestream,buf,size))
 #define ZWRITE64(filefunc,filestream,buf,size)    ((*((filefunc).zfile_func64.zwrite_file))  ((filefunc).zfile_func64.opaque,filestream,buf,size))
@@ -195,6 +228,8 @@ int      ZCALLBACK qiodevice_error_file_func     OF((voidpf opaque, voidpf strea
 #define ZCLOSE64(filefunc,filestream)             ((*((filefunc).zfile_func64.zclose_file))  ((filefunc).zfile_func64.opaque,filestream))
 #define ZFAKECLOSE64(filefunc,filestream)             ((*((filefunc).zfile_func64.zfakeclose_file))  ((filefunc).zfile_func64.opaque,filestream))
 #define ZERROR64(filefunc,filestream)             ((*((filefunc).zfile_func64.zerror_file))  ((filefunc).zfile_func64.opaque,filestream))
+#define ZVIEW64(filefunc,filestream,offset,psize) ((*((filefunc).zview64_file))  ((filefunc).zfile_func64.opaque,filestream,offset,psize))
+#define ZFLUSH64(filefunc,filestream)             ((*((filefunc).zflush64_file))  ((filefunc).zfile_func64.opaque,filestream))
 
 voidpf call_zopen64 OF((const zlib_filefunc64_32_def* pfilefunc,voidpf file,int mode));
 int    call_zseek64 OF((const zlib_filefunc64_32_def* pfilefunc,voidpf filestream, ZPOS64_T offset, int origin));
@@ -15,9 +15,23 @@
 
 #include "ioapi.h"
 #include "quazip_global.h"
+#include <QtCore/QFileDevice>
 #include <QtCore/QIODevice>
+#include <QtCore/QMutex>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
 #include "quazip_qt_compat.h"
 
+#ifdef Q_OS_WIN
+#include <fcntl.h>
+#include <io.h>
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 /* I've found an old Unix (a SunOS 4.1.3_U1) without all SEEK_* defined.... */
 
 #ifndef SEEK_CUR
@@ -96,13 +110,13 @@ struct QIODevice_descriptor {
 };
 /// @endcond
 
-voidpf ZCALLBACK qiodevice_open_file_func (
-   voidpf opaque,
-   voidpf file,
-   int mode)
+namespace {
+
+// Opens the device in the mode requested by minizip, or checks that it is
+// already open in that mode. *pos is set to the position of a sequential
+// device already open for writing.
+bool qiodevice_open(QIODevice *iodevice, int mode, qint64 *pos)
 {
-    QIODevice_descriptor *d = reinterpret_cast<QIODevice_descriptor*>(opaque);
-    QIODevice *iodevice = reinterpret_cast<QIODevice*>(file);
     QIODevice::OpenMode desiredMode;
     if ((mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER)==ZLIB_FILEFUNC_MODE_READ)
         desiredMode = QIODevice::ReadOnly;
@@ -111,39 +125,51 @@ voidpf ZCALLBACK qiodevice_open_file_func (
     else if (mode & ZLIB_FILEFUNC_MODE_CREATE)
         desiredMode = QIODevice::WriteOnly;
     else
-        return nullptr;
+        return false;
     if (iodevice->isOpen()) {
         if ((iodevice->openMode() & desiredMode) != desiredMode) {
-            delete d;
-            return nullptr;
+            return false;
         }
         if (desiredMode != QIODevice::WriteOnly && iodevice->isSequential()) {
             // We can use sequential devices only for writing.
-            delete d;
-            return nullptr;
+            return false;
         }
         if ((desiredMode & QIODevice::WriteOnly) != 0) {
             // open for writing, need to seek existing device
             if (!iodevice->isSequential()) {
               iodevice->seek(0);
             } else {
-              d->pos = iodevice->pos();
+              *pos = iodevice->pos();
             }
         }
-        return iodevice;
+        return true;
     }
     iodevice->open(desiredMode);
     if (iodevice->isOpen()) {
         if (desiredMode != QIODevice::WriteOnly && iodevice->isSequential()) {
             // We can use sequential devices only for writing.
             iodevice->close();
-            delete d;
-            return nullptr;
+            return false;
         }
-        return iodevice;
+        return true;
     }
-    delete d;
-    return nullptr;
+    return false;
+}
+
+}
+
+voidpf ZCALLBACK qiodevice_open_file_func (
+   voidpf opaque,
+   voidpf file,
+   int mode)
+{
+    QIODevice_descriptor *d = reinterpret_cast<QIODevice_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(file);
+    if (!qiodevice_open(iodevice, mode, &d->pos)) {
+        delete d;
+        return nullptr;
+    }
+    return iodevice;
 }
 
 
@@ -339,6 +365,819 @@ void fill_qiodevice64_filefunc (
     pzlib_filefunc_def->zfakeclose_file = qiodevice_fakeclose_file_func;
 }
 
+/// @cond internal
+struct QIODevice_buffered_descriptor {
+    // The position of a sequential device, as for QIODevice_descriptor.
+    qint64 pos{0};
+    // The data not written yet, which goes at start.
+    QByteArray buffer;
+    qint64 start{0};
+    // How much is buffered, and where the next write goes in the buffer:
+    // before size after a seek back within the buffer.
+    int size{0};
+    int cursor{0};
+    // Where the buffer is written out, so that the writes are aligned.
+    int limit{0};
+};
+/// @endcond
+
+namespace {
+
+qint64 qiodevice_buffered_device_pos(QIODevice_buffered_descriptor *d,
+                                     QIODevice *iodevice)
+{
+    return iodevice->isSequential() ? d->pos : iodevice->pos();
+}
+
+// Writes the buffer out and moves the device to the buffered position.
+bool qiodevice_buffered_flush(QIODevice_buffered_descriptor *d,
+                              QIODevice *iodevice)
+{
+    if (d->size == 0)
+        return true;
+    const qint64 written = iodevice->write(d->buffer.constData(), d->size);
+    if (written > 0)
+        d->pos += written;
+    bool ok = written == d->size;
+    if (ok && d->cursor != d->size)
+        ok = iodevice->seek(d->start + d->cursor);
+    // the data is dropped on errors too, minizip fails anyway
+    d->size = d->cursor = 0;
+    return ok;
+}
+
+}
+
+uLong ZCALLBACK qiodevice_buffered_read_file_func (
+   voidpf opaque,
+   voidpf stream,
+   void* buf,
+   uLong size)
+{
+    QIODevice_buffered_descriptor *d = reinterpret_cast<QIODevice_buffered_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+    if (!qiodevice_buffered_flush(d, iodevice))
+        return static_cast<uLong>(-1);
+    const qint64 ret64 = iodevice->read(static_cast<char*>(buf), size);
+    if (ret64 != -1)
+        d->pos += ret64;
+    return static_cast<uLong>(ret64);
+}
+
+uLong ZCALLBACK qiodevice_buffered_write_file_func (
+   voidpf opaque,
+   voidpf stream,
+   const void* buf,
+   uLong size)
+{
+    QIODevice_buffered_descriptor *d = reinterpret_cast<QIODevice_buffered_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+    const char *data = static_cast<const char*>(buf);
+    const int capacity = static_cast<int>(d->buffer.size());
+    qint64 left = static_cast<qint64>(size);
+    while (left > 0) {
+        if (d->size == 0) {
+            d->start = qiodevice_buffered_device_pos(d, iodevice);
+            d->limit = capacity - static_cast<int>(d->start % capacity);
+            // nothing to gather, so write it through
+            if (left >= d->limit) {
+                const qint64 written = iodevice->write(data, left);
+                if (written > 0)
+                    d->pos += written;
+                if (written != left)
+                    return static_cast<uLong>(static_cast<qint64>(size) - left
+                                              + qMax<qint64>(written, 0));
+                return size;
+            }
+        }
+        const int chunk = static_cast<int>(qMin<qint64>(left, d->limit - d->cursor));
+        memcpy(d->buffer.data() + d->cursor, data, static_cast<size_t>(chunk));
+        d->cursor += chunk;
+        d->size = qMax(d->size, d->cursor);
+        data += chunk;
+        left -= chunk;
+        if (d->cursor == d->limit && !qiodevice_buffered_flush(d, iodevice))
+            return static_cast<uLong>(static_cast<qint64>(size) - left - chunk);
+    }
+    return size;
+}
+
+ZPOS64_T ZCALLBACK qiodevice_buffered_tell_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice_buffered_descriptor *d = reinterpret_cast<QIODevice_buffered_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+    if (d->size == 0)
+        return static_cast<ZPOS64_T>(qiodevice_buffered_device_pos(d, iodevice));
+    return static_cast<ZPOS64_T>(d->start + d->cursor);
+}
+
+int ZCALLBACK qiodevice_buffered_seek_file_func (
+   voidpf opaque,
+   voidpf stream,
+   ZPOS64_T offset,
+   int origin)
+{
+    QIODevice_buffered_descriptor *d = reinterpret_cast<QIODevice_buffered_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+    if (d->size != 0 && !iodevice->isSequential()
+            && origin != ZLIB_FILEFUNC_SEEK_END) {
+        // patching what is still buffered doesn't need the device
+        const qint64 pos = origin == ZLIB_FILEFUNC_SEEK_CUR
+                ? d->start + d->cursor + static_cast<qint64>(offset)
+                : static_cast<qint64>(offset);
+        if (pos >= d->start && pos <= d->start + d->size) {
+            d->cursor = static_cast<int>(pos - d->start);
+            return 0;
+        }
+        if (origin == ZLIB_FILEFUNC_SEEK_CUR) {
+            origin = ZLIB_FILEFUNC_SEEK_SET;
+            offset = static_cast<ZPOS64_T>(pos);
+        }
+    }
+    if (!qiodevice_buffered_flush(d, iodevice))
+        return -1;
+    return qiodevice64_seek_file_func(opaque, stream, offset, origin);
+}
+
+int ZCALLBACK qiodevice_buffered_flush_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice_buffered_descriptor *d = reinterpret_cast<QIODevice_buffered_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+    return qiodevice_buffered_flush(d, iodevice) ? 0 : -1;
+}
+
+voidpf ZCALLBACK qiodevice_buffered_open_file_func (
+   voidpf opaque,
+   voidpf file,
+   int mode)
+{
+    QIODevice_buffered_descriptor *d = reinterpret_cast<QIODevice_buffered_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(file);
+    if (!qiodevice_open(iodevice, mode, &d->pos)) {
+        delete d;
+        return nullptr;
+    }
+    return iodevice;
+}
+
+int ZCALLBACK qiodevice_buffered_close_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice_buffered_descriptor *d = reinterpret_cast<QIODevice_buffered_descriptor*>(opaque);
+    QIODevice *device = reinterpret_cast<QIODevice*>(stream);
+    const bool flushed = qiodevice_buffered_flush(d, device);
+    delete d;
+    return quazip_close(device) && flushed ? 0 : -1;
+}
+
+int ZCALLBACK qiodevice_buffered_fakeclose_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice_buffered_descriptor *d = reinterpret_cast<QIODevice_buffered_descriptor*>(opaque);
+    QIODevice *device = reinterpret_cast<QIODevice*>(stream);
+    const bool flushed = qiodevice_buffered_flush(d, device);
+    delete d;
+    return flushed ? 0 : -1;
+}
+
+void fill_qiodevice64_buffered_filefunc (
+  zlib_filefunc64_def* pzlib_filefunc_def,
+  int buffer_size)
+{
+    QIODevice_buffered_descriptor *d = new QIODevice_buffered_descriptor;
+    d->buffer.resize(qMax(buffer_size, 1));
+    pzlib_filefunc_def->zopen64_file = qiodevice_buffered_open_file_func;
+    pzlib_filefunc_def->zread_file = qiodevice_buffered_read_file_func;
+    pzlib_filefunc_def->zwrite_file = qiodevice_buffered_write_file_func;
+    pzlib_filefunc_def->ztell64_file = qiodevice_buffered_tell_file_func;
+    pzlib_filefunc_def->zseek64_file = qiodevice_buffered_seek_file_func;
+    pzlib_filefunc_def->zclose_file = qiodevice_buffered_close_file_func;
+    pzlib_filefunc_def->zerror_file = qiodevice_error_file_func;
+    pzlib_filefunc_def->opaque = d;
+    pzlib_filefunc_def->zfakeclose_file = qiodevice_buffered_fakeclose_file_func;
+}
+
+namespace {
+
+// Returns the native handle positional reads go through, or -1 if the
+// device has none. On Windows, ReadFile() at an offset still moves the
+// file pointer of a synchronous handle, such as the one QFile has, which
+// would get in the way of anyone reading the device with seek() and read().
+// So the file is opened again for overlapped reads, which don't use it.
+int qiodevice_open_handle(QFileDevice *fileDevice)
+{
+    if (fileDevice == nullptr || fileDevice->handle() == -1)
+        return -1;
+#ifdef Q_OS_WIN
+    HANDLE reopened = ReOpenFile(
+            reinterpret_cast<HANDLE>(_get_osfhandle(fileDevice->handle())),
+            GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            FILE_FLAG_OVERLAPPED);
+    if (reopened == INVALID_HANDLE_VALUE)
+        return -1;
+    const int handle = _open_osfhandle(reinterpret_cast<intptr_t>(reopened),
+                                       _O_RDONLY);
+    if (handle == -1)
+        CloseHandle(reopened);
+    return handle;
+#else
+    return fileDevice->handle();
+#endif
+}
+
+// Closes what qiodevice_open_handle() has opened.
+void qiodevice_close_handle(int handle)
+{
+#ifdef Q_OS_WIN
+    if (handle != -1)
+        _close(handle);
+#else
+    Q_UNUSED(handle);
+#endif
+}
+
+}
+
+/// @cond internal
+struct QIODevice_mapped_descriptor {
+    // The mapped file, or nullptr if it couldn't be mapped, in which case
+    // the device is read as by the positional functions, with the handle
+    // if it has one, so that it can still be read from several threads.
+    QFileDevice *file{nullptr};
+    uchar *data{nullptr};
+    qint64 size{0};
+    qint64 pos{0};
+    int handle{-1};
+    ~QIODevice_mapped_descriptor()
+    {
+        qiodevice_close_handle(handle);
+    }
+    void unmap()
+    {
+        if (data != nullptr)
+            file->unmap(data);
+        data = nullptr;
+    }
+};
+/// @endcond
+
+namespace {
+
+// Serializes seek() and read() on devices without a native handle.
+QMutex *qiodevice_positional_mutex()
+{
+    static QMutex mutex;
+    return &mutex;
+}
+
+// Reads up to size bytes at pos without touching the file position.
+qint64 qiodevice_read_at(int handle, char *buf, qint64 size, qint64 pos)
+{
+    qint64 done = 0;
+    while (done < size) {
+#ifdef Q_OS_WIN
+        // the handle is opened for overlapped reads by qiodevice_open_handle()
+        HANDLE file = reinterpret_cast<HANDLE>(_get_osfhandle(handle));
+        OVERLAPPED overlapped;
+        memset(&overlapped, 0, sizeof(overlapped));
+        overlapped.Offset = static_cast<DWORD>(pos + done);
+        overlapped.OffsetHigh = static_cast<DWORD>((pos + done) >> 32);
+        overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+        if (overlapped.hEvent == nullptr)
+            return -1;
+        DWORD chunk = static_cast<DWORD>(qMin<qint64>(size - done, 0x40000000));
+        DWORD count = 0;
+        const bool started = ReadFile(file, buf + done, chunk, nullptr, &overlapped)
+                || GetLastError() == ERROR_IO_PENDING;
+        const bool finished = started
+                && GetOverlappedResult(file, &overlapped, &count, TRUE);
+        const DWORD error = finished ? ERROR_SUCCESS : GetLastError();
+        CloseHandle(overlapped.hEvent);
+        if (!finished) {
+            if (error == ERROR_HANDLE_EOF)
+                break;
+            return -1;
+        }
+#else
+        ssize_t count = pread(handle, buf + done, static_cast<size_t>(size - done),
+                              static_cast<off_t>(pos + done));
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+#endif
+        if (count == 0)
+            break;
+        done += count;
+    }
+    return done;
+}
+
+// Moves *pos, which the device doesn't know about, as minizip wants.
+int qiodevice_positional_seek(QIODevice *iodevice, qint64 *pos,
+                              ZPOS64_T offset, int origin)
+{
+    qint64 newPos;
+    switch (origin)
+    {
+    case ZLIB_FILEFUNC_SEEK_CUR :
+        newPos = *pos + static_cast<qint64>(offset);
+        break;
+    case ZLIB_FILEFUNC_SEEK_END :
+        newPos = iodevice->size() - static_cast<qint64>(offset);
+        break;
+    case ZLIB_FILEFUNC_SEEK_SET :
+        newPos = static_cast<qint64>(offset);
+        break;
+    default:
+        return -1;
+    }
+    if (newPos < 0)
+        return -1;
+    *pos = newPos;
+    return 0;
+}
+
+// Reads up to size bytes at pos from the native handle, or with seek() and
+// read() under the lock if there is none (handle is -1).
+qint64 qiodevice_positional_read(int handle, QIODevice *iodevice, char *buf,
+                                 qint64 size, qint64 pos)
+{
+    if (handle != -1)
+        return qiodevice_read_at(handle, buf, size, pos);
+    QMutexLocker locker(qiodevice_positional_mutex());
+    return iodevice->seek(pos) ? iodevice->read(buf, size) : -1;
+}
+
+// Opens the device for reading if it isn't open yet. Only random access
+// devices can be read, as with qiodevice_open_file_func().
+bool qiodevice_open_for_reading(QIODevice *iodevice, int mode)
+{
+    if ((mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER) != ZLIB_FILEFUNC_MODE_READ)
+        return false;
+    if (iodevice->isOpen())
+        return (iodevice->openMode() & QIODevice::ReadOnly) != 0
+                && !iodevice->isSequential();
+    iodevice->open(QIODevice::ReadOnly);
+    if (!iodevice->isOpen())
+        return false;
+    if (iodevice->isSequential()) {
+        iodevice->close();
+        return false;
+    }
+    return true;
+}
+
+}
+
+voidpf ZCALLBACK qiodevice_mapped_open_file_func (
+   voidpf opaque,
+   voidpf file,
+   int mode)
+{
+    QIODevice_mapped_descriptor *d = reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(file);
+    // Mapping is only used for reading.
+    if (!qiodevice_open_for_reading(iodevice, mode)) {
+        delete d;
+        return nullptr;
+    }
+    QFileDevice *fileDevice = qobject_cast<QFileDevice*>(iodevice);
+    qint64 size = iodevice->size();
+    if (fileDevice != nullptr && size > 0) {
+        d->data = fileDevice->map(0, size);
+        if (d->data != nullptr) {
+            d->file = fileDevice;
+            d->size = size;
+        }
+    }
+    if (d->data == nullptr)
+        d->handle = qiodevice_open_handle(fileDevice);
+    return iodevice;
+}
+
+uLong ZCALLBACK qiodevice_mapped_read_file_func (
+   voidpf opaque,
+   voidpf stream,
+   void* buf,
+   uLong size)
+{
+    QIODevice_mapped_descriptor *d = reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    if (d->data == nullptr) {
+        QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+        const qint64 ret64 = qiodevice_positional_read(d->handle, iodevice,
+                static_cast<char*>(buf), size, d->pos);
+        if (ret64 > 0)
+            d->pos += ret64;
+        return static_cast<uLong>(ret64);
+    }
+    qint64 count = qMin<qint64>(size, qMax<qint64>(0, d->size - d->pos));
+    if (count > 0) {
+        memcpy(buf, d->data + d->pos, static_cast<size_t>(count));
+        d->pos += count;
+    }
+    return static_cast<uLong>(count);
+}
+
+uLong ZCALLBACK qiodevice_mapped_write_file_func (
+   voidpf /*opaque UNUSED*/,
+   voidpf /*stream UNUSED*/,
+   const void* /*buf UNUSED*/,
+   uLong /*size UNUSED*/)
+{
+    // never opened for writing
+    return 0;
+}
+
+ZPOS64_T ZCALLBACK qiodevice_mapped_tell_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice_mapped_descriptor *d = reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    return static_cast<ZPOS64_T>(d->pos);
+}
+
+int ZCALLBACK qiodevice_mapped_seek_file_func (
+   voidpf opaque,
+   voidpf stream,
+   ZPOS64_T offset,
+   int origin)
+{
+    QIODevice_mapped_descriptor *d = reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    if (d->data == nullptr)
+        return qiodevice_positional_seek(reinterpret_cast<QIODevice*>(stream),
+                                         &d->pos, offset, origin);
+    qint64 pos;
+    switch (origin)
+    {
+    case ZLIB_FILEFUNC_SEEK_CUR :
+        pos = d->pos + static_cast<qint64>(offset);
+        break;
+    case ZLIB_FILEFUNC_SEEK_END :
+        pos = d->size - static_cast<qint64>(offset);
+        break;
+    case ZLIB_FILEFUNC_SEEK_SET :
+        pos = static_cast<qint64>(offset);
+        break;
+    default:
+        return -1;
+    }
+    // seeking past the end is fine, just like for files
+    if (pos < 0)
+        return -1;
+    d->pos = pos;
+    return 0;
+}
+
+const void* ZCALLBACK qiodevice_mapped_view_file_func (
+   voidpf opaque,
+   voidpf /*stream UNUSED*/,
+   ZPOS64_T offset,
+   ZPOS64_T* psize)
+{
+    QIODevice_mapped_descriptor *d = reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    if (d->data == nullptr || offset >= static_cast<ZPOS64_T>(d->size))
+        return nullptr;
+    *psize = static_cast<ZPOS64_T>(d->size) - offset;
+    return d->data + offset;
+}
+
+int ZCALLBACK qiodevice_mapped_close_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice_mapped_descriptor *d = reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    d->unmap();
+    delete d;
+    QIODevice *device = reinterpret_cast<QIODevice*>(stream);
+    return quazip_close(device) ? 0 : -1;
+}
+
+int ZCALLBACK qiodevice_mapped_fakeclose_file_func (
+   voidpf opaque,
+   voidpf /*stream*/)
+{
+    QIODevice_mapped_descriptor *d = reinterpret_cast<QIODevice_mapped_descriptor*>(opaque);
+    d->unmap();
+    delete d;
+    return 0;
+}
+
+void fill_qiodevice64_mapped_filefunc (
+  zlib_filefunc64_def* pzlib_filefunc_def)
+{
+    pzlib_filefunc_def->zopen64_file = qiodevice_mapped_open_file_func;
+    pzlib_filefunc_def->zread_file = qiodevice_mapped_read_file_func;
+    pzlib_filefunc_def->zwrite_file = qiodevice_mapped_write_file_func;
+    pzlib_filefunc_def->ztell64_file = qiodevice_mapped_tell_file_func;
+    pzlib_filefunc_def->zseek64_file = qiodevice_mapped_seek_file_func;
+    pzlib_filefunc_def->zclose_file = qiodevice_mapped_close_file_func;
+    pzlib_filefunc_def->zerror_file = qiodevice_error_file_func;
+    pzlib_filefunc_def->opaque = new QIODevice_mapped_descriptor;
+    pzlib_filefunc_def->zfakeclose_file = qiodevice_mapped_fakeclose_file_func;
+}
+
+/// @cond internal
+struct QIODevice_positional_descriptor {
+    // The native file handle, or -1 if the device has none, in which case
+    // it is read with seek() and read() under a lock.
+    int handle{-1};
+    // Every handle has its own position, so the device position is unused.
+    qint64 pos{0};
+    ~QIODevice_positional_descriptor()
+    {
+        qiodevice_close_handle(handle);
+    }
+};
+/// @endcond
+
+voidpf ZCALLBACK qiodevice_positional_open_file_func (
+   voidpf opaque,
+   voidpf file,
+   int mode)
+{
+    QIODevice_positional_descriptor *d = reinterpret_cast<QIODevice_positional_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(file);
+    if (!qiodevice_open_for_reading(iodevice, mode)) {
+        delete d;
+        return nullptr;
+    }
+    d->handle = qiodevice_open_handle(qobject_cast<QFileDevice*>(iodevice));
+    return iodevice;
+}
+
+uLong ZCALLBACK qiodevice_positional_read_file_func (
+   voidpf opaque,
+   voidpf stream,
+   void* buf,
+   uLong size)
+{
+    QIODevice_positional_descriptor *d = reinterpret_cast<QIODevice_positional_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+    const qint64 ret64 = qiodevice_positional_read(d->handle, iodevice,
+            static_cast<char*>(buf), size, d->pos);
+    if (ret64 > 0)
+        d->pos += ret64;
+    return static_cast<uLong>(ret64);
+}
+
+ZPOS64_T ZCALLBACK qiodevice_positional_tell_file_func (
+   voidpf opaque,
+   voidpf /*stream UNUSED*/)
+{
+    QIODevice_positional_descriptor *d = reinterpret_cast<QIODevice_positional_descriptor*>(opaque);
+    return static_cast<ZPOS64_T>(d->pos);
+}
+
+int ZCALLBACK qiodevice_positional_seek_file_func (
+   voidpf opaque,
+   voidpf stream,
+   ZPOS64_T offset,
+   int origin)
+{
+    QIODevice_positional_descriptor *d = reinterpret_cast<QIODevice_positional_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+    return qiodevice_positional_seek(iodevice, &d->pos, offset, origin);
+}
+
+int ZCALLBACK qiodevice_positional_close_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice_positional_descriptor *d = reinterpret_cast<QIODevice_positional_descriptor*>(opaque);
+    delete d;
+    QIODevice *device = reinterpret_cast<QIODevice*>(stream);
+    return quazip_close(device) ? 0 : -1;
+}
+
+int ZCALLBACK qiodevice_positional_fakeclose_file_func (
+   voidpf opaque,
+   voidpf /*stream*/)
+{
+    QIODevice_positional_descriptor *d = reinterpret_cast<QIODevice_positional_descriptor*>(opaque);
+    delete d;
+    return 0;
+}
+
+void fill_qiodevice64_positional_filefunc (
+  zlib_filefunc64_def* pzlib_filefunc_def)
+{
+    pzlib_filefunc_def->zopen64_file = qiodevice_positional_open_file_func;
+    pzlib_filefunc_def->zread_file = qiodevice_positional_read_file_func;
+    // never opened for writing, just like the mapped ones
+    pzlib_filefunc_def->zwrite_file = qiodevice_mapped_write_file_func;
+    pzlib_filefunc_def->ztell64_file = qiodevice_positional_tell_file_func;
+    pzlib_filefunc_def->zseek64_file = qiodevice_positional_seek_file_func;
+    pzlib_filefunc_def->zclose_file = qiodevice_positional_close_file_func;
+    pzlib_filefunc_def->zerror_file = qiodevice_error_file_func;
+    pzlib_filefunc_def->opaque = new QIODevice_positional_descriptor;
+    pzlib_filefunc_def->zfakeclose_file = qiodevice_positional_fakeclose_file_func;
+}
+
+/// @cond internal
+struct QIODevice_readahead_descriptor {
+    // As for QIODevice_positional_descriptor.
+    int handle{-1};
+    qint64 pos{0};
+    // The data read ahead, from windowStart, windowSize bytes of it valid.
+    QByteArray window;
+    qint64 windowStart{0};
+    qint64 windowSize{0};
+    // The window after it, read by the pool if nextStart isn't -1.
+    QByteArray next;
+    qint64 nextStart{-1};
+    qint64 nextSize{0};
+    bool prefetch{false};
+    // Declared last, so that it waits for the prefetch before the buffers go.
+    QThreadPool pool;
+    ~QIODevice_readahead_descriptor()
+    {
+        // the prefetch reads through the handle too
+        pool.waitForDone();
+        qiodevice_close_handle(handle);
+    }
+};
+/// @endcond
+
+namespace {
+
+// Starts reading the window after the current one, or at least tells the
+// system that it is going to be read.
+void qiodevice_readahead_ahead(QIODevice_readahead_descriptor *d)
+{
+    const qint64 start = d->windowStart + d->windowSize;
+    const qint64 size = d->window.size();
+    if (d->handle == -1 || d->windowSize < size) // no handle or at the end
+        return;
+    if (!d->prefetch) {
+#if defined(POSIX_FADV_WILLNEED)
+        posix_fadvise(d->handle, static_cast<off_t>(start),
+                      static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+#endif
+        return;
+    }
+    if (d->nextStart == start)
+        return; // already on its way
+    // a prefetch that wasn't used may still be reading into next
+    d->pool.waitForDone();
+    // pread() doesn't touch anything the reading thread uses
+    d->next.resize(static_cast<int>(size));
+    d->nextStart = start;
+    d->nextSize = 0;
+    char *next = d->next.data();
+    const int handle = d->handle;
+    d->pool.start(QRunnable::create([d, next, handle, start, size]() {
+        d->nextSize = qiodevice_read_at(handle, next, size, start);
+    }));
+}
+
+}
+
+voidpf ZCALLBACK qiodevice_readahead_open_file_func (
+   voidpf opaque,
+   voidpf file,
+   int mode)
+{
+    QIODevice_readahead_descriptor *d = reinterpret_cast<QIODevice_readahead_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(file);
+    if (!qiodevice_open_for_reading(iodevice, mode)) {
+        delete d;
+        return nullptr;
+    }
+    d->handle = qiodevice_open_handle(qobject_cast<QFileDevice*>(iodevice));
+#if defined(POSIX_FADV_SEQUENTIAL)
+    // mostly read in order, so let the system read ahead more too
+    if (d->handle != -1)
+        posix_fadvise(d->handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return iodevice;
+}
+
+uLong ZCALLBACK qiodevice_readahead_read_file_func (
+   voidpf opaque,
+   voidpf stream,
+   void* buf,
+   uLong size)
+{
+    QIODevice_readahead_descriptor *d = reinterpret_cast<QIODevice_readahead_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+    char *data = static_cast<char*>(buf);
+    qint64 left = static_cast<qint64>(size);
+    qint64 done = 0;
+    while (left > 0) {
+        const qint64 offset = d->pos - d->windowStart;
+        if (offset >= 0 && offset < d->windowSize) {
+            const qint64 chunk = qMin(left, d->windowSize - offset);
+            memcpy(data + done, d->window.constData() + offset, static_cast<size_t>(chunk));
+            d->pos += chunk;
+            done += chunk;
+            left -= chunk;
+            continue;
+        }
+        if (d->nextStart != -1 && d->pos >= d->nextStart
+                && d->pos < d->nextStart + d->next.size()) {
+            // only wait for the prefetch if it's going to be used
+            d->pool.waitForDone();
+            const qint64 nextStart = d->nextStart;
+            d->nextStart = -1;
+            if (d->pos < nextStart + d->nextSize) {
+                d->window.swap(d->next);
+                d->windowStart = nextStart;
+                d->windowSize = d->nextSize;
+                qiodevice_readahead_ahead(d);
+                continue;
+            }
+        }
+        qint64 read;
+        if (left >= d->window.size()) {
+            // too much to go through the window
+            read = qiodevice_positional_read(d->handle, iodevice, data + done, left, d->pos);
+            if (read > 0) {
+                d->pos += read;
+                done += read;
+            }
+        } else {
+            read = qiodevice_positional_read(d->handle, iodevice, d->window.data(),
+                                             d->window.size(), d->pos);
+            if (read > 0) {
+                d->windowStart = d->pos;
+                d->windowSize = read;
+                qiodevice_readahead_ahead(d);
+                continue;
+            }
+        }
+        if (read < 0 && done == 0)
+            return static_cast<uLong>(-1);
+        break;
+    }
+    return static_cast<uLong>(done);
+}
+
+ZPOS64_T ZCALLBACK qiodevice_readahead_tell_file_func (
+   voidpf opaque,
+   voidpf /*stream UNUSED*/)
+{
+    QIODevice_readahead_descriptor *d = reinterpret_cast<QIODevice_readahead_descriptor*>(opaque);
+    return static_cast<ZPOS64_T>(d->pos);
+}
+
+int ZCALLBACK qiodevice_readahead_seek_file_func (
+   voidpf opaque,
+   voidpf stream,
+   ZPOS64_T offset,
+   int origin)
+{
+    QIODevice_readahead_descriptor *d = reinterpret_cast<QIODevice_readahead_descriptor*>(opaque);
+    QIODevice *iodevice = reinterpret_cast<QIODevice*>(stream);
+    return qiodevice_positional_seek(iodevice, &d->pos, offset, origin);
+}
+
+int ZCALLBACK qiodevice_readahead_close_file_func (
+   voidpf opaque,
+   voidpf stream)
+{
+    QIODevice_readahead_descriptor *d = reinterpret_cast<QIODevice_readahead_descriptor*>(opaque);
+    delete d;
+    QIODevice *device = reinterpret_cast<QIODevice*>(stream);
+    return quazip_close(device) ? 0 : -1;
+}
+
+int ZCALLBACK qiodevice_readahead_fakeclose_file_func (
+   voidpf opaque,
+   voidpf /*stream*/)
+{
+    QIODevice_readahead_descriptor *d = reinterpret_cast<QIODevice_readahead_descriptor*>(opaque);
+    delete d;
+    return 0;
+}
+
+void fill_qiodevice64_readahead_filefunc (
+  zlib_filefunc64_def* pzlib_filefunc_def,
+  int window_size,
+  int prefetch)
+{
+    QIODevice_readahead_descriptor *d = new QIODevice_readahead_descriptor;
+    d->window.resize(qMax(window_size, 1));
+    d->prefetch = prefetch != 0;
+    d->pool.setMaxThreadCount(1);
+    pzlib_filefunc_def->zopen64_file = qiodevice_readahead_open_file_func;
+    pzlib_filefunc_def->zread_file = qiodevice_readahead_read_file_func;
+    pzlib_filefunc_def->zwrite_file = qiodevice_mapped_write_file_func;
+    pzlib_filefunc_def->ztell64_file = qiodevice_readahead_tell_file_func;
+    pzlib_filefunc_def->zseek64_file = qiodevice_readahead_seek_file_func;
+    pzlib_filefunc_def->zclose_file = qiodevice_readahead_close_file_func;
+    pzlib_filefunc_def->zerror_file = qiodevice_error_file_func;
+    pzlib_filefunc_def->opaque = d;
+    pzlib_filefunc_def->zfakeclose_file = qiodevice_readahead_fakeclose_file_func;
+}
+
 void fill_zlib_filefunc64_32_def_from_filefunc32(zlib_filefunc64_32_def* p_filefunc64_32,const zlib_filefunc_def* p_filefunc32)
 {
     p_filefunc64_32->zfile_func64.zopen64_file = nullptr;
@@ -354,4 +1193,6 @@ void fill_zlib_filefunc64_32_def_from_filefunc32(zlib_filefunc64_32_def* p_filef
     p_filefunc64_32->zfile_func64.zfakeclose_file = nullptr;
     p_filefunc64_32->zseek32_file = p_filefunc32->zseek_file;
     p_filefunc64_32->ztell32_file = p_filefunc32->ztell_file;
+    p_filefunc64_32->zview64_file = nullptr;
+    p_filefunc64_32->zflush64_file = nullptr;
 }
@@ -27,6 +27,22 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #include <zlib.h>
 
+#include <algorithm>
+
+/// Continues \a checksum with \a size bytes, which may be more than uInt holds.
+static quint32 adler32Span(quint32 checksum, const char *data, qsizetype size)
+{
+	if (data == nullptr)
+		return static_cast<quint32>(adler32(checksum, Z_NULL, 0));
+	do {
+		const uInt chunk = static_cast<uInt>(std::min<qsizetype>(size, 0x40000000));
+		checksum = static_cast<quint32>(adler32(checksum, reinterpret_cast<const Bytef*>(data), chunk));
+		data += chunk;
+		size -= chunk;
+	} while (size > 0);
+	return checksum;
+}
+
 QuaAdler32::QuaAdler32()
 {
 	reset();
@@ -34,7 +50,7 @@ QuaAdler32::QuaAdler32()
 
 quint32 QuaAdler32::calculate(const QByteArray &data)
 {
-	return adler32( adler32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(data.data()), data.size() );
+	return adler32Span(adler32(0L, Z_NULL, 0), data.constData(), data.size());
 }
 
 void QuaAdler32::reset()
@@ -44,10 +60,31 @@ void QuaAdler32::reset()
 
 void QuaAdler32::update(const QByteArray &buf)
 {
-	checksum = adler32( checksum, reinterpret_cast<const Bytef*>(buf.data()), buf.size() );
+	checksum = adler32Span(checksum, buf.constData(), buf.size());
 }
 
 quint32 QuaAdler32::value()
 {
 	return checksum;
 }
+
+quint32 QuaAdler32::calculate(const char *data, qsizetype size, int threadCount)
+{
+	return updateSpan(adler32(0L, Z_NULL, 0), data, size, threadCount, adler32Span, combine);
+}
+
+void QuaAdler32::update(const char *data, qsizetype size, int threadCount)
+{
+	checksum = updateSpan(checksum, data, size, threadCount, adler32Span, combine);
+}
+
+quint32 QuaAdler32::combine(quint32 first, quint32 second, qint64 secondSize)
+{
+#ifdef Z_LARGE64
+	return static_cast<quint32>(adler32_combine64(first, second, secondSize));
+#else
+	// z_off_t may be 32-bit (LLP64), but only the size modulo 65521 counts
+	return static_cast<quint32>(adler32_combine(first, second,
+			static_cast<z_off_t>(secondSize % 65521)));
+#endif
+}
@@ -47,6 +47,32 @@ public:
 	void update(const QByteArray &buf) override;
 	quint32 value() override;
 
+	using QuaChecksum32::calculate;
+	using QuaChecksum32::update;
+
+	///Calculates the checksum of \a size bytes at \a data using threads.
+	/** Large buffers are split between up to \a threadCount threads, zero
+	 * meaning QThread::idealThreadCount(); each thread checksums its own
+	 * piece, and the results are merged with combine(). The result is the
+	 * same as with a single thread.
+	 *
+	 * Like calculate(const QByteArray&), this has no effect on value().
+	 */
+	quint32 calculate(const char *data, qsizetype size, int threadCount);
+	///Updates the checksum for the stream with \a size bytes using threads.
+	/** The threads are used the same way as by
+	 * calculate(const char*, qsizetype, int).
+	 */
+	void update(const char *data, qsizetype size, int threadCount);
+	///Combines the checksums of two consecutive pieces of data.
+	/** \a first is the checksum of the first piece, \a second is that of
+	 * the second piece, of \a secondSize bytes. The result is the checksum
+	 * of both pieces together, as if they were passed to update() one after
+	 * another. This allows checksumming parts of the data separately,
+	 * for example in different threads.
+	 */
+	static quint32 combine(quint32 first, quint32 second, qint64 secondSize);
+
 private:
 	quint32 checksum;
 };
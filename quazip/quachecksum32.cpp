@@ -1,3 +1,57 @@
 #include "quachecksum32.h"
 
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+
+#include <algorithm>
+#include <vector>
+
+/// Pieces smaller than this aren't worth a thread.
+#define QUACHECKSUM32_MIN_PIECE (1024 * 1024)
+
 QuaChecksum32::~QuaChecksum32() = default;
+
+quint32 QuaChecksum32::calculate(const char *data, qsizetype size)
+{
+    // the raw data is not copied
+    return calculate(QByteArray::fromRawData(data, size));
+}
+
+void QuaChecksum32::update(const char *data, qsizetype size)
+{
+    update(QByteArray::fromRawData(data, size));
+}
+
+quint32 QuaChecksum32::updateSpan(quint32 checksum, const char *data,
+                                  qsizetype size, int threadCount,
+                                  UpdateFunction update, CombineFunction combine)
+{
+    if (threadCount <= 0)
+        threadCount = QThread::idealThreadCount();
+    const qsizetype pieces = std::min<qsizetype>(threadCount,
+                                                 size / QUACHECKSUM32_MIN_PIECE);
+    if (pieces <= 1)
+        return update(checksum, data, size);
+    const qsizetype pieceSize = size / pieces;
+    // the first piece continues the checksum, the others start afresh
+    const quint32 initial = update(0, nullptr, 0);
+    std::vector<quint32> partial(static_cast<size_t>(pieces), initial);
+    QThreadPool pool;
+    pool.setMaxThreadCount(static_cast<int>(pieces - 1));
+    for (qsizetype i = 1; i < pieces; ++i) {
+        const char *piece = data + i * pieceSize;
+        const qsizetype length = i == pieces - 1 ? size - i * pieceSize : pieceSize;
+        quint32 *result = &partial[static_cast<size_t>(i)];
+        pool.start(QRunnable::create([=]() {
+            *result = update(*result, piece, length);
+        }));
+    }
+    checksum = update(checksum, data, pieceSize);
+    pool.waitForDone();
+    for (qsizetype i = 1; i < pieces; ++i) {
+        const qsizetype length = i == pieces - 1 ? size - i * pieceSize : pieceSize;
+        checksum = combine(checksum, partial[static_cast<size_t>(i)], length);
+    }
+    return checksum;
+}
@@ -26,8 +26,11 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include <QtCore/QByteArray>
+#include <QtCore/QByteArrayView>
 #include "quazip_global.h"
 
+#include <type_traits>
+
 /// Checksum interface.
 /** \class QuaChecksum32 quachecksum32.h <quazip/quachecksum32.h>
  * This is an interface for 32 bit checksums.
@@ -48,6 +51,18 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
  *     crc32->update(fileB.read(bufSize));
  * resoultB = crc32->value();
  * \endcode
+ *
+ * The data can also be passed as a pointer and a size, or as a
+ * QByteArrayView, without copying it into a QByteArray. To checksum the
+ * data read from or written to a device as it passes, see
+ * QuaChecksumIODevice.
+ *
+ * QuaCrc32 and QuaAdler32 can also checksum raw buffers, splitting large
+ * ones between several threads and combining the partial checksums:
+ * \code
+ * QuaCrc32 crc32;
+ * quint32 result = crc32.calculate(data, size, QThread::idealThreadCount());
+ * \endcode
  */
 class QUAZIP_EXPORT QuaChecksum32
 {
@@ -74,6 +89,51 @@ public:
 	/** \return checksum
 	 */
 	virtual quint32 value() = 0;
+
+	///Calculates the checksum of \a size bytes at \a data.
+	/** The same as calculate(const QByteArray&), but the data is not
+	 * copied.
+	 */
+	quint32 calculate(const char *data, qsizetype size);
+	///Calculates the checksum of the viewed data.
+	/** Only QByteArrayView itself is taken, implicit conversions to it
+	 * would make calculate("...") ambiguous.
+	 */
+	template <typename View, typename std::enable_if<
+	        std::is_same<View, QByteArrayView>::value, int>::type = 0>
+	quint32 calculate(View data)
+	{
+		return calculate(data.data(), data.size());
+	}
+	///Updates the checksum for the stream with \a size bytes at \a data.
+	/** The same as update(const QByteArray&), but the data is not copied.
+	 */
+	void update(const char *data, qsizetype size);
+	///Updates the checksum for the stream with the viewed data.
+	template <typename View, typename std::enable_if<
+	        std::is_same<View, QByteArrayView>::value, int>::type = 0>
+	void update(View buf)
+	{
+		update(buf.data(), buf.size());
+	}
+
+protected:
+	/// A checksum function continuing \a checksum with a span of data.
+	typedef quint32 (*UpdateFunction)(quint32 checksum, const char *data,
+	                                  qsizetype size);
+	/// A function combining two checksums, see QuaCrc32::combine().
+	typedef quint32 (*CombineFunction)(quint32 first, quint32 second,
+	                                   qint64 secondSize);
+	/// Continues \a checksum with \a size bytes at \a data.
+	/** Spans of at least twice the minimum piece size are split between
+	 * up to \a threadCount threads (QThread::idealThreadCount() if it is
+	 * zero or negative), and the checksums of the pieces are merged using
+	 * \a combine. Otherwise, or if \a threadCount is 1, \a update is just
+	 * called on the whole span.
+	 */
+	static quint32 updateSpan(quint32 checksum, const char *data,
+	                          qsizetype size, int threadCount,
+	                          UpdateFunction update, CombineFunction combine);
 };
 
 #endif //QUACHECKSUM32_H
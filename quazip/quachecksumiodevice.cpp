@@ -0,0 +1,141 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quachecksumiodevice.h"
+#include "quachecksum32.h"
+
+/// \cond internal
+class QuaChecksumIODevicePrivate {
+    friend class QuaChecksumIODevice;
+    QuaChecksumIODevicePrivate(QIODevice *io, QuaChecksum32 *checksum);
+    QIODevice *io;
+    QuaChecksum32 *checksum;
+    qint64 size{0};
+};
+
+QuaChecksumIODevicePrivate::QuaChecksumIODevicePrivate(QIODevice *_io,
+                                                       QuaChecksum32 *_checksum):
+  io(_io),
+  checksum(_checksum)
+{
+}
+/// \endcond
+
+QuaChecksumIODevice::QuaChecksumIODevice(QIODevice *io, QuaChecksum32 *checksum,
+                                         QObject *parent):
+    QIODevice(parent),
+    d(new QuaChecksumIODevicePrivate(io, checksum))
+{
+  connect(io, SIGNAL(readyRead()), SIGNAL(readyRead()));
+}
+
+QuaChecksumIODevice::~QuaChecksumIODevice()
+{
+    if (isOpen())
+        close();
+    delete d;
+}
+
+QIODevice *QuaChecksumIODevice::getIoDevice() const
+{
+    return d->io;
+}
+
+QuaChecksum32 *QuaChecksumIODevice::getChecksum() const
+{
+    return d->checksum;
+}
+
+qint64 QuaChecksumIODevice::getSize() const
+{
+    return d->size;
+}
+
+bool QuaChecksumIODevice::open(QIODevice::OpenMode mode)
+{
+    if ((mode & QIODevice::Append) != 0) {
+        setErrorString(tr("QIODevice::Append is not supported for"
+                    " QuaChecksumIODevice"));
+        return false;
+    }
+    if ((mode & QIODevice::ReadWrite) == QIODevice::ReadWrite) {
+        setErrorString(tr("QIODevice::ReadWrite is not supported for"
+                    " QuaChecksumIODevice"));
+        return false;
+    }
+    if ((d->io->openMode() & mode & QIODevice::ReadWrite)
+            != (mode & QIODevice::ReadWrite)) {
+        setErrorString(tr("The underlying device is not open in this mode"));
+        return false;
+    }
+    d->checksum->reset();
+    d->size = 0;
+    // buffering would checksum the data read ahead, not the data read
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void QuaChecksumIODevice::close()
+{
+    QIODevice::close();
+}
+
+qint64 QuaChecksumIODevice::readData(char *data, qint64 maxSize)
+{
+    const qint64 read = d->io->read(data, maxSize);
+    if (read < 0) {
+        setErrorString(d->io->errorString());
+        return -1;
+    }
+    d->checksum->update(data, read);
+    d->size += read;
+    return read;
+}
+
+qint64 QuaChecksumIODevice::writeData(const char *data, qint64 maxSize)
+{
+    const qint64 written = d->io->write(data, maxSize);
+    if (written < 0) {
+        setErrorString(d->io->errorString());
+        return -1;
+    }
+    d->checksum->update(data, written);
+    d->size += written;
+    return written;
+}
+
+bool QuaChecksumIODevice::isSequential() const
+{
+    return true;
+}
+
+bool QuaChecksumIODevice::atEnd() const
+{
+    return openMode() == NotOpen
+            || (QIODevice::bytesAvailable() == 0 && d->io->atEnd());
+}
+
+qint64 QuaChecksumIODevice::bytesAvailable() const
+{
+    return QIODevice::bytesAvailable() + d->io->bytesAvailable();
+}
@@ -0,0 +1,98 @@
+#ifndef QUAZIP_QUACHECKSUMIODEVICE_H
+#define QUAZIP_QUACHECKSUMIODEVICE_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QtCore/QIODevice>
+#include "quazip_global.h"
+
+class QuaChecksum32;
+class QuaChecksumIODevicePrivate;
+
+/// A device checksumming the data passing through it.
+/**
+  \class QuaChecksumIODevice quachecksumiodevice.h <quazip/quachecksumiodevice.h>
+  Whatever is read from this device is read from the underlying device,
+  and whatever is written to it is written to the underlying device,
+  updating the checksum with the data on the way. The data is not
+  buffered nor copied, so this can be put in front of a file or a socket
+  to verify a large stream without keeping any of it:
+  \code
+  QuaCrc32 crc32;
+  QuaChecksumIODevice checked(&file, &crc32);
+  checked.open(QIODevice::ReadOnly);
+  JlCompress::copyData(checked, output);
+  checked.close();
+  bool ok = crc32.value() == expected;
+  \endcode
+  */
+class QUAZIP_EXPORT QuaChecksumIODevice: public QIODevice {
+  friend class QuaChecksumIODevicePrivate;
+  Q_OBJECT
+public:
+  /// Constructor.
+  /**
+    \param io The QIODevice to read/write, which must be opened in the
+    mode this device is opened in.
+    \param checksum The checksum to update. It is not owned by this
+    device and must outlive it.
+    \param parent The parent object, as per QObject logic.
+    */
+  QuaChecksumIODevice(QIODevice *io, QuaChecksum32 *checksum,
+                      QObject *parent = nullptr);
+  /// Destructor.
+  ~QuaChecksumIODevice() override;
+  /// Opens the device.
+  /**
+    Resets the checksum and the size. The device is always unbuffered,
+    so that exactly the bytes that were read are checksummed.
+
+    \param mode Neither QIODevice::ReadWrite nor QIODevice::Append are
+    supported.
+    */
+  bool open(QIODevice::OpenMode mode) override;
+  /// Closes this device, but not the underlying one.
+  void close() override;
+  /// Returns the underlying device.
+  QIODevice *getIoDevice() const;
+  /// Returns the checksum being updated.
+  QuaChecksum32 *getChecksum() const;
+  /// Returns the number of bytes checksummed since open().
+  qint64 getSize() const;
+  /// Returns true.
+  bool isSequential() const override;
+  /// Returns true iff the end of the underlying device is reached.
+  bool atEnd() const override;
+  /// Returns the number of bytes available in the underlying device.
+  qint64 bytesAvailable() const override;
+protected:
+  /// Implementation of QIODevice::readData().
+  qint64 readData(char *data, qint64 maxSize) override;
+  /// Implementation of QIODevice::writeData().
+  qint64 writeData(const char *data, qint64 maxSize) override;
+private:
+  QuaChecksumIODevicePrivate *d;
+};
+#endif // QUAZIP_QUACHECKSUMIODEVICE_H
@@ -23,9 +23,26 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
 #include "quacrc32.h"
+#include "quazip_crc32.h"
 
 #include <zlib.h>
 
+#include <algorithm>
+
+/// Continues \a checksum with \a size bytes, which may be more than uInt holds.
+static quint32 crc32Span(quint32 checksum, const char *data, qsizetype size)
+{
+	if (data == nullptr)
+		return static_cast<quint32>(crc32(checksum, Z_NULL, 0));
+	do {
+		const uInt chunk = static_cast<uInt>(std::min<qsizetype>(size, 0x40000000));
+		checksum = static_cast<quint32>(quazip_crc32(checksum, reinterpret_cast<const Bytef*>(data), chunk));
+		data += chunk;
+		size -= chunk;
+	} while (size > 0);
+	return checksum;
+}
+
 QuaCrc32::QuaCrc32()
 {
 	reset();
@@ -33,7 +50,7 @@ QuaCrc32::QuaCrc32()
 
 quint32 QuaCrc32::calculate(const QByteArray &data)
 {
-	return crc32( crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(data.data()), data.size() );
+	return crc32Span(crc32(0L, Z_NULL, 0), data.constData(), data.size());
 }
 
 void QuaCrc32::reset()
@@ -43,10 +60,34 @@ void QuaCrc32::reset()
 
 void QuaCrc32::update(const QByteArray &buf)
 {
-	checksum = crc32( checksum, reinterpret_cast<const Bytef*>(buf.data()), buf.size() );
+	checksum = crc32Span(checksum, buf.constData(), buf.size());
 }
 
 quint32 QuaCrc32::value()
 {
 	return checksum;
 }
+
+quint32 QuaCrc32::calculate(const char *data, qsizetype size, int threadCount)
+{
+	return updateSpan(crc32(0L, Z_NULL, 0), data, size, threadCount, crc32Span, combine);
+}
+
+void QuaCrc32::update(const char *data, qsizetype size, int threadCount)
+{
+	checksum = updateSpan(checksum, data, size, threadCount, crc32Span, combine);
+}
+
+quint32 QuaCrc32::combine(quint32 first, quint32 second, qint64 secondSize)
+{
+#ifdef Z_LARGE64
+	return static_cast<quint32>(crc32_combine64(first, second, secondSize));
+#else
+	// z_off_t may be 32-bit (LLP64), but combining with 0 just shifts the
+	// first checksum, so it's shifted in steps that fit
+	const qint64 step = 0x40000000;
+	for (; secondSize > step; secondSize -= step)
+		first = static_cast<quint32>(crc32_combine(first, 0, static_cast<z_off_t>(step)));
+	return static_cast<quint32>(crc32_combine(first, second, static_cast<z_off_t>(secondSize)));
+#endif
+}
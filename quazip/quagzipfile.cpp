@@ -22,16 +22,80 @@ Original ZIP package is copyrighted by Gilles Vollant and contributors,
 see quazip/(un)zip.h files for details. Basically it's the zlib license.
 */
 
+#include <QtCore/QDataStream>
 #include <QtCore/QFile>
+#include <QtCore/QThread>
 #include <zlib.h>
 
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <memory>
+
 #include "quagzipfile.h"
+#include "quagzipmembers.h"
+
+#define QUAGZIP_BUFSIZE (64*1024)
 
 /// \cond internal
 class QuaGzipFilePrivate {
     friend class QuaGzipFile;
     QString fileName;
     gzFile gzd;
+    /// The device the gzip stream is read from or written to, if any.
+    QIODevice *io{nullptr};
+    z_stream zs;
+    QByteArray inBuf;
+    int inBufPos{0};
+    int inBufSize{0};
+    QByteArray outBuf;
+    int bufferSize{QUAGZIP_BUFSIZE};
+    int level{Z_DEFAULT_COMPRESSION};
+    int flushMode{Z_SYNC_FLUSH};
+    /// Writing: a member is started and must be finished on close.
+    bool memberOpen{false};
+    /// Reading: the last member is over, another one may follow.
+    bool memberEnded{false};
+    /// Reading: something other than a gzip member follows the last one.
+    bool trailingGarbage{false};
+    /// Reading: the stream ended in the middle of a parallel member.
+    bool truncated{false};
+    /// Reading: why a parallel member failed, reported on every read after.
+    int memberError{Z_OK};
+    /// The number of threads, see QuaGzipFile::setThreadCount().
+    int threadCount{1};
+    int blockSize{QuaGzipMemberWriter::DEFAULT_BLOCK_SIZE};
+    /// The file opened by name or descriptor in the parallel mode.
+    std::unique_ptr<QFile> ownedFile;
+    /// Writing in the parallel mode.
+    std::unique_ptr<QuaGzipMemberWriter> memberWriter;
+    /// Reading in the parallel mode, until a member without the size.
+    std::unique_ptr<QuaGzipMemberReader> memberReader;
+    /// Reading: the next members may be inflated in parallel.
+    bool parallelSource{false};
+    /// Reading: what the last member taken from memberReader inflated to.
+    QByteArray ready;
+    int readyPos{0};
+    /// Reading: the member being read from the device, of incomingSize.
+    QByteArray incoming;
+    qsizetype incomingSize{0};
+    /// BGZF mode, see QuaGzipFile::setBgzfEnabled().
+    bool bgzf{false};
+    /// The compressed and uncompressed offsets of the BGZF blocks but the
+    /// first one, as in a .gzi index.
+    QList<QPair<quint64, quint64>> bgzfIndex;
+    /// The number of threads memberReader is created with.
+    int readerThreads{1};
+    /// Reading: where the stream starts on a random-access device.
+    qint64 streamStart{0};
+    /// Reading: the stream offset of the data at inBufPos.
+    quint64 inputOffset{0};
+    /// Reading: the stream offset of incoming.
+    quint64 incomingOffset{0};
+    /// Reading: the stream offsets of the members in memberReader.
+    std::deque<quint64> memberOffsets;
+    /// Reading: the stream offset of the member ready came from.
+    quint64 readyOffset{0};
     inline QuaGzipFilePrivate(): gzd(nullptr) {}
     inline QuaGzipFilePrivate(const QString &_fileName):
         fileName(_fileName), gzd(nullptr) {}
@@ -39,6 +103,18 @@ class QuaGzipFilePrivate {
         QIODevice::OpenMode mode, QString &error);
     gzFile open(int fd, const char *modeString);
     gzFile open(const QString &name, const char *modeString);
+    bool checkMode(QIODevice::OpenMode mode, QString &error);
+    bool openDevice(QIODevice *device, QIODevice::OpenMode mode,
+                    QString &error);
+    bool openOwned(QIODevice::OpenMode mode, QString &error, int fd = -1);
+    bool deflateDevice(int flush, QString &error);
+    bool writeOut(int size, QString &error);
+    bool fillInput(int needed, QString &error);
+    bool fillMembers(QString &error);
+    qint64 readMembers(char *data, qint64 maxSize, QString &error);
+    qint64 readDevice(char *data, qint64 maxSize, QString &error);
+    bool seekBlock(quint64 offset, QString &error);
+    QIODevice::OpenMode deviceMode(QIODevice::OpenMode mode) const;
 };
 
 gzFile QuaGzipFilePrivate::open(const QString &name, const char *modeString)
@@ -55,8 +131,8 @@ template<typename FileId>
 bool QuaGzipFilePrivate::open(FileId id, QIODevice::OpenMode mode, 
                               QString &error)
 {
-    char modeString[2];
-    modeString[0] = modeString[1] = '\0';
+    char modeString[3];
+    modeString[0] = modeString[1] = modeString[2] = '\0';
     if ((mode & QIODevice::Append) != 0) {
         error = QuaGzipFile::tr("QIODevice::Append is not "
                 "supported for GZIP");
@@ -72,18 +148,411 @@ bool QuaGzipFilePrivate::open(FileId id, QIODevice::OpenMode mode,
         modeString[0] = 'r';
     } else if ((mode & QIODevice::WriteOnly) != 0) {
         modeString[0] = 'w';
+        if (level >= 0 && level <= 9)
+            modeString[1] = static_cast<char>('0' + level);
     } else {
         error = QuaGzipFile::tr("You can open a gzip either for reading"
             " or for writing. Which is it?");
         return false;
     }
+    io = nullptr;
     gzd = open(id, modeString);
     if (gzd == nullptr) {
         error = QuaGzipFile::tr("Could not gzopen() file");
         return false;
     }
+    gzbuffer(gzd, static_cast<unsigned>(bufferSize));
     return true;
 }
+
+bool QuaGzipFilePrivate::checkMode(QIODevice::OpenMode mode, QString &error)
+{
+    if ((mode & QIODevice::Append) != 0) {
+        error = QuaGzipFile::tr("QIODevice::Append is not "
+                "supported for GZIP");
+        return false;
+    }
+    if ((mode & QIODevice::ReadWrite) == QIODevice::ReadWrite) {
+        error = QuaGzipFile::tr("Opening gzip for both reading"
+            " and writing is not supported");
+        return false;
+    }
+    if ((mode & QIODevice::ReadWrite) == 0) {
+        error = QuaGzipFile::tr("You can open a gzip either for reading"
+            " or for writing. Which is it?");
+        return false;
+    }
+    return true;
+}
+
+bool QuaGzipFilePrivate::openOwned(QIODevice::OpenMode mode, QString &error,
+                                   int fd)
+{
+    if (!checkMode(mode, error))
+        return false;
+    ownedFile.reset(new QFile(fileName));
+    const bool opened = fd == -1 ? ownedFile->open(mode)
+            : ownedFile->open(fd, mode, QFileDevice::AutoCloseHandle);
+    if (!opened) {
+        error = ownedFile->errorString();
+        ownedFile.reset();
+        return false;
+    }
+    if (!openDevice(ownedFile.get(), mode, error)) {
+        ownedFile.reset();
+        return false;
+    }
+    return true;
+}
+
+bool QuaGzipFilePrivate::openDevice(QIODevice *device,
+                                    QIODevice::OpenMode mode, QString &error)
+{
+    if (device == nullptr) {
+        error = QuaGzipFile::tr("No device to open gzip on");
+        return false;
+    }
+    if (!checkMode(mode, error))
+        return false;
+    if ((device->openMode() & (mode & QIODevice::ReadWrite)) == 0) {
+        error = QuaGzipFile::tr("The device must be open for %1")
+                .arg((mode & QIODevice::ReadOnly) != 0
+                     ? QuaGzipFile::tr("reading")
+                     : QuaGzipFile::tr("writing"));
+        return false;
+    }
+    memset(&zs, 0, sizeof(zs));
+    int err;
+    if ((mode & QIODevice::ReadOnly) != 0)
+        err = inflateInit2(&zs, 16 + MAX_WBITS);
+    else
+        err = deflateInit2(&zs, level, Z_DEFLATED, 16 + MAX_WBITS,
+                           8, Z_DEFAULT_STRATEGY);
+    if (err != Z_OK) {
+        error = QString::fromLocal8Bit(zs.msg);
+        return false;
+    }
+    if ((mode & QIODevice::ReadOnly) != 0) {
+        inBuf.resize(bufferSize);
+        outBuf.clear();
+    } else {
+        outBuf.resize(bufferSize);
+        inBuf.clear();
+    }
+    inBufPos = inBufSize = 0;
+    memberOpen = (mode & QIODevice::WriteOnly) != 0;
+    memberEnded = false;
+    trailingGarbage = false;
+    truncated = false;
+    memberError = Z_OK;
+    ready.clear();
+    readyPos = 0;
+    incoming.clear();
+    incomingSize = 0;
+    inputOffset = incomingOffset = readyOffset = 0;
+    memberOffsets.clear();
+    streamStart = device->isSequential() ? 0 : device->pos();
+    // BGZF is always read and written in blocks, even with one thread
+    if (threadCount != 1 || bgzf) {
+        const int threads = threadCount == 1 ? 1 : threadCount > 0
+                ? threadCount : QThread::idealThreadCount();
+        if ((mode & QIODevice::WriteOnly) != 0) {
+            memberWriter.reset(new QuaGzipMemberWriter(device, threads,
+                                                       blockSize, level, bgzf));
+            bgzfIndex.clear();
+        } else {
+            memberReader.reset(new QuaGzipMemberReader(threads));
+            readerThreads = threads;
+            parallelSource = true;
+        }
+    }
+    gzd = nullptr;
+    io = device;
+    return true;
+}
+
+bool QuaGzipFilePrivate::writeOut(int size, QString &error)
+{
+    const char *data = outBuf.constData();
+    while (size > 0) {
+        qint64 written = io->write(data, size);
+        if (written <= 0) {
+            error = io->errorString();
+            return false;
+        }
+        data += written;
+        size -= static_cast<int>(written);
+    }
+    return true;
+}
+
+bool QuaGzipFilePrivate::deflateDevice(int flush, QString &error)
+{
+    for (;;) {
+        zs.next_out = reinterpret_cast<Bytef*>(outBuf.data());
+        zs.avail_out = static_cast<uInt>(outBuf.size());
+        int err = deflate(&zs, flush);
+        if (err != Z_OK && err != Z_STREAM_END && err != Z_BUF_ERROR) {
+            error = QString::fromLocal8Bit(zs.msg);
+            return false;
+        }
+        if (!writeOut(outBuf.size() - static_cast<int>(zs.avail_out), error))
+            return false;
+        if (err == Z_STREAM_END)
+            return true;
+        // no more output pending unless the buffer is full
+        if (zs.avail_out != 0 && (flush != Z_FINISH || err == Z_BUF_ERROR))
+            return true;
+    }
+}
+
+bool QuaGzipFilePrivate::fillInput(int needed, QString &error)
+{
+    if (inBufSize - inBufPos >= needed)
+        return true;
+    if (inBufPos != 0) {
+        memmove(inBuf.data(), inBuf.constData() + inBufPos,
+                inBufSize - inBufPos);
+        inBufSize -= inBufPos;
+        inBufPos = 0;
+    }
+    while (inBufSize < needed) {
+        qint64 more = io->read(inBuf.data() + inBufSize,
+                               inBuf.size() - inBufSize);
+        if (more < 0) {
+            error = io->errorString();
+            return false;
+        }
+        if (more == 0)
+            break;
+        inBufSize += static_cast<int>(more);
+    }
+    return true;
+}
+
+bool QuaGzipFilePrivate::fillMembers(QString &error)
+{
+    while (parallelSource && !memberReader->isFull()) {
+        if (incomingSize == 0) {
+            int needed = 0;
+            const qint64 size = QuaGzipMemberReader::memberSize(
+                        inBuf.constData() + inBufPos, inBufSize - inBufPos,
+                        &needed);
+            if (size == -1) {
+                if (needed > inBuf.size()) {
+                    parallelSource = false;
+                    break;
+                }
+                if (!fillInput(needed, error))
+                    return false;
+                if (inBufSize - inBufPos < needed) {
+                    // if it's over, let the serial reader handle what's left
+                    if (io->atEnd())
+                        parallelSource = false;
+                    break;
+                }
+                continue;
+            }
+            if (size == 0) {
+                // not a member written by QuaGzipMemberWriter
+                parallelSource = false;
+                break;
+            }
+            incomingSize = static_cast<qsizetype>(size);
+            incomingOffset = inputOffset;
+            incoming.clear();
+            incoming.reserve(incomingSize);
+        }
+        // no more than what's in inBuf, so it fits in an int
+        const int buffered = static_cast<int>(qMin<qsizetype>(
+                    incomingSize - incoming.size(), inBufSize - inBufPos));
+        incoming.append(inBuf.constData() + inBufPos, buffered);
+        inBufPos += buffered;
+        inputOffset += buffered;
+        if (incoming.size() < incomingSize) {
+            // read the rest of a big member directly
+            const qsizetype have = incoming.size();
+            incoming.resize(incomingSize);
+            const qint64 more = io->read(incoming.data() + have,
+                                         incomingSize - have);
+            if (more < 0) {
+                error = io->errorString();
+                return false;
+            }
+            incoming.resize(have + more);
+            inputOffset += more;
+            if (more == 0) {
+                if (!io->atEnd())
+                    break; // wait for more
+                // truncated, inflate as much as possible
+                parallelSource = false;
+            } else if (incoming.size() < incomingSize) {
+                continue;
+            }
+        }
+        memberReader->submit(incoming, incoming.size() < incomingSize);
+        memberOffsets.push_back(incomingOffset);
+        incoming.clear();
+        incomingSize = 0;
+    }
+    return true;
+}
+
+qint64 QuaGzipFilePrivate::readMembers(char *data, qint64 maxSize,
+                                       QString &error)
+{
+    if (memberError != Z_OK) {
+        // the stream is out of step after that, don't read on
+        error = QString::fromLatin1(zError(memberError));
+        return -1;
+    }
+    qint64 read = 0;
+    while (read < maxSize) {
+        if (readyPos < ready.size()) {
+            const int chunk = static_cast<int>(qMin<qint64>(
+                        ready.size() - readyPos, maxSize - read));
+            memcpy(data + read, ready.constData() + readyPos, chunk);
+            readyPos += chunk;
+            read += chunk;
+            continue;
+        }
+        if (!fillMembers(error))
+            return -1;
+        if (memberReader->isEmpty()) {
+            if (!parallelSource)
+                memberReader.reset();
+            break;
+        }
+        readyPos = 0;
+        readyOffset = memberOffsets.front();
+        memberOffsets.pop_front();
+        const int err = memberReader->takeFirst(&ready);
+        if (err == Z_BUF_ERROR) {
+            // truncated, so this is the end of it
+            parallelSource = false;
+            memberEnded = false;
+            truncated = true;
+        } else if (err != Z_OK) {
+            memberError = err;
+            error = QString::fromLatin1(zError(err));
+            return -1;
+        } else {
+            memberEnded = true;
+        }
+    }
+    return read;
+}
+
+qint64 QuaGzipFilePrivate::readDevice(char *data, qint64 maxSize,
+                                      QString &error)
+{
+    qint64 read = 0;
+    if (memberReader) {
+        read = readMembers(data, maxSize, error);
+        // the rest of the stream, if any, has to be read serially
+        if (read < 0 || memberReader)
+            return read;
+    }
+    while (read < maxSize && !trailingGarbage) {
+        if (memberEnded) {
+            // another member may follow: check its magic
+            if (!fillInput(2, error))
+                return -1;
+            if (inBufSize - inBufPos < 2)
+                break;
+            const unsigned char *magic = reinterpret_cast<const unsigned char*>(
+                        inBuf.constData() + inBufPos);
+            if (magic[0] != 0x1f || magic[1] != 0x8b) {
+                // ignored, just like gzread() does
+                trailingGarbage = true;
+                break;
+            }
+            inflateReset(&zs);
+            memberEnded = false;
+        }
+        if (!fillInput(1, error))
+            return -1;
+        if (inBufSize == inBufPos) {
+            if ((zs.total_in == 0 && !truncated) || !io->atEnd())
+                break;
+            // cut off in the middle of a member, like gzread() reports it,
+            // but the data inflated so far is returned first
+            if (read == 0) {
+                error = QuaGzipFile::tr("Unexpected end of gzip stream");
+                return -1;
+            }
+            break;
+        }
+        zs.next_in = reinterpret_cast<Bytef*>(inBuf.data() + inBufPos);
+        zs.avail_in = static_cast<uInt>(inBufSize - inBufPos);
+        zs.next_out = reinterpret_cast<Bytef*>(data + read);
+        zs.avail_out = static_cast<uInt>(qMin<qint64>(maxSize - read,
+                                                      0x40000000));
+        const uInt availOut = zs.avail_out;
+        int err = inflate(&zs, Z_NO_FLUSH);
+        inBufPos = inBufSize - static_cast<int>(zs.avail_in);
+        read += availOut - zs.avail_out;
+        switch (err) {
+        case Z_OK:
+        case Z_BUF_ERROR: // needs more input, it's read on the next pass
+            break;
+        case Z_STREAM_END:
+            memberEnded = true;
+            break;
+        default:
+            error = zs.msg != nullptr ? QString::fromLocal8Bit(zs.msg)
+                    : QuaGzipFile::tr("Corrupted gzip stream");
+            return -1;
+        }
+    }
+    return read;
+}
+bool QuaGzipFilePrivate::seekBlock(quint64 offset, QString &error)
+{
+    // throw away everything read ahead
+    if (memberReader)
+        memberReader->clear();
+    else
+        memberReader.reset(new QuaGzipMemberReader(readerThreads));
+    memberOffsets.clear();
+    ready.clear();
+    readyPos = 0;
+    incoming.clear();
+    incomingSize = 0;
+    inBufPos = inBufSize = 0;
+    inflateReset(&zs);
+    memberEnded = false;
+    trailingGarbage = false;
+    truncated = false;
+    memberError = Z_OK;
+    parallelSource = true;
+    if (!io->seek(streamStart + static_cast<qint64>(offset))) {
+        error = io->errorString();
+        return false;
+    }
+    inputOffset = offset;
+    if (!fillMembers(error))
+        return false;
+    if (memberReader->isEmpty())
+        return true; // at the end
+    readyOffset = memberOffsets.front();
+    memberOffsets.pop_front();
+    const int err = memberReader->takeFirst(&ready);
+    if (err != Z_OK) {
+        error = QString::fromLatin1(zError(err));
+        return false;
+    }
+    memberEnded = true;
+    return true;
+}
+
+QIODevice::OpenMode QuaGzipFilePrivate::deviceMode(QIODevice::OpenMode mode) const
+{
+    // not buffered by QIODevice, so that the virtual offset is exact
+    if (bgzf && (mode & QIODevice::ReadOnly) != 0)
+        return mode | QIODevice::Unbuffered;
+    return mode;
+}
 /// \endcond
 
 QuaGzipFile::QuaGzipFile():
@@ -121,6 +590,227 @@ QString QuaGzipFile::getFileName() const
     return d->fileName;
 }
 
+QIODevice *QuaGzipFile::getIoDevice() const
+{
+    return d->ownedFile ? nullptr : d->io;
+}
+
+void QuaGzipFile::setBufferSize(int size)
+{
+    d->bufferSize = size > 0 ? size : QUAGZIP_BUFSIZE;
+}
+
+int QuaGzipFile::getBufferSize() const
+{
+    return d->bufferSize;
+}
+
+void QuaGzipFile::setCompressionLevel(int level)
+{
+    d->level = level;
+}
+
+int QuaGzipFile::getCompressionLevel() const
+{
+    return d->level;
+}
+
+void QuaGzipFile::setFlushMode(int mode)
+{
+    d->flushMode = mode;
+}
+
+int QuaGzipFile::getFlushMode() const
+{
+    return d->flushMode;
+}
+
+void QuaGzipFile::setThreadCount(int threadCount)
+{
+    d->threadCount = threadCount;
+}
+
+int QuaGzipFile::getThreadCount() const
+{
+    return d->threadCount;
+}
+
+void QuaGzipFile::setBlockSize(int blockSize)
+{
+    d->blockSize = blockSize > 0 ? blockSize
+            : QuaGzipMemberWriter::DEFAULT_BLOCK_SIZE;
+}
+
+int QuaGzipFile::getBlockSize() const
+{
+    return d->blockSize;
+}
+
+void QuaGzipFile::setBgzfEnabled(bool enabled)
+{
+    d->bgzf = enabled;
+}
+
+bool QuaGzipFile::isBgzfEnabled() const
+{
+    return d->bgzf;
+}
+
+quint64 QuaGzipFile::virtualOffset() const
+{
+    if (!d->bgzf || (openMode() & QIODevice::ReadOnly) == 0)
+        return 0;
+    if (d->readyPos < d->ready.size())
+        return (d->readyOffset << 16) | static_cast<quint64>(d->readyPos);
+    // the beginning of the next block
+    if (!d->memberOffsets.empty())
+        return d->memberOffsets.front() << 16;
+    if (d->incomingSize != 0)
+        return d->incomingOffset << 16;
+    return d->inputOffset << 16;
+}
+
+bool QuaGzipFile::seekVirtualOffset(quint64 offset)
+{
+    if (!d->bgzf || d->io == nullptr || (openMode() & QIODevice::ReadOnly) == 0
+            || d->io->isSequential()) {
+        setErrorString(tr("Seeking needs a BGZF file open for reading"
+                          " on a random-access device"));
+        return false;
+    }
+    QString error;
+    if (!d->seekBlock(offset >> 16, error)) {
+        setErrorString(error);
+        return false;
+    }
+    const int inBlock = static_cast<int>(offset & 0xFFFF);
+    if (inBlock > d->ready.size()) {
+        setErrorString(tr("The virtual offset is past the end of the block"));
+        return false;
+    }
+    d->readyPos = inBlock;
+    return true;
+}
+
+bool QuaGzipFile::seek(qint64 pos)
+{
+    if (!d->bgzf || d->io == nullptr || (openMode() & QIODevice::ReadOnly) == 0)
+        return QIODevice::seek(pos);
+    if (pos < 0)
+        return false;
+    if (d->bgzfIndex.isEmpty() && !buildBgzfIndex())
+        return false;
+    // the last block starting not after pos
+    auto next = std::upper_bound(d->bgzfIndex.cbegin(), d->bgzfIndex.cend(),
+            static_cast<quint64>(pos),
+            [](quint64 pos, const QPair<quint64, quint64> &block) {
+                return pos < block.second;
+            });
+    quint64 compressed = 0;
+    quint64 uncompressed = 0;
+    if (next != d->bgzfIndex.cbegin()) {
+        compressed = (next - 1)->first;
+        uncompressed = (next - 1)->second;
+    }
+    if (static_cast<quint64>(pos) - uncompressed > 0xFFFF) {
+        setErrorString(tr("Can't seek past the end of the file"));
+        return false;
+    }
+    return seekVirtualOffset((compressed << 16)
+                             | (static_cast<quint64>(pos) - uncompressed));
+}
+
+bool QuaGzipFile::buildBgzfIndex()
+{
+    if (!d->bgzf || d->io == nullptr || (openMode() & QIODevice::ReadOnly) == 0
+            || d->io->isSequential()) {
+        setErrorString(tr("Indexing needs a BGZF file open for reading"
+                          " on a random-access device"));
+        return false;
+    }
+    const quint64 current = virtualOffset();
+    QList<QPair<quint64, quint64>> index;
+    quint64 compressed = 0;
+    quint64 uncompressed = 0;
+    for (;;) {
+        // only the headers and the sizes in the trailers are read
+        if (!d->io->seek(d->streamStart + static_cast<qint64>(compressed))) {
+            setErrorString(d->io->errorString());
+            return false;
+        }
+        QByteArray header = d->io->read(12);
+        if (header.isEmpty())
+            break;
+        int needed = 0;
+        qint64 size = QuaGzipMemberReader::memberSize(header.constData(),
+                header.size(), &needed);
+        if (size == -1 && needed > header.size()) {
+            header.append(d->io->read(needed - header.size()));
+            size = QuaGzipMemberReader::memberSize(header.constData(),
+                    header.size(), &needed);
+        }
+        if (size <= 0) {
+            setErrorString(tr("No BGZF block at %1").arg(compressed));
+            return false;
+        }
+        quint32 blockSize = 0;
+        if (!d->io->seek(d->streamStart + static_cast<qint64>(compressed)
+                         + size - 4)) {
+            setErrorString(d->io->errorString());
+            return false;
+        }
+        QDataStream trailer(d->io);
+        trailer.setByteOrder(QDataStream::LittleEndian);
+        trailer >> blockSize;
+        if (trailer.status() != QDataStream::Ok) {
+            setErrorString(tr("Truncated BGZF block at %1").arg(compressed));
+            return false;
+        }
+        if (compressed != 0 && blockSize != 0)
+            index.append(qMakePair(compressed, uncompressed));
+        compressed += static_cast<quint64>(size);
+        uncompressed += blockSize;
+    }
+    d->bgzfIndex = index;
+    return seekVirtualOffset(current);
+}
+
+bool QuaGzipFile::loadBgzfIndex(QIODevice *device)
+{
+    QDataStream in(device);
+    in.setByteOrder(QDataStream::LittleEndian);
+    quint64 count = 0;
+    in >> count;
+    if (in.status() != QDataStream::Ok
+            || count > static_cast<quint64>(device->bytesAvailable()) / 16) {
+        setErrorString(tr("Not a BGZF index"));
+        return false;
+    }
+    QList<QPair<quint64, quint64>> index;
+    index.reserve(static_cast<int>(count));
+    for (quint64 i = 0; i < count; ++i) {
+        quint64 compressed, uncompressed;
+        in >> compressed >> uncompressed;
+        index.append(qMakePair(compressed, uncompressed));
+    }
+    if (in.status() != QDataStream::Ok) {
+        setErrorString(tr("Not a BGZF index"));
+        return false;
+    }
+    d->bgzfIndex = index;
+    return true;
+}
+
+bool QuaGzipFile::saveBgzfIndex(QIODevice *device) const
+{
+    QDataStream out(device);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << static_cast<quint64>(d->bgzfIndex.size());
+    for (const auto &block: d->bgzfIndex)
+        out << block.first << block.second;
+    return out.status() == QDataStream::Ok;
+}
+
 bool QuaGzipFile::isSequential() const
 {
   return true;
@@ -129,36 +819,114 @@ bool QuaGzipFile::isSequential() const
 bool QuaGzipFile::open(QIODevice::OpenMode mode)
 {
     QString error;
-    if (!d->open(d->fileName, mode, error)) {
+    if (d->threadCount != 1 || d->bgzf ? !d->openOwned(mode, error)
+            : !d->open(d->fileName, mode, error)) {
         setErrorString(error);
         return false;
     }
-    return QIODevice::open(mode);
+    return QIODevice::open(d->deviceMode(mode));
 }
 
 bool QuaGzipFile::open(int fd, QIODevice::OpenMode mode)
 {
     QString error;
-    if (!d->open(fd, mode, error)) {
+    if (d->threadCount != 1 || d->bgzf ? !d->openOwned(mode, error, fd)
+            : !d->open(fd, mode, error)) {
+        setErrorString(error);
+        return false;
+    }
+    return QIODevice::open(d->deviceMode(mode));
+}
+
+bool QuaGzipFile::open(QIODevice *device, QIODevice::OpenMode mode)
+{
+    QString error;
+    if (!d->openDevice(device, mode, error)) {
         setErrorString(error);
         return false;
     }
-    return QIODevice::open(mode);
+    return QIODevice::open(d->deviceMode(mode));
 }
 
 bool QuaGzipFile::flush()
 {
-    return gzflush(d->gzd, Z_SYNC_FLUSH) == Z_OK;
+    if (d->io == nullptr)
+        return gzflush(d->gzd, d->flushMode) == Z_OK;
+    if ((openMode() & QIODevice::WriteOnly) == 0)
+        return false;
+    if (d->memberWriter) {
+        // every member is complete, so there is nothing else to flush
+        if (!d->memberWriter->flush()) {
+            setErrorString(d->memberWriter->errorString());
+            return false;
+        }
+        return true;
+    }
+    if (!d->memberOpen)
+        return false;
+    QString error;
+    if (!d->deflateDevice(d->flushMode, error)) {
+        setErrorString(error);
+        return false;
+    }
+    if (d->flushMode == Z_FINISH)
+        d->memberOpen = false;
+    return true;
 }
 
 void QuaGzipFile::close()
 {
+  if (d->io == nullptr) {
+    QIODevice::close();
+    gzclose(d->gzd);
+    return;
+  }
+  if ((openMode() & QIODevice::WriteOnly) != 0) {
+    QString error;
+    if (d->memberWriter) {
+      if (!d->memberWriter->finish())
+        setErrorString(d->memberWriter->errorString());
+      if (d->bgzf)
+        d->bgzfIndex = d->memberWriter->blocks();
+      d->memberWriter.reset();
+    } else if (d->memberOpen && !d->deflateDevice(Z_FINISH, error)) {
+      setErrorString(error);
+    }
+    deflateEnd(&d->zs);
+  } else if ((openMode() & QIODevice::ReadOnly) != 0) {
+    d->memberReader.reset();
+    inflateEnd(&d->zs);
+  }
+  d->memberOpen = false;
   QIODevice::close();
-  gzclose(d->gzd);
+  if (d->ownedFile) {
+    d->ownedFile->close();
+    d->ownedFile.reset();
+  }
+}
+
+bool QuaGzipFile::atEnd() const
+{
+    if (d->io == nullptr || (openMode() & QIODevice::ReadOnly) == 0)
+        return QIODevice::atEnd();
+    if (QIODevice::bytesAvailable() != 0)
+        return false;
+    if (d->readyPos < d->ready.size() || !d->incoming.isEmpty()
+            || (d->memberReader && !d->memberReader->isEmpty()))
+        return false;
+    return d->trailingGarbage || (d->memberEnded
+            && d->inBufPos == d->inBufSize && d->io->atEnd());
 }
 
 qint64 QuaGzipFile::readData(char *data, qint64 maxSize)
 {
+    if (d->io != nullptr) {
+        QString error;
+        qint64 read = d->readDevice(data, maxSize, error);
+        if (read < 0)
+            setErrorString(error);
+        return read;
+    }
     return gzread(d->gzd, (voidp)data, static_cast<unsigned>(maxSize));
 }
 
@@ -166,6 +934,35 @@ qint64 QuaGzipFile::writeData(const char *data, qint64 maxSize)
 {
     if (maxSize == 0)
         return 0;
+    if (d->memberWriter) {
+        if (!d->memberWriter->write(data, maxSize)) {
+            setErrorString(d->memberWriter->errorString());
+            return -1;
+        }
+        return maxSize;
+    }
+    if (d->io != nullptr) {
+        QString error;
+        if (!d->memberOpen) {
+            // the previous member was finished by flush(), start a new one
+            deflateReset(&d->zs);
+            d->memberOpen = true;
+        }
+        qint64 written = 0;
+        while (written < maxSize) {
+            const uInt chunk = static_cast<uInt>(
+                        qMin<qint64>(maxSize - written, 0x40000000));
+            d->zs.next_in = reinterpret_cast<Bytef*>(
+                        const_cast<char*>(data + written));
+            d->zs.avail_in = chunk;
+            if (!d->deflateDevice(Z_NO_FLUSH, error)) {
+                setErrorString(error);
+                return -1;
+            }
+            written += chunk;
+        }
+        return written;
+    }
     int written = gzwrite(d->gzd, (voidp)data, static_cast<unsigned>(maxSize));
     if (written == 0)
         return -1;
@@ -32,7 +32,9 @@ class QuaGzipFilePrivate;
 
 /// GZIP file
 /**
-  This class is a wrapper around GZIP file access functions in zlib. Unlike QuaZip classes, it doesn't allow reading from a GZIP file opened as QIODevice, for example, if your GZIP file is in QBuffer. It only provides QIODevice access to a GZIP file contents, but the GZIP file itself must be identified by its name on disk or by descriptor id.
+  This class is a wrapper around GZIP file access functions in zlib. It provides QIODevice access to a GZIP file contents. The GZIP file itself is either identified by its name on disk or by descriptor id, or it is read from or written to another QIODevice, such as QBuffer, QTcpSocket or QProcess (see open(QIODevice*, QIODevice::OpenMode)).
+
+  When reading, several concatenated GZIP members are read as one stream, just like gunzip does.
   */
 class QUAZIP_EXPORT QuaGzipFile: public QIODevice {
   Q_OBJECT
@@ -60,6 +62,139 @@ public:
   void setFileName(const QString& fileName);
   /// Returns the name of the GZIP file.
   QString getFileName() const;
+  /// Returns the device the GZIP stream is read from or written to.
+  /**
+    Returns \c nullptr unless the file was opened with
+    open(QIODevice*, QIODevice::OpenMode).
+    */
+  QIODevice *getIoDevice() const;
+  /// Sets the size of the buffers.
+  /**
+    This is how much is read from or written to the file or the
+    underlying device at once. The default is 64 KiB, zero or less
+    restores it. Takes effect on the next open().
+    */
+  void setBufferSize(int size);
+  /// Returns the size of the buffers.
+  int getBufferSize() const;
+  /// Sets the compression level.
+  /**
+    From 0 to 9, or Z_DEFAULT_COMPRESSION, which is the default. Takes
+    effect on the next open() for writing.
+    */
+  void setCompressionLevel(int level);
+  /// Returns the compression level.
+  int getCompressionLevel() const;
+  /// Sets the mode flush() flushes the compressed data with.
+  /**
+    The default is Z_SYNC_FLUSH. Z_PARTIAL_FLUSH, Z_FULL_FLUSH and
+    Z_BLOCK are passed on to zlib, see deflate(). Z_FINISH ends the
+    current GZIP member, and the next write starts a new one, which is
+    a way to split a long stream into members that can be decompressed
+    as soon as they arrive.
+    */
+  void setFlushMode(int mode);
+  /// Returns the mode flush() flushes the compressed data with.
+  int getFlushMode() const;
+  /// Sets the number of threads compressing or decompressing the data.
+  /**
+    Takes effect on the next open(). If it is more than 1 (or 0 or less,
+    which means QThread::idealThreadCount()), the file is processed in
+    the parallel mode:
+
+    - When writing, the data is cut into blocks of getBlockSize() bytes,
+      and every block is compressed by a thread of its own into a
+      separate GZIP member, like <tt>pigz --independent</tt> does. The
+      result is a valid GZIP file, a bit larger than usual. The size of
+      every member is recorded in its header (in the extra subfield QZ),
+      and flush() ends the current member, whatever the flush mode.
+    - When reading, the members with the recorded size are decompressed
+      by several threads at once. Once a member without it is found
+      (which is what any other GZIP writer produces), the rest of the
+      file is decompressed in the calling thread.
+
+    In the parallel mode, a file opened by name or descriptor is accessed
+    through QFile, not zlib. The default is 1, the ordinary mode.
+    */
+  void setThreadCount(int threadCount);
+  /// Returns the number of threads compressing or decompressing the data.
+  /** \sa setThreadCount()
+    */
+  int getThreadCount() const;
+  /// Sets the size of the blocks compressed by each thread.
+  /**
+    The default is 128 KiB, and at most 16 MiB is used. Takes effect on
+    the next open() for writing.
+
+    \sa setThreadCount()
+    */
+  void setBlockSize(int blockSize);
+  /// Returns the size of the blocks compressed by each thread.
+  int getBlockSize() const;
+  /// Enables or disables the BGZF mode.
+  /**
+    BGZF is the blocked GZIP format used in bioinformatics (SAM/BAM,
+    tabix, <tt>bgzip</tt>). A BGZF file is an ordinary GZIP file, made
+    of members of at most 64 KiB, each recording its size in the BC
+    extra subfield, and ending with an empty member. This makes it
+    possible to seek in it and to decompress it in parallel.
+
+    In the BGZF mode, the data is written in blocks of getBlockSize()
+    bytes, but no more than 65280, and read block by block. Both can be
+    done in several threads, see setThreadCount(). A file opened by name
+    or descriptor is accessed through QFile, not zlib, and when reading,
+    this device isn't buffered by QIODevice.
+
+    When reading from a random-access device, seekVirtualOffset() seeks
+    to a BGZF virtual offset, and seek() to an uncompressed position
+    using the block index (see buildBgzfIndex() and loadBgzfIndex()).
+
+    Takes effect on the next open(). Disabled by default.
+    */
+  void setBgzfEnabled(bool enabled);
+  /// Returns true if the BGZF mode is enabled.
+  /** \sa setBgzfEnabled()
+    */
+  bool isBgzfEnabled() const;
+  /// Returns the BGZF virtual offset of the next byte to be read.
+  /**
+    The virtual offset is the offset of a block in the file shifted left
+    by 16 bits, ORed with an offset in the uncompressed data of that
+    block. It is what BGZF indexes such as .bai or .tbi refer to.
+    Returns 0 unless reading in the BGZF mode.
+    */
+  quint64 virtualOffset() const;
+  /// Seeks to a BGZF virtual offset.
+  /**
+    The file must be open for reading in the BGZF mode on a random-access
+    device.
+    \return true on success.
+    \sa virtualOffset()
+    */
+  bool seekVirtualOffset(quint64 offset);
+  /// Builds the block index of a BGZF file.
+  /**
+    Walks the blocks of the file open for reading, looking only at the
+    block headers and sizes, so it is much faster than decompressing.
+    The current position is kept. seek() calls this if there is no index
+    yet.
+    \return true on success.
+    */
+  bool buildBgzfIndex();
+  /// Loads the block index of a BGZF file from a .gzi index.
+  /**
+    The index is kept until another one is loaded or built, or the file
+    is opened for writing, so it can be loaded before opening the file.
+    \return true on success.
+    */
+  bool loadBgzfIndex(QIODevice *device);
+  /// Saves the block index of a BGZF file as a .gzi index.
+  /**
+    After a BGZF file is written and closed, the index of its blocks is
+    available, so it can be saved without building it.
+    \return true on success.
+    */
+  bool saveBgzfIndex(QIODevice *device) const;
   /// Returns true.
   /**
     Strictly speaking, zlib supports seeking for GZIP files, but it is
@@ -83,14 +218,41 @@ public:
     ReadWrite and Append aren't supported.
     */
   virtual bool open(int fd, QIODevice::OpenMode mode);
+  /// Opens the GZIP stream on another device.
+  /**
+    \overload
+    The compressed data is read from or written to \a device, which
+    must already be open in the matching mode. Any device will do,
+    including sequential ones, and no temporary file is needed.
+    Closing this file finishes the GZIP member being written, but
+    doesn't close \a device.
+    \param device The device to read/write the GZIP stream from/to.
+    \param mode Can be either QIODevice::Write or QIODevice::Read.
+    ReadWrite and Append aren't supported.
+    */
+  bool open(QIODevice *device, QIODevice::OpenMode mode);
   /// Flushes data to file.
   /**
-    The data is written using Z_SYNC_FLUSH mode. Doesn't make any sense
-    when reading.
+    The data is written using Z_SYNC_FLUSH mode, unless set otherwise
+    with setFlushMode(). Doesn't make any sense when reading.
     */
   virtual bool flush();
   /// Closes the file.
   void close() override;
+  /// Returns true iff the end of the GZIP stream is reached.
+  /**
+    Only meaningful when reading from a device. The end is reached when
+    the last member has been read and the device has nothing more, or
+    when the data following a member is not another GZIP member.
+    */
+  bool atEnd() const override;
+  /// Seeks to an uncompressed position in the BGZF mode.
+  /**
+    Only possible when reading in the BGZF mode on a random-access
+    device. The block index is built with buildBgzfIndex() unless one is
+    loaded already.
+    */
+  bool seek(qint64 pos) override;
 protected:
   /// Implementation of QIODevice::readData().
   qint64 readData(char *data, qint64 maxSize) override;
@@ -0,0 +1,392 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+
+#include "quagzipmembers.h"
+#include "quazip_crc32.h"
+
+#include <QtCore/QRunnable>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+/// The size of the header written by deflateMember().
+const int MEMBER_HEADER_SIZE = 20;
+/// The same in the BGZF mode.
+const int BGZF_HEADER_SIZE = 18;
+/// The size of the gzip trailer, the CRC and the size.
+const int MEMBER_TRAILER_SIZE = 8;
+/// The empty block that ends a BGZF file.
+const char BGZF_EOF[] = "\x1f\x8b\x08\x04\x00\x00\x00\x00\x00\xff\x06\x00\x42\x43"
+        "\x02\x00\x1b\x00\x03\x00\x00\x00\x00\x00\x00\x00\x00\x00";
+
+void putLE32(char *p, quint32 value)
+{
+    p[0] = static_cast<char>(value & 0xFF);
+    p[1] = static_cast<char>((value >> 8) & 0xFF);
+    p[2] = static_cast<char>((value >> 16) & 0xFF);
+    p[3] = static_cast<char>((value >> 24) & 0xFF);
+}
+
+quint32 getLE32(const char *p)
+{
+    const unsigned char *u = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<quint32>(u[0]) | (static_cast<quint32>(u[1]) << 8)
+            | (static_cast<quint32>(u[2]) << 16)
+            | (static_cast<quint32>(u[3]) << 24);
+}
+
+void putLE16(char *p, quint16 value)
+{
+    p[0] = static_cast<char>(value & 0xFF);
+    p[1] = static_cast<char>((value >> 8) & 0xFF);
+}
+
+quint16 getLE16(const char *p)
+{
+    const unsigned char *u = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<quint16>(u[0] | (u[1] << 8));
+}
+
+}
+
+QuaGzipMemberWriter::QuaGzipMemberWriter(QIODevice *io, int threadCount,
+                                         int blockSize, int level, bool bgzf):
+    m_io(io),
+    m_blockSize(blockSize > 0 ? blockSize : DEFAULT_BLOCK_SIZE),
+    m_level(level),
+    m_bgzf(bgzf),
+    // enough to keep all the threads busy while the oldest member is written
+    m_maxPending(static_cast<size_t>(threadCount) * 2),
+    m_written(false),
+    m_compressedOffset(0),
+    m_uncompressedOffset(0)
+{
+    if (m_bgzf)
+        m_blockSize = std::min(m_blockSize, QUAGZIP_BGZF_BLOCK_SIZE);
+    else
+        m_blockSize = std::min(m_blockSize, MAX_BLOCK_SIZE);
+    m_pool.setMaxThreadCount(threadCount);
+    m_current.reserve(m_blockSize);
+}
+
+QuaGzipMemberWriter::~QuaGzipMemberWriter()
+{
+    m_pool.waitForDone();
+}
+
+bool QuaGzipMemberWriter::write(const char *data, qint64 size)
+{
+    while (size > 0) {
+        const qint64 chunk = std::min<qint64>(size, m_blockSize - m_current.size());
+        m_current.append(data, static_cast<int>(chunk));
+        data += chunk;
+        size -= chunk;
+        if (m_current.size() == m_blockSize && !submit())
+            return false;
+    }
+    return true;
+}
+
+bool QuaGzipMemberWriter::flush()
+{
+    if (!m_current.isEmpty() && !submit())
+        return false;
+    while (!m_pending.empty()) {
+        if (!writeFirst())
+            return false;
+    }
+    return true;
+}
+
+bool QuaGzipMemberWriter::finish()
+{
+    if (m_bgzf) {
+        if (!flush())
+            return false;
+        // the end-of-file marker is an empty member too
+        if (m_io->write(BGZF_EOF, sizeof(BGZF_EOF) - 1) != sizeof(BGZF_EOF) - 1) {
+            m_error = m_io->errorString();
+            return false;
+        }
+        return true;
+    }
+    // even with no data at all, there must be a member
+    if (!m_written && m_pending.empty() && !submit())
+        return false;
+    return flush();
+}
+
+bool QuaGzipMemberWriter::submit()
+{
+    std::unique_ptr<QuaGzipMember> member(new QuaGzipMember());
+    member->input = m_current;
+    m_current = QByteArray();
+    m_current.reserve(m_blockSize);
+    QuaGzipMember *submitted = member.get();
+    m_pending.push_back(std::move(member));
+    const int level = m_level;
+    const bool bgzf = m_bgzf;
+    m_pool.start(QRunnable::create([this, submitted, level, bgzf]() {
+        deflateMember(submitted, level, bgzf);
+        QMutexLocker locker(&m_mutex);
+        submitted->done = true;
+        m_deflated.wakeAll();
+    }));
+    m_written = true;
+    while (m_pending.size() > m_maxPending) {
+        if (!writeFirst())
+            return false;
+    }
+    return true;
+}
+
+bool QuaGzipMemberWriter::writeFirst()
+{
+    QuaGzipMember *member = m_pending.front().get();
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!member->done)
+            m_deflated.wait(&m_mutex);
+    }
+    if (member->error != Z_OK) {
+        m_error = QString::fromLatin1(zError(member->error));
+        return false;
+    }
+    if (m_bgzf && m_compressedOffset != 0 && !member->input.isEmpty())
+        m_blocks.append(qMakePair(m_compressedOffset, m_uncompressedOffset));
+    m_compressedOffset += static_cast<quint64>(member->output.size());
+    m_uncompressedOffset += static_cast<quint64>(member->input.size());
+    const char *data = member->output.constData();
+    qint64 size = member->output.size();
+    while (size > 0) {
+        qint64 written = m_io->write(data, size);
+        if (written <= 0) {
+            m_error = m_io->errorString();
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    m_pending.pop_front();
+    return true;
+}
+
+void QuaGzipMemberWriter::deflateMember(QuaGzipMember *member, int level,
+                                        bool bgzf)
+{
+    const QByteArray &input = member->input;
+    const uLong crc = quazip_crc32(crc32(0L, Z_NULL, 0),
+                            reinterpret_cast<const Bytef*>(input.constData()),
+                            static_cast<uInt>(input.size()));
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    int err = deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8,
+                           Z_DEFAULT_STRATEGY);
+    if (err != Z_OK) {
+        member->error = err;
+        return;
+    }
+    const int headerSize = bgzf ? BGZF_HEADER_SIZE : MEMBER_HEADER_SIZE;
+    QByteArray &output = member->output;
+    output.resize(headerSize
+                  + static_cast<int>(deflateBound(&stream, static_cast<uLong>(input.size())))
+                  + MEMBER_TRAILER_SIZE);
+    char *header = output.data();
+    header[0] = '\x1f';
+    header[1] = '\x8b';
+    header[2] = Z_DEFLATED;
+    header[3] = 4; // FEXTRA
+    putLE32(header + 4, 0); // no time stamp
+    header[8] = 0; // XFL
+    header[9] = '\xff'; // unknown OS
+    putLE16(header + 10, static_cast<quint16>(headerSize - 12)); // XLEN
+    header[12] = bgzf ? QUAGZIP_EXTRA_BGZF_ID1 : QUAGZIP_EXTRA_SIZE_ID1;
+    header[13] = bgzf ? QUAGZIP_EXTRA_BGZF_ID2 : QUAGZIP_EXTRA_SIZE_ID2;
+    putLE16(header + 14, static_cast<quint16>(headerSize - 16)); // LEN
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.constData()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output.data()) + headerSize;
+    stream.avail_out = static_cast<uInt>(output.size() - headerSize
+                                         - MEMBER_TRAILER_SIZE);
+    err = deflate(&stream, Z_FINISH);
+    const int size = headerSize + static_cast<int>(stream.total_out)
+            + MEMBER_TRAILER_SIZE;
+    deflateEnd(&stream);
+    if (err != Z_STREAM_END) {
+        member->error = err == Z_OK ? Z_BUF_ERROR : err;
+        return;
+    }
+    if (bgzf && size > 0x10000) {
+        // can't happen with QUAGZIP_BGZF_BLOCK_SIZE, but just in case
+        member->error = Z_BUF_ERROR;
+        return;
+    }
+    output.resize(size);
+    if (bgzf)
+        putLE16(output.data() + 16, static_cast<quint16>(size - 1));
+    else
+        putLE32(output.data() + 16, static_cast<quint32>(size));
+    putLE32(output.data() + size - 8, static_cast<quint32>(crc));
+    putLE32(output.data() + size - 4, static_cast<quint32>(input.size()));
+}
+
+QuaGzipMemberReader::QuaGzipMemberReader(int threadCount):
+    m_maxPending(static_cast<size_t>(threadCount) * 2)
+{
+    m_pool.setMaxThreadCount(threadCount);
+}
+
+QuaGzipMemberReader::~QuaGzipMemberReader()
+{
+    m_pool.waitForDone();
+}
+
+qint64 QuaGzipMemberReader::memberSize(const char *header, int size, int *needed)
+{
+    // ID1 ID2 CM FLG MTIME(4) XFL OS XLEN(2)
+    if (size < 12) {
+        *needed = 12;
+        return -1;
+    }
+    if (header[0] != '\x1f' || header[1] != '\x8b' || header[2] != Z_DEFLATED
+            || (header[3] & 4) == 0)
+        return 0;
+    const int xlen = getLE16(header + 10);
+    if (size < 12 + xlen) {
+        *needed = 12 + xlen;
+        return -1;
+    }
+    const char *extra = header + 12;
+    const char *end = extra + xlen;
+    while (end - extra >= 4) {
+        const int len = getLE16(extra + 2);
+        qint64 memberSize = 0;
+        if (extra[0] == QUAGZIP_EXTRA_SIZE_ID1
+                && extra[1] == QUAGZIP_EXTRA_SIZE_ID2 && len == 4
+                && end - extra >= 8) {
+            memberSize = getLE32(extra + 4);
+        } else if (extra[0] == QUAGZIP_EXTRA_BGZF_ID1
+                && extra[1] == QUAGZIP_EXTRA_BGZF_ID2 && len == 2
+                && end - extra >= 6) {
+            memberSize = getLE16(extra + 4) + 1;
+        }
+        if (memberSize != 0)
+            return memberSize >= 12 + xlen + MEMBER_TRAILER_SIZE
+                    && memberSize <= MAX_MEMBER_SIZE ? memberSize : 0;
+        extra += 4 + len;
+    }
+    return 0;
+}
+
+void QuaGzipMemberReader::submit(const QByteArray &member, bool truncated)
+{
+    std::unique_ptr<QuaGzipMember> pending(new QuaGzipMember());
+    pending->input = member;
+    pending->truncated = truncated;
+    QuaGzipMember *submitted = pending.get();
+    m_pending.push_back(std::move(pending));
+    m_pool.start(QRunnable::create([this, submitted]() {
+        inflateMember(submitted);
+        QMutexLocker locker(&m_mutex);
+        submitted->done = true;
+        m_inflated.wakeAll();
+    }));
+}
+
+int QuaGzipMemberReader::takeFirst(QByteArray *output)
+{
+    QuaGzipMember *member = m_pending.front().get();
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!member->done)
+            m_inflated.wait(&m_mutex);
+    }
+    const int error = member->error;
+    *output = member->output;
+    m_pending.pop_front();
+    return error;
+}
+
+void QuaGzipMemberReader::clear()
+{
+    m_pool.clear();
+    m_pool.waitForDone();
+    m_pending.clear();
+}
+
+void QuaGzipMemberReader::inflateMember(QuaGzipMember *member)
+{
+    const QByteArray &input = member->input;
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    int err = inflateInit2(&stream, 16 + MAX_WBITS);
+    if (err != Z_OK) {
+        member->error = err;
+        return;
+    }
+    QByteArray &output = member->output;
+    // the trailer tells the size, unless the member is truncated or huge,
+    // but it's not trusted beyond the largest block
+    qint64 expected = input.size() >= MEMBER_TRAILER_SIZE
+            ? getLE32(input.constData() + input.size() - 4) : 0;
+    output.resize(std::min<qint64>(std::max<qint64>(expected, input.size()),
+                                   QuaGzipMemberWriter::MAX_BLOCK_SIZE) + 1);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.constData()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    qsizetype produced = 0;
+    for (;;) {
+        const uInt availOut = static_cast<uInt>(std::min<qsizetype>(
+                output.size() - produced, 0x40000000));
+        stream.next_out = reinterpret_cast<Bytef*>(output.data()) + produced;
+        stream.avail_out = availOut;
+        err = inflate(&stream, Z_NO_FLUSH);
+        produced += availOut - stream.avail_out;
+        if (err == Z_STREAM_END) {
+            // the recorded size must be the member's own
+            err = stream.avail_in == 0 ? Z_OK : Z_DATA_ERROR;
+            break;
+        }
+        if (err != Z_OK && err != Z_BUF_ERROR)
+            break;
+        if (produced == output.size()) {
+            // more than QuaGzipMemberWriter ever puts in a member
+            if (produced > QuaGzipMemberWriter::MAX_BLOCK_SIZE) {
+                err = Z_DATA_ERROR;
+                break;
+            }
+            output.resize(std::min<qsizetype>(output.size() * 2,
+                    QuaGzipMemberWriter::MAX_BLOCK_SIZE + 1));
+        } else if (stream.avail_out != 0 && stream.avail_in == 0) {
+            // the member ended before the stream did, or it's corrupted
+            err = member->truncated ? Z_BUF_ERROR : Z_DATA_ERROR;
+            break;
+        }
+    }
+    inflateEnd(&stream);
+    output.resize(produced);
+    member->error = err;
+}
@@ -0,0 +1,207 @@
+#ifndef QUAZIP_QUAGZIPMEMBERS_H
+#define QUAZIP_QUAGZIPMEMBERS_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QtCore/QByteArray>
+#include <QtCore/QIODevice>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+
+#include <deque>
+#include <memory>
+
+#include <zlib.h>
+
+/// \cond internal
+
+/// The ID of the gzip extra subfield holding the size of the member.
+#define QUAGZIP_EXTRA_SIZE_ID1 'Q'
+#define QUAGZIP_EXTRA_SIZE_ID2 'Z'
+/// The ID of the BGZF extra subfield holding the size of the block less 1.
+#define QUAGZIP_EXTRA_BGZF_ID1 'B'
+#define QUAGZIP_EXTRA_BGZF_ID2 'C'
+/// The largest amount of data in a BGZF block, as in htslib.
+#define QUAGZIP_BGZF_BLOCK_SIZE 0xff00
+
+/// A gzip member and what it is inflated or deflated to.
+struct QuaGzipMember {
+    QByteArray input;
+    /// Reading: \a input was cut short by the end of the stream.
+    bool truncated = false;
+    /// The fields below are written by the worker.
+    QByteArray output;
+    int error = Z_OK;
+    /// Guarded by the mutex of the owner.
+    bool done = false;
+};
+
+/// Writes the data to a device as independent gzip members, deflated in
+/// several threads.
+/**
+  \internal
+
+  The data is cut into blocks of a fixed size, and every block is deflated
+  by a thread of its own into a complete gzip member, just like
+  <tt>pigz --independent</tt> does. As any gzip reader handles concatenated
+  members, the output is an ordinary gzip stream. The total size of each
+  member is stored in the QZ extra subfield of its header, so that a reader
+  can find the next member without inflating this one, see
+  QuaGzipMemberReader::memberSize().
+
+  In the BGZF mode, the blocks are no larger than QUAGZIP_BGZF_BLOCK_SIZE,
+  the size is stored in the BC subfield instead, as BGZF requires, and
+  finish() writes the BGZF end-of-file marker. The offsets of the blocks
+  are recorded then, see blocks().
+
+  The members are written in order by the thread calling write(), flush()
+  and finish(). A limited number of members is kept in flight, so write()
+  blocks if the workers fall behind.
+  */
+class QuaGzipMemberWriter {
+public:
+    /// The default block size.
+    static constexpr int DEFAULT_BLOCK_SIZE = 128 * 1024;
+    /// The largest block size, larger ones are cut down to it.
+    static constexpr int MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+    /// Creates a writer writing to \a io.
+    QuaGzipMemberWriter(QIODevice *io, int threadCount, int blockSize,
+                        int level, bool bgzf = false);
+    /// Waits for the workers, throwing away whatever they produce.
+    ~QuaGzipMemberWriter();
+    /// Adds \a size bytes of data.
+    bool write(const char *data, qint64 size);
+    /// Ends the current member and writes all the members out.
+    bool flush();
+    /// Like flush(), but writes an empty member if nothing is written yet.
+    bool finish();
+    /// The error description after a failure.
+    inline QString errorString() const { return m_error; }
+    /// The compressed and uncompressed offsets of the blocks written.
+    /**
+      Only kept in the BGZF mode. The first block, at 0, and empty ones
+      are not included, which is how a .gzi index lists them.
+      */
+    inline const QList<QPair<quint64, quint64>> &blocks() const { return m_blocks; }
+private:
+    Q_DISABLE_COPY(QuaGzipMemberWriter)
+    static void deflateMember(QuaGzipMember *member, int level, bool bgzf);
+    bool submit();
+    bool writeFirst();
+    QIODevice *m_io;
+    int m_blockSize;
+    int m_level;
+    bool m_bgzf;
+    size_t m_maxPending;
+    bool m_written;
+    QString m_error;
+    quint64 m_compressedOffset;
+    quint64 m_uncompressedOffset;
+    QList<QPair<quint64, quint64>> m_blocks;
+    /// The data not submitted yet.
+    QByteArray m_current;
+    /// The members submitted, in order.
+    std::deque<std::unique_ptr<QuaGzipMember>> m_pending;
+    QMutex m_mutex;
+    QWaitCondition m_deflated;
+    QThreadPool m_pool;
+};
+
+/// Inflates complete gzip members in several threads.
+/**
+  \internal
+
+  The caller cuts the stream into members using memberSize() and submits
+  them in order, then takes the inflated data in the same order.
+  */
+class QuaGzipMemberReader {
+public:
+    /// The largest member size taken from the QZ subfield.
+    /**
+      Twice QuaGzipMemberWriter::MAX_BLOCK_SIZE, which no deflated block
+      gets near. Anything larger isn't written by QuaGzipMemberWriter, so
+      it's not trusted.
+      */
+    static constexpr qint64 MAX_MEMBER_SIZE =
+            2 * static_cast<qint64>(QuaGzipMemberWriter::MAX_BLOCK_SIZE);
+    /// Creates a reader using \a threadCount threads.
+    explicit QuaGzipMemberReader(int threadCount);
+    /// Waits for the workers, throwing away whatever they produce.
+    ~QuaGzipMemberReader();
+    /// Returns the total size of the member starting at \a header.
+    /**
+      \param header The beginning of the member.
+      \param size The number of bytes available at \a header.
+      \param needed Set to the number of bytes needed to tell the size
+      when -1 is returned.
+      \return The size of the member, as recorded in the QZ or the BGZF
+      subfield, 0 if the header doesn't record it (or if it is not a
+      gzip header at all, or the size is more than MAX_MEMBER_SIZE),
+      or -1 if more bytes are needed.
+      */
+    static qint64 memberSize(const char *header, int size, int *needed);
+    /// Starts inflating the \a member.
+    /**
+      \a truncated tells that the stream ended before the size recorded
+      for the member, and only then is the member missing its end not
+      an error.
+      */
+    void submit(const QByteArray &member, bool truncated = false);
+    /// Returns true if enough members are in flight.
+    inline bool isFull() const { return m_pending.size() >= m_maxPending; }
+    /// Returns true if there are no members in flight.
+    inline bool isEmpty() const { return m_pending.empty(); }
+    /// Waits for the first member submitted and takes what it inflates to.
+    /**
+      \return \c Z_OK, \c Z_BUF_ERROR if the member is submitted as
+      truncated and ends early (\a output still gets what could be
+      inflated), or another zlib error. A member that doesn't end exactly
+      at the size recorded, or inflates to more than
+      QuaGzipMemberWriter::MAX_BLOCK_SIZE, is a \c Z_DATA_ERROR.
+      */
+    int takeFirst(QByteArray *output);
+    /// Throws away the members in flight.
+    /**
+      The members not being inflated yet are dropped, the others are
+      waited for.
+      */
+    void clear();
+private:
+    Q_DISABLE_COPY(QuaGzipMemberReader)
+    static void inflateMember(QuaGzipMember *member);
+    size_t m_maxPending;
+    /// The members submitted, in order.
+    std::deque<std::unique_ptr<QuaGzipMember>> m_pending;
+    QMutex m_mutex;
+    QWaitCondition m_inflated;
+    QThreadPool m_pool;
+};
+
+/// \endcond
+
+#endif // QUAZIP_QUAGZIPMEMBERS_H
@@ -28,6 +28,7 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #define QUAZIO_INBUFSIZE 4096
 #define QUAZIO_OUTBUFSIZE 4096
+#define QUAZIO_MEMLEVEL 8
 
 /// \cond internal
 class QuaZIODevicePrivate {
@@ -41,13 +42,22 @@ class QuaZIODevicePrivate {
     char *inBuf{nullptr};
     int inBufPos{0};
     int inBufSize{0};
+    int inBufCapacity{QUAZIO_INBUFSIZE};
     char *outBuf{nullptr};
     int outBufPos{0};
     int outBufSize{0};
+    int outBufCapacity{QUAZIO_OUTBUFSIZE};
+    int inBufferSize{QUAZIO_INBUFSIZE};
+    int outBufferSize{QUAZIO_OUTBUFSIZE};
+    int level{Z_DEFAULT_COMPRESSION};
+    int strategy{Z_DEFAULT_STRATEGY};
+    int windowBits{MAX_WBITS};
+    int memLevel{QUAZIO_MEMLEVEL};
     bool zBufError{false};
     bool atEnd{false};
     bool flush(int sync);
     int doFlush(QString &error);
+    void resetBuffers();
 };
 
 QuaZIODevicePrivate::QuaZIODevicePrivate(QIODevice *_io, QuaZIODevice *_q):
@@ -60,8 +70,8 @@ QuaZIODevicePrivate::QuaZIODevicePrivate(QIODevice *_io, QuaZIODevice *_q):
   zouts.zalloc = (alloc_func) nullptr;
   zouts.zfree = (free_func) nullptr;
   zouts.opaque = nullptr;
-  inBuf = new char[QUAZIO_INBUFSIZE];
-  outBuf = new char[QUAZIO_OUTBUFSIZE];
+  inBuf = new char[inBufCapacity];
+  outBuf = new char[outBufCapacity];
 #ifdef QUAZIP_ZIODEVICE_DEBUG_OUTPUT
   debug.setFileName("debug.out");
   debug.open(QIODevice::WriteOnly);
@@ -99,7 +109,7 @@ bool QuaZIODevicePrivate::flush(int sync)
     zouts.avail_in = 0; // of zero size
     do {
         zouts.next_out = reinterpret_cast<Bytef *>(outBuf);
-        zouts.avail_out = QUAZIO_OUTBUFSIZE;
+        zouts.avail_out = outBufCapacity;
         int result = deflate(&zouts, sync);
         switch (result) {
         case Z_OK:
@@ -142,6 +152,23 @@ int QuaZIODevicePrivate::doFlush(QString &error)
   return flushed;
 }
 
+void QuaZIODevicePrivate::resetBuffers()
+{
+  if (inBufferSize != inBufCapacity) {
+    delete[] inBuf;
+    inBuf = new char[inBufferSize];
+    inBufCapacity = inBufferSize;
+  }
+  if (outBufferSize != outBufCapacity) {
+    delete[] outBuf;
+    outBuf = new char[outBufferSize];
+    outBufCapacity = outBufferSize;
+  }
+  inBufPos = inBufSize = 0;
+  outBufPos = outBufSize = 0;
+  atEnd = false;
+}
+
 /// \endcond
 
 // #define QUAZIP_ZIODEVICE_DEBUG_OUTPUT
@@ -174,6 +201,66 @@ QIODevice *QuaZIODevice::getIoDevice() const
     return d->io;
 }
 
+void QuaZIODevice::setInputBufferSize(int size)
+{
+    d->inBufferSize = size > 0 ? size : QUAZIO_INBUFSIZE;
+}
+
+int QuaZIODevice::getInputBufferSize() const
+{
+    return d->inBufferSize;
+}
+
+void QuaZIODevice::setOutputBufferSize(int size)
+{
+    d->outBufferSize = size > 0 ? size : QUAZIO_OUTBUFSIZE;
+}
+
+int QuaZIODevice::getOutputBufferSize() const
+{
+    return d->outBufferSize;
+}
+
+void QuaZIODevice::setCompressionLevel(int level)
+{
+    d->level = level;
+}
+
+int QuaZIODevice::getCompressionLevel() const
+{
+    return d->level;
+}
+
+void QuaZIODevice::setStrategy(int strategy)
+{
+    d->strategy = strategy;
+}
+
+int QuaZIODevice::getStrategy() const
+{
+    return d->strategy;
+}
+
+void QuaZIODevice::setWindowBits(int windowBits)
+{
+    d->windowBits = windowBits;
+}
+
+int QuaZIODevice::getWindowBits() const
+{
+    return d->windowBits;
+}
+
+void QuaZIODevice::setMemLevel(int memLevel)
+{
+    d->memLevel = memLevel;
+}
+
+int QuaZIODevice::getMemLevel() const
+{
+    return d->memLevel;
+}
+
 bool QuaZIODevice::open(QIODevice::OpenMode mode)
 {
     if ((mode & QIODevice::Append) != 0) {
@@ -186,14 +273,16 @@ bool QuaZIODevice::open(QIODevice::OpenMode mode)
                     " QuaZIODevice"));
         return false;
     }
+    d->resetBuffers();
     if ((mode & QIODevice::ReadOnly) != 0) {
-        if (inflateInit(&d->zins) != Z_OK) {
+        if (inflateInit2(&d->zins, d->windowBits) != Z_OK) {
             setErrorString(QString::fromLocal8Bit(d->zins.msg));
             return false;
         }
     }
     if ((mode & QIODevice::WriteOnly) != 0) {
-        if (deflateInit(&d->zouts, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        if (deflateInit2(&d->zouts, d->level, Z_DEFLATED, d->windowBits,
+                    d->memLevel, d->strategy) != Z_OK) {
             setErrorString(QString::fromLocal8Bit(d->zouts.msg));
             return false;
         }
@@ -223,7 +312,7 @@ qint64 QuaZIODevice::readData(char *data, qint64 maxSize)
   while (read < maxSize) {
     if (d->inBufPos == d->inBufSize) {
       d->inBufPos = 0;
-      d->inBufSize = d->io->read(d->inBuf, QUAZIO_INBUFSIZE);
+      d->inBufSize = d->io->read(d->inBuf, d->inBufCapacity);
       if (d->inBufSize == -1) {
         d->inBufSize = 0;
         setErrorString(d->io->errorString());
@@ -257,7 +346,7 @@ qint64 QuaZIODevice::readData(char *data, qint64 maxSize)
         memmove(d->inBuf, d->inBuf + d->inBufPos, d->inBufSize - d->inBufPos);
         d->inBufSize -= d->inBufPos;
         d->inBufPos = 0;
-        more = d->io->read(d->inBuf + d->inBufSize, QUAZIO_INBUFSIZE - d->inBufSize);
+        more = d->io->read(d->inBuf + d->inBufSize, d->inBufCapacity - d->inBufSize);
         if (more == -1) {
           setErrorString(d->io->errorString());
           return -1;
@@ -293,7 +382,7 @@ qint64 QuaZIODevice::writeData(const char *data, qint64 maxSize)
     d->zouts.next_in = (Bytef *) (data + written);
     d->zouts.avail_in = static_cast<uInt>(maxSize - written); // hope it's less than 2GB
     d->zouts.next_out = reinterpret_cast<Bytef *>(d->outBuf);
-    d->zouts.avail_out = QUAZIO_OUTBUFSIZE;
+    d->zouts.avail_out = d->outBufCapacity;
     switch (deflate(&d->zouts, Z_NO_FLUSH)) {
     case Z_OK:
       written = reinterpret_cast<z_const char *>(d->zouts.next_in) - data;
@@ -84,6 +84,63 @@ public:
   void close() override;
   /// Returns the underlying device.
   QIODevice *getIoDevice() const;
+  /// Sets the size of the buffer for the compressed data read.
+  /**
+    This is how much is read from the underlying device at once. The
+    default is 4096 bytes, which may mean a lot of small reads from a
+    socket or a file. Zero or less restores the default. Takes effect
+    on the next open().
+    */
+  void setInputBufferSize(int size);
+  /// Returns the size of the buffer for the compressed data read.
+  int getInputBufferSize() const;
+  /// Sets the size of the buffer for the compressed data written.
+  /**
+    The compressed data is written to the underlying device in chunks
+    of up to this size. The default is 4096 bytes, zero or less restores
+    it. Takes effect on the next open().
+    */
+  void setOutputBufferSize(int size);
+  /// Returns the size of the buffer for the compressed data written.
+  int getOutputBufferSize() const;
+  /// Sets the compression level.
+  /**
+    The default is Z_DEFAULT_COMPRESSION. Takes effect on the next
+    open() for writing. See deflateInit2() in zlib.
+    */
+  void setCompressionLevel(int level);
+  /// Returns the compression level.
+  int getCompressionLevel() const;
+  /// Sets the compression strategy.
+  /**
+    The default is Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE
+    and Z_FIXED may suit some kinds of data better. Takes effect on the
+    next open() for writing. See deflateInit2() in zlib.
+    */
+  void setStrategy(int strategy);
+  /// Returns the compression strategy.
+  int getStrategy() const;
+  /// Sets the window size and the framing of the stream.
+  /**
+    The default is MAX_WBITS, a zlib stream with the largest window.
+    The value is passed to deflateInit2() or inflateInit2(), so 8..15
+    mean a zlib stream, -8..-15 mean a raw deflate stream, and adding
+    16 gives a gzip stream. When reading, adding 32 detects the zlib or
+    gzip header automatically. The stream must be read with a window
+    at least as large as it was written with. Takes effect on the next
+    open().
+    */
+  void setWindowBits(int windowBits);
+  /// Returns the window size and the framing of the stream.
+  int getWindowBits() const;
+  /// Sets the amount of memory used for the compression state.
+  /**
+    From 1 to 9, the default is 8 (DEF_MEM_LEVEL in zlib). Takes effect
+    on the next open() for writing. See deflateInit2() in zlib.
+    */
+  void setMemLevel(int memLevel);
+  /// Returns the amount of memory used for the compression state.
+  int getMemLevel() const;
   /// Returns true.
   bool isSequential() const override;
   /// Returns true iff the end of the compressed stream is reached.
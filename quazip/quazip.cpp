@@ -22,11 +22,17 @@ Original ZIP package is copyrighted by Gilles Vollant, see
 quazip/(un)zip.h files for details, basically it's zlib license.
  **/
 
+#include <QtCore/QDateTime>
 #include <QtCore/QFile>
 #include <QtCore/QFlags>
 #include <QtCore/QHash>
+#include <QtCore/QSaveFile>
+#include <QtCore/QSharedPointer>
+
+#include <algorithm>
 
 #include "quazip.h"
+#include "quazipcatalog.h"
 
 #define QUAZIP_OS_UNIX 3u
 
@@ -72,6 +78,32 @@ class QuaZipPrivate {
     bool utf8;
     /// The OS code.
     uint osCode;
+    /// Whether the catalog is built on open.
+    bool catalogEnabled;
+    /// Whether the name index is built on open.
+    bool nameIndexEnabled;
+    /// The file the catalog is saved to and loaded from.
+    QString catalogFileName;
+    /// The device the catalog is saved to and loaded from.
+    QIODevice *catalogDevice;
+    /// Whether the archive is memory-mapped in the mdUnzip mode.
+    bool memoryMappingEnabled;
+    /// Whether the archive is read with pread() in the mdUnzip mode.
+    bool positionalReadEnabled;
+    /// The size of the read-ahead window, zero if reads aren't cached.
+    int readAheadSize;
+    /// Whether the next window is read in the background.
+    bool prefetchEnabled;
+    /// How many files are expected to be added, see QuaZip::setExpectedEntryCount().
+    qint64 expectedEntryCount;
+    /// The size of the write buffer, zero if writes aren't buffered.
+    int writeBufferSize;
+    /// Whether opened by QuaZip::openShared(), with the device of another QuaZip.
+    bool shared;
+    /// The catalog, if it has been built.
+    QSharedPointer<const QuaZipCatalog> catalog;
+    /// The catalog entries sorted by name, built on the first prefix lookup.
+    QList<QPair<QString, qint64> > sortedNames;
     /// The constructor for the corresponding QuaZip constructor.
     inline QuaZipPrivate(QuaZip *_q):
       q(_q),
@@ -83,7 +115,17 @@ class QuaZipPrivate {
       zip64(false),
       autoClose(true),
       utf8(false),
-      osCode(defaultOsCode)
+      osCode(defaultOsCode),
+      catalogEnabled(false),
+      nameIndexEnabled(false),
+      catalogDevice(nullptr),
+      memoryMappingEnabled(false),
+      positionalReadEnabled(false),
+      readAheadSize(0),
+      prefetchEnabled(false),
+      expectedEntryCount(0),
+      writeBufferSize(0),
+      shared(false)
     {
         unzFile_f = nullptr;
         zipFile_f = nullptr;
@@ -102,7 +144,17 @@ class QuaZipPrivate {
       zip64(false),
       autoClose(true),
       utf8(false),
-      osCode(defaultOsCode)
+      osCode(defaultOsCode),
+      catalogEnabled(false),
+      nameIndexEnabled(false),
+      catalogDevice(nullptr),
+      memoryMappingEnabled(false),
+      positionalReadEnabled(false),
+      readAheadSize(0),
+      prefetchEnabled(false),
+      expectedEntryCount(0),
+      writeBufferSize(0),
+      shared(false)
     {
         unzFile_f = nullptr;
         zipFile_f = nullptr;
@@ -120,7 +172,17 @@ class QuaZipPrivate {
       zip64(false),
       autoClose(true),
       utf8(false),
-      osCode(defaultOsCode)
+      osCode(defaultOsCode),
+      catalogEnabled(false),
+      nameIndexEnabled(false),
+      catalogDevice(nullptr),
+      memoryMappingEnabled(false),
+      positionalReadEnabled(false),
+      readAheadSize(0),
+      prefetchEnabled(false),
+      expectedEntryCount(0),
+      writeBufferSize(0),
+      shared(false)
     {
         unzFile_f = nullptr;
         zipFile_f = nullptr;
@@ -130,6 +192,20 @@ class QuaZipPrivate {
     /// Returns either a list of file names or a list of QuaZipFileInfo.
     template<typename TFileInfo>
         bool getFileInfoList(QList<TFileInfo> *result) const;
+    /// Returns whether the catalog is saved to a file or a device.
+    inline bool hasSavedCatalog() const
+    {
+        return (catalogEnabled || nameIndexEnabled)
+                && (!catalogFileName.isEmpty() || catalogDevice != nullptr);
+    }
+    /// Identifies the open archive for the saved catalog.
+    QuaZipCatalog::Source catalogSource() const;
+    /// Builds or loads the catalog if it is enabled.
+    void buildCatalog();
+    /// Fills \a fileFunc with the mapped, read-ahead or positional read functions.
+    /** The mapped ones are used if memory mapping is enabled, the
+     * read-ahead ones if the read-ahead size is set. */
+    void fillReadOnlyFileFunc(zlib_filefunc64_32_def *fileFunc) const;
 
     /// Stores map of filenames and file locations for unzipping
       inline void clearDirectoryMap();
@@ -191,6 +267,92 @@ bool QuaZipPrivate::goToFirstUnmappedFile()
     return hasCurrentFile_f;
 }
 
+QuaZipCatalog::Source QuaZipPrivate::catalogSource() const
+{
+    QuaZipCatalog::Source source;
+    unzGetCentralDirInfo64(unzFile_f, &source.centralPos,
+                           &source.centralDirOffset, &source.centralDirSize);
+    unz_global_info64 globalInfo;
+    unzGetGlobalInfo64(unzFile_f, &globalInfo);
+    source.entryCount = globalInfo.number_entry;
+    source.archiveSize = ioDevice->size();
+    source.modificationTime = -1;
+    QFileDevice *file = qobject_cast<QFileDevice*>(ioDevice);
+    if (file != nullptr) {
+        QDateTime modified = file->fileTime(QFileDevice::FileModificationTime);
+        if (modified.isValid())
+            source.modificationTime = modified.toMSecsSinceEpoch();
+    }
+    return source;
+}
+
+void QuaZipPrivate::buildCatalog()
+{
+    catalog.reset();
+    sortedNames.clear();
+    if (!catalogEnabled && !nameIndexEnabled)
+        return;
+    bool saved = hasSavedCatalog();
+    QuaZipCatalog::Source source;
+    if (saved) {
+        source = catalogSource();
+        QuaZipCatalog *loaded = !catalogFileName.isEmpty()
+                ? QuaZipCatalog::load(catalogFileName, source, nameIndexEnabled)
+                : QuaZipCatalog::load(catalogDevice, source, nameIndexEnabled);
+        if (loaded != nullptr) {
+            catalog.reset(loaded);
+            return;
+        }
+        // opened with UNZ_DEFER_CENTRAL_DIR, but the walk needs it now
+        unzLoadCentralDir(unzFile_f);
+    }
+    int error = UNZ_OK;
+    QuaZipCatalog *built = QuaZipCatalog::build(unzFile_f, &error);
+    if (built == nullptr) {
+        // not fatal, everything works without the catalog
+        qWarning("QuaZip::open(): failed to build the catalog: %d", error);
+        return;
+    }
+    if (nameIndexEnabled)
+        built->buildNameIndex();
+    catalog.reset(built);
+    if (!saved)
+        return;
+    bool written;
+    if (!catalogFileName.isEmpty()) {
+        QSaveFile file(catalogFileName);
+        written = file.open(QIODevice::WriteOnly) && built->save(&file, source)
+                && file.commit();
+    } else {
+        written = catalogDevice->isWritable() && catalogDevice->seek(0)
+                && built->save(catalogDevice, source);
+        QFileDevice *file = qobject_cast<QFileDevice*>(catalogDevice);
+        if (written && file != nullptr)
+            written = file->resize(file->pos());
+    }
+    if (!written)
+        qWarning("QuaZip::open(): failed to save the catalog");
+}
+
+void QuaZipPrivate::fillReadOnlyFileFunc(zlib_filefunc64_32_def *fileFunc) const
+{
+    if (memoryMappingEnabled) {
+        fill_qiodevice64_mapped_filefunc(&fileFunc->zfile_func64);
+        fileFunc->zview64_file = qiodevice_mapped_view_file_func;
+    } else if (readAheadSize > 0) {
+        fill_qiodevice64_readahead_filefunc(&fileFunc->zfile_func64, readAheadSize,
+                                            prefetchEnabled ? 1 : 0);
+        fileFunc->zview64_file = nullptr;
+    } else {
+        fill_qiodevice64_positional_filefunc(&fileFunc->zfile_func64);
+        fileFunc->zview64_file = nullptr;
+    }
+    fileFunc->zopen32_file = nullptr;
+    fileFunc->ztell32_file = nullptr;
+    fileFunc->zseek32_file = nullptr;
+    fileFunc->zflush64_file = nullptr;
+}
+
 QuaZip::QuaZip():
   p(new QuaZipPrivate(this))
 {
@@ -234,7 +396,17 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
       if (ioApi == nullptr) {
           if (p->autoClose)
               flags |= UNZ_AUTO_CLOSE;
-          p->unzFile_f=unzOpenInternal(ioDevice, nullptr, 1, flags);
+          // the saved catalog, if valid, makes the directory unnecessary
+          if (p->hasSavedCatalog())
+              flags |= UNZ_DEFER_CENTRAL_DIR;
+          if (p->memoryMappingEnabled || p->positionalReadEnabled
+                  || p->readAheadSize > 0) {
+              zlib_filefunc64_32_def readOnly;
+              p->fillReadOnlyFileFunc(&readOnly);
+              p->unzFile_f=unzOpenInternal(ioDevice, &readOnly, 1, flags);
+          } else {
+              p->unzFile_f=unzOpenInternal(ioDevice, nullptr, 1, flags);
+          }
       } else {
           // QuaZip pre-zip64 compatibility mode
           p->unzFile_f=unzOpen2(ioDevice, ioApi);
@@ -261,6 +433,7 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
       }
       p->mode = mode;
       p->ioDevice = ioDevice;
+      p->buildCatalog();
       return true;
 
     case mdCreate:
@@ -273,11 +446,21 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
               flags |= ZIP_WRITE_DATA_DESCRIPTOR;
           if (p->utf8)
               flags |= ZIP_ENCODING_UTF8;
+          zlib_filefunc64_32_def buffered;
+          if (p->writeBufferSize > 0) {
+              fill_qiodevice64_buffered_filefunc(&buffered.zfile_func64,
+                                                 p->writeBufferSize);
+              buffered.zopen32_file = nullptr;
+              buffered.ztell32_file = nullptr;
+              buffered.zseek32_file = nullptr;
+              buffered.zview64_file = nullptr;
+              buffered.zflush64_file = qiodevice_buffered_flush_file_func;
+          }
           p->zipFile_f=zipOpen3(ioDevice,
               mode==mdCreate?APPEND_STATUS_CREATE:
               mode==mdAppend?APPEND_STATUS_CREATEAFTER:
               APPEND_STATUS_ADDINZIP,
-              nullptr, nullptr, flags);
+              nullptr, p->writeBufferSize > 0 ? &buffered : nullptr, flags);
       } else {
           // QuaZip pre-zip64 compatibility mode
           p->zipFile_f=zipOpen2(ioDevice,
@@ -306,6 +489,12 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
         }
         zipSetFlags(p->zipFile_f, ZIP_SEQUENTIAL);
       }
+      if (p->expectedEntryCount > 0
+              && zipReserveCentralDir(p->zipFile_f,
+                      static_cast<ZPOS64_T>(p->expectedEntryCount)) != ZIP_OK) {
+        qWarning("QuaZip::open(): can't reserve memory for %lld entries",
+                 static_cast<long long>(p->expectedEntryCount));
+      }
       p->mode=mode;
       p->ioDevice = ioDevice;
       return true;
@@ -319,6 +508,37 @@ bool QuaZip::open(Mode mode, zlib_filefunc_def* ioApi)
   }
 }
 
+bool QuaZip::openShared(const QuaZip &other)
+{
+  p->zipError=UNZ_OK;
+  if(isOpen()) {
+    qWarning("QuaZip::openShared(): ZIP already opened");
+    return false;
+  }
+  if (other.p->mode != mdUnzip) {
+    qWarning("QuaZip::openShared(): the other ZIP is not open in mdUnzip mode");
+    return false;
+  }
+  zlib_filefunc64_32_def readOnly;
+  p->fillReadOnlyFileFunc(&readOnly);
+  // with the name index, setCurrentFile() never walks the directory, so
+  // don't even load it; without it, the walk would load it anyway
+  unsigned flags = other.p->catalog && other.p->catalog->hasNameIndex()
+          ? UNZ_DEFER_CENTRAL_DIR : 0u;
+  p->unzFile_f = unzOpenShared(other.p->unzFile_f, &readOnly, flags);
+  if (p->unzFile_f == nullptr) {
+    p->zipError = UNZ_OPENERROR;
+    return false;
+  }
+  p->mode = mdUnzip;
+  p->zipName = QString();
+  p->ioDevice = other.p->ioDevice;
+  p->shared = true;
+  p->catalog = other.p->catalog;
+  p->hasCurrentFile_f = false;
+  return true;
+}
+
 void QuaZip::close()
 {
   p->zipError=UNZ_OK;
@@ -342,7 +562,14 @@ void QuaZip::close()
       delete p->ioDevice;
       p->ioDevice = nullptr;
   }
+  // the device belongs to the other QuaZip and may be gone after it closes
+  if (p->shared) {
+      p->ioDevice = nullptr;
+      p->shared = false;
+  }
   p->clearDirectoryMap();
+  p->catalog.reset();
+  p->sortedNames.clear();
   p->mode=mdNotOpen;
 }
 
@@ -374,6 +601,8 @@ int QuaZip::getEntriesCount()const
     qWarning("QuaZip::getEntriesCount(): ZIP is not open in mdUnzip mode");
     return -1;
   }
+  if (p->catalog)
+    return static_cast<int>(p->catalog->count());
   unz_global_info64 globalInfo;
   if((fakeThis->p->zipError=unzGetGlobalInfo64(p->unzFile_f, &globalInfo))!=UNZ_OK)
     return p->zipError;
@@ -425,6 +654,18 @@ bool QuaZip::setCurrentFile(const QString& fileName, CaseSensitivity cs)
   if(!sens) lower=fileName.toLower();
   p->hasCurrentFile_f=false;
 
+  // The name index has every entry in it, no need to look any further
+  if (p->catalog && p->catalog->hasNameIndex()) {
+      qint64 index = p->catalog->indexOf(fileName,
+              sens ? Qt::CaseSensitive : Qt::CaseInsensitive);
+      if (index < 0)
+          return false;
+      unz64_file_pos indexedPos = p->catalog->filePos(index);
+      p->zipError = unzGoToFilePos64(p->unzFile_f, &indexedPos);
+      p->hasCurrentFile_f = p->zipError == UNZ_OK;
+      return p->hasCurrentFile_f;
+  }
+
   // Check the appropriate Map
   unz64_file_pos fileDirPos;
   fileDirPos.pos_in_zip_directory = 0;
@@ -483,6 +724,42 @@ bool QuaZip::goToNextFile()
   return p->hasCurrentFile_f;
 }
 
+bool QuaZip::setCurrentFileIndex(qint64 index)
+{
+  p->zipError=UNZ_OK;
+  if(p->mode!=mdUnzip) {
+    qWarning("QuaZip::setCurrentFileIndex(): ZIP is not open in mdUnzip mode");
+    return false;
+  }
+  if (p->catalog) {
+    if (index < 0 || index >= p->catalog->count()) {
+      p->hasCurrentFile_f = false;
+      return false;
+    }
+    unz64_file_pos pos = p->catalog->filePos(index);
+    p->zipError = unzGoToFilePos64(p->unzFile_f, &pos);
+    p->hasCurrentFile_f = p->zipError == UNZ_OK;
+    return p->hasCurrentFile_f;
+  }
+  if (index < 0) {
+    p->hasCurrentFile_f = false;
+    return false;
+  }
+  unz64_file_pos pos;
+  qint64 current = 0;
+  if (p->hasCurrentFile_f && unzGetFilePos64(p->unzFile_f, &pos) == UNZ_OK
+          && static_cast<qint64>(pos.num_of_file) <= index) {
+    current = static_cast<qint64>(pos.num_of_file);
+  } else if (!goToFirstFile()) {
+    return false;
+  }
+  for (; current < index; ++current) {
+    if (!goToNextFile())
+      return false;
+  }
+  return true;
+}
+
 bool QuaZip::getCurrentFileInfo(QuaZipFileInfo *info)const
 {
     QuaZipFileInfo64 info64;
@@ -658,6 +935,33 @@ QString QuaZip_getFileInfo(QuaZip *zip, bool *ok)
     return name;
 }
 
+template<typename TFileInfo>
+TFileInfo QuaZip_getCatalogInfo(const QuaZipCatalog &catalog, qint64 index);
+
+template<>
+QuaZipFileInfo QuaZip_getCatalogInfo(const QuaZipCatalog &catalog, qint64 index)
+{
+    QuaZipFileInfo64 info64;
+    QuaZipFileInfo info;
+    catalog.fileInfo(index, &info64);
+    info64.toQuaZipFileInfo(info);
+    return info;
+}
+
+template<>
+QuaZipFileInfo64 QuaZip_getCatalogInfo(const QuaZipCatalog &catalog, qint64 index)
+{
+    QuaZipFileInfo64 info;
+    catalog.fileInfo(index, &info);
+    return info;
+}
+
+template<>
+QString QuaZip_getCatalogInfo(const QuaZipCatalog &catalog, qint64 index)
+{
+    return catalog.name(index);
+}
+
 template<typename TFileInfo>
 bool QuaZipPrivate::getFileInfoList(QList<TFileInfo> *result) const
 {
@@ -668,6 +972,12 @@ bool QuaZipPrivate::getFileInfoList(QList<TFileInfo> *result) const
             "ZIP is not open in mdUnzip mode");
     return false;
   }
+  if (catalog) {
+      result->reserve(catalog->count());
+      for (qint64 i = 0; i < catalog->count(); ++i)
+          result->append(QuaZip_getCatalogInfo<TFileInfo>(*catalog, i));
+      return true;
+  }
   QString currentFile;
   if (q->hasCurrentFile()) {
       currentFile = q->getCurrentFileName();
@@ -716,6 +1026,42 @@ QList<QuaZipFileInfo64> QuaZip::getFileInfoList64() const
     return list;
 }
 
+QList<QuaZipFileInfo64> QuaZip::getFileInfoList64(const QString &prefix) const
+{
+    if (!p->catalog) {
+        QList<QuaZipFileInfo64> list;
+        const QList<QuaZipFileInfo64> all = getFileInfoList64();
+        for (const QuaZipFileInfo64 &info : all) {
+            if (info.name.startsWith(prefix))
+                list.append(info);
+        }
+        return list;
+    }
+    p->zipError = UNZ_OK;
+    const QuaZipCatalog &catalog = *p->catalog;
+    QList<QPair<QString, qint64> > &sorted = p->sortedNames;
+    if (sorted.isEmpty() && catalog.count() != 0) {
+        sorted.reserve(catalog.count());
+        for (qint64 i = 0; i < catalog.count(); ++i)
+            sorted.append(qMakePair(catalog.name(i), i));
+        std::sort(sorted.begin(), sorted.end());
+    }
+    // the names starting with the prefix come right after it
+    auto it = std::lower_bound(sorted.cbegin(), sorted.cend(), prefix,
+            [](const QPair<QString, qint64> &entry, const QString &name) {
+                return entry.first < name;
+            });
+    QList<qint64> indexes;
+    for (; it != sorted.cend() && it->first.startsWith(prefix); ++it)
+        indexes.append(it->second);
+    std::sort(indexes.begin(), indexes.end());
+    QList<QuaZipFileInfo64> list;
+    list.reserve(indexes.size());
+    for (qint64 index : indexes)
+        list.append(QuaZip_getCatalogInfo<QuaZipFileInfo64>(catalog, index));
+    return list;
+}
+
 Qt::CaseSensitivity QuaZip::convertCaseSensitivity(QuaZip::CaseSensitivity cs)
 {
   if (cs == csDefault) {
@@ -768,3 +1114,103 @@ void QuaZip::setAutoClose(bool autoClose) const
 {
     p->autoClose = autoClose;
 }
+
+void QuaZip::setCatalogEnabled(bool enabled)
+{
+    p->catalogEnabled = enabled;
+}
+
+bool QuaZip::isCatalogEnabled() const
+{
+    return p->catalogEnabled;
+}
+
+void QuaZip::setNameIndexEnabled(bool enabled)
+{
+    p->nameIndexEnabled = enabled;
+}
+
+bool QuaZip::isNameIndexEnabled() const
+{
+    return p->nameIndexEnabled;
+}
+
+void QuaZip::setCatalogFileName(const QString &fileName)
+{
+    p->catalogFileName = fileName;
+}
+
+QString QuaZip::getCatalogFileName() const
+{
+    return p->catalogFileName;
+}
+
+void QuaZip::setCatalogDevice(QIODevice *device)
+{
+    p->catalogDevice = device;
+}
+
+QIODevice *QuaZip::getCatalogDevice() const
+{
+    return p->catalogDevice;
+}
+
+void QuaZip::setMemoryMappingEnabled(bool enabled)
+{
+    p->memoryMappingEnabled = enabled;
+}
+
+bool QuaZip::isMemoryMappingEnabled() const
+{
+    return p->memoryMappingEnabled;
+}
+
+void QuaZip::setPositionalReadEnabled(bool enabled)
+{
+    p->positionalReadEnabled = enabled;
+}
+
+bool QuaZip::isPositionalReadEnabled() const
+{
+    return p->positionalReadEnabled;
+}
+
+void QuaZip::setReadAheadSize(int size)
+{
+    p->readAheadSize = qMax(size, 0);
+}
+
+int QuaZip::getReadAheadSize() const
+{
+    return p->readAheadSize;
+}
+
+void QuaZip::setPrefetchEnabled(bool enabled)
+{
+    p->prefetchEnabled = enabled;
+}
+
+bool QuaZip::isPrefetchEnabled() const
+{
+    return p->prefetchEnabled;
+}
+
+void QuaZip::setExpectedEntryCount(qint64 count)
+{
+    p->expectedEntryCount = count;
+}
+
+qint64 QuaZip::getExpectedEntryCount() const
+{
+    return p->expectedEntryCount;
+}
+
+void QuaZip::setWriteBufferSize(int size)
+{
+    p->writeBufferSize = qMax(size, 0);
+}
+
+int QuaZip::getWriteBufferSize() const
+{
+    return p->writeBufferSize;
+}
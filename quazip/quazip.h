@@ -191,6 +191,37 @@ class QUAZIP_EXPORT QuaZip {
      * fine.
      **/
     bool open(Mode mode, zlib_filefunc_def *ioApi =nullptr);
+    /// Opens the archive that \a other is reading, sharing what it has read.
+    /**
+     * \a other must be open in the mdUnzip mode. This QuaZip is then opened
+     * in the mdUnzip mode on the same device, without parsing anything
+     * again: the location of the central directory and the
+     * \ref setCatalogEnabled() "catalog" (including the name index), if
+     * \a other has one, are shared. Only if there is no
+     * \ref setNameIndexEnabled() "name index", the central directory is
+     * read, since setCurrentFile() needs it then. This QuaZip has its own
+     * current file and can have a QuaZipFile open independently of
+     * \a other.
+     *
+     * The device is always read with
+     * \ref setPositionalReadEnabled() "positional reads", or
+     * \ref setMemoryMappingEnabled() "memory-mapped" if that is enabled for
+     * this QuaZip (with \ref setReadAheadSize() "read-ahead", if that is
+     * set), so that several QuaZip objects opened this way can read
+     * the archive from different threads at the same time, alongside
+     * \a other. If the device has no native handle (a QBuffer, for
+     * example), \a other must use positional reads too for that. This
+     * function itself must not be called while \a other is used from
+     * another thread.
+     *
+     * The zip name or the device of this QuaZip is replaced by the device
+     * of \a other, which must stay open until this QuaZip is closed. Closing
+     * this QuaZip never closes the device, and leaves it with neither a
+     * zip name nor a device.
+     *
+     * \return \c true if successful, \c false otherwise.
+     **/
+    bool openShared(const QuaZip &other);
     /// Closes ZIP file.
     /** Call getZipError() to determine if the close was successful.
      *
@@ -310,6 +341,18 @@ class QUAZIP_EXPORT QuaZip {
      * \endcode
      **/
     bool goToNextFile();
+    /// Sets the current file to the file with the given index.
+    /** The index is the position of the file in the central directory,
+     * that is, in the lists returned by getFileNameList() and
+     * getFileInfoList64(). If the \ref setCatalogEnabled() "catalog" is
+     * enabled, this takes constant time, otherwise the directory is walked
+     * from the current or the first file.
+     *
+     * \return \c true on success, \c false if there is no such file or
+     * an error occurred, in which case getZipError() returns the error
+     * code, or \c UNZ_OK if the index is just out of range.
+     **/
+    bool setCurrentFileIndex(qint64 index);
     /// Sets current file by its name.
     /** Returns \c true if successful, \c false otherwise. Argument \a
      * cs specifies case sensitivity of the file name. Call
@@ -468,6 +511,21 @@ class QUAZIP_EXPORT QuaZip {
       \sa getFileInfoList()
       */
     QList<QuaZipFileInfo64> getFileInfoList64() const;
+    /// Returns information about the files whose names start with \a prefix.
+    /**
+      \overload
+
+      The files are listed in the same order as by getFileInfoList64(),
+      and the names are compared case-sensitively. If the
+      \ref setCatalogEnabled() "catalog" is enabled, the first call sorts
+      the names once, and every call after that only takes time
+      proportional to the number of files found, which makes listing a
+      directory of a large archive cheap. Otherwise, the whole directory
+      is walked. QuaZipDir lists directories this way.
+
+      \sa getFileInfoList64()
+      */
+    QList<QuaZipFileInfo64> getFileInfoList64(const QString &prefix) const;
     /// Enables the zip64 mode.
     /**
      * @param zip64 If \c true, the zip64 mode is enabled, disabled otherwise.
@@ -539,6 +597,252 @@ class QUAZIP_EXPORT QuaZip {
       @sa setIoDevice()
       */
     void setAutoClose(bool autoClose) const;
+    /// Enables or disables the catalog.
+    /**
+      If enabled, the whole central directory is parsed once when the
+      archive is opened in the mdUnzip mode and kept in memory in a compact
+      form. getEntriesCount(), getFileNameList(), getFileInfoList(),
+      getFileInfoList64() and the QuaZipDir listings are then answered from
+      the catalog instead of walking the central directory every time, and
+      without changing the current file.
+
+      The catalog takes a few dozen bytes per entry plus the size of the
+      names, extra fields and comments. It is disabled by default.
+
+      The setting takes effect the next time the archive is opened. If the
+      catalog can't be built, a warning is printed and everything works
+      as if it was disabled.
+
+      @sa isCatalogEnabled()
+      */
+    void setCatalogEnabled(bool enabled);
+    /// Returns whether the catalog is enabled.
+    /**
+      @sa setCatalogEnabled()
+      */
+    bool isCatalogEnabled() const;
+    /// Enables or disables the name index.
+    /**
+      If enabled, a hash index over the names of all entries is built when
+      the archive is opened in the mdUnzip mode, and setCurrentFile() looks
+      the names up in it instead of walking the central directory. This
+      pays off when many files are looked up by name in a large archive.
+
+      The index needs the catalog, so it is built even if
+      setCatalogEnabled() wasn't called. It takes 32 to 64 bytes per entry.
+      If several entries have the same name, setCurrentFile() finds the
+      first one. It is disabled by default.
+
+      The setting takes effect the next time the archive is opened.
+
+      @sa isNameIndexEnabled()
+      @sa setCatalogEnabled()
+      */
+    void setNameIndexEnabled(bool enabled);
+    /// Returns whether the name index is enabled.
+    /**
+      @sa setNameIndexEnabled()
+      */
+    bool isNameIndexEnabled() const;
+    /// Sets the file the catalog is saved to and loaded from.
+    /**
+      If set, the catalog (and the name index, if enabled) is loaded from
+      this file on open instead of being built from the central directory,
+      and only the central directory location is read from the archive. The
+      file is mapped into memory if possible, which makes opening even a
+      huge archive nearly instant. If the file doesn't exist or doesn't
+      match the archive, the catalog is built as usual and the file is
+      (re)written.
+
+      The file is matched to the archive by the end of central directory
+      record, the archive size and, for files, the modification time. It
+      is in the native byte order, so it shouldn't be shared between
+      machines. An empty name disables the catalog file.
+
+      This has no effect unless either the catalog or the name index is
+      enabled. The setting takes effect the next time the archive is
+      opened in the mdUnzip mode.
+
+      When the catalog is loaded from the file, the entries still have to
+      be read from the archive one by one when walking them with
+      goToFirstFile() and goToNextFile(), so prefer the catalog-backed
+      methods such as getFileInfoList64() and setCurrentFile() instead.
+
+      @sa getCatalogFileName()
+      @sa setCatalogDevice()
+      */
+    void setCatalogFileName(const QString &fileName);
+    /// Returns the name of the catalog file.
+    /**
+      @sa setCatalogFileName()
+      */
+    QString getCatalogFileName() const;
+    /// Sets the device the catalog is saved to and loaded from.
+    /**
+      Works just like setCatalogFileName(), except that the catalog is read
+      from and written to the start of \a device, which must be open for
+      reading, writing or both. The device is never mapped, and if it's a
+      file, it is truncated after the catalog is written. QuaZip doesn't
+      take ownership of the device.
+
+      If both a file name and a device are set, the file name is used.
+      Pass \c nullptr to disable the catalog device.
+
+      @sa getCatalogDevice()
+      */
+    void setCatalogDevice(QIODevice *device);
+    /// Returns the catalog device.
+    /**
+      @sa setCatalogDevice()
+      */
+    QIODevice *getCatalogDevice() const;
+    /// Enables or disables memory mapping of the archive.
+    /**
+      If enabled, an archive opened in the mdUnzip mode is mapped into
+      memory with QFileDevice::map() and all reads are served from the
+      mapping instead of going through the device, which saves a system
+      call and a copy per read for large local archives. The device stays
+      open, but its position is no longer used.
+
+      If the device isn't a QFileDevice or can't be mapped, it is read
+      with \ref setPositionalReadEnabled() "positional reads" instead, so
+      that a mapped archive can always be read from several threads. The
+      setting has no effect in the other modes and when a
+      custom \a ioApi is passed to open(). It is disabled by default and
+      takes effect the next time the archive is opened.
+
+      Note that the archive must not be truncated while it is mapped: on
+      most systems reading past the new end crashes the process.
+
+      @sa isMemoryMappingEnabled()
+      */
+    void setMemoryMappingEnabled(bool enabled);
+    /// Returns whether memory mapping is enabled.
+    /**
+      @sa setMemoryMappingEnabled()
+      */
+    bool isMemoryMappingEnabled() const;
+    /// Enables or disables positional reads.
+    /**
+      If enabled, an archive opened in the mdUnzip mode is read with
+      pread() on the handle of the device instead of with seek() and
+      read(), and every QuaZip keeps its own position. On Windows, the
+      file is opened again for overlapped reads with ReOpenFile(), since
+      ReadFile() with an offset would still move the position of the
+      device. Several QuaZip objects can then be opened on the same
+      device, with auto-close disabled, and read from different threads at
+      the same time without any locking. Devices without a native handle,
+      such as QBuffer, are read with seek() and read() under a global lock.
+
+      The reads bypass the buffer of the device, so the device must not be
+      written to while the archive is open. Memory mapping, if enabled,
+      takes precedence, since mapped archives can be read concurrently
+      too. The setting has no effect in the other modes and when a custom
+      \a ioApi is passed to open(). It is disabled by default and takes
+      effect the next time the archive is opened.
+
+      @sa isPositionalReadEnabled()
+      @sa setMemoryMappingEnabled()
+      */
+    void setPositionalReadEnabled(bool enabled);
+    /// Returns whether positional reads are enabled.
+    /**
+      @sa setPositionalReadEnabled()
+      */
+    bool isPositionalReadEnabled() const;
+    /// Sets the size of the window read ahead.
+    /**
+      If set, an archive opened in the mdUnzip mode is read with
+      \ref setPositionalReadEnabled() "positional reads" of this many
+      bytes at once (or more, when minizip asks for more), and the smaller
+      reads made while inflating, of 16K or so, are served from that window.
+      This helps with devices where every read is slow, such as files on
+      network file systems; something between 1 and 8 MiB is reasonable
+      then. On systems that have posix_fadvise(), the system is told that
+      the file is read sequentially and, unless prefetching is enabled, that
+      the next window is going to be needed.
+
+      Everything said about positional reads applies. Memory mapping, if
+      enabled, takes precedence. Zero, the default, disables read-ahead.
+      The setting has no effect in the other modes and when a custom
+      \a ioApi is passed to open(), and takes effect the next time the
+      archive is opened.
+
+      @sa getReadAheadSize()
+      @sa setPrefetchEnabled()
+      */
+    void setReadAheadSize(int size);
+    /// Returns the size of the window read ahead.
+    /**
+      @sa setReadAheadSize()
+      */
+    int getReadAheadSize() const;
+    /// Enables or disables reading the next window in the background.
+    /**
+      If enabled along with \ref setReadAheadSize() "read-ahead", once a
+      window is read, the one after it is read by a background thread
+      while the data of the current one is used, so that when extracting
+      files in order, the local header and the data of the next file are
+      usually there by the time they are needed. Only devices with a native
+      handle are prefetched. A window prefetched in vain, because the
+      archive is read elsewhere, is just dropped.
+
+      It is disabled by default and takes effect the next time the archive
+      is opened.
+
+      @sa isPrefetchEnabled()
+      */
+    void setPrefetchEnabled(bool enabled);
+    /// Returns whether prefetching is enabled.
+    /**
+      @sa setPrefetchEnabled()
+      */
+    bool isPrefetchEnabled() const;
+    /// Sets how many files are expected to be added to the archive.
+    /**
+      The central directory is kept in memory until the archive is
+      closed. If the number of files is known in advance, memory for
+      their records is reserved at once when the archive is opened in the
+      mdCreate, mdAppend or mdAdd mode, instead of growing the buffer as
+      they are added. This is only a hint: adding more or fewer files
+      works too. Zero or less, the default, reserves nothing. Takes
+      effect the next time the archive is opened.
+
+      @sa getExpectedEntryCount()
+      */
+    void setExpectedEntryCount(qint64 count);
+    /// Returns how many files are expected to be added to the archive.
+    /**
+      @sa setExpectedEntryCount()
+      */
+    qint64 getExpectedEntryCount() const;
+    /// Sets the size of the buffer gathering the writes to the archive.
+    /**
+      Without the buffer, every local header, data chunk and data
+      descriptor is a separate write to the device, which is slow with
+      many small files, especially on devices opened with
+      QIODevice::Unbuffered. With the buffer, the writes are gathered and
+      passed on in chunks of this size, aligned to it in the archive. The
+      sizes and the CRC patched into the local header after a file is
+      written go to the buffer too, as long as the header is still there.
+
+      The buffer is written out when the archive is closed, so the device
+      only holds the whole archive after close(). It is also written out
+      when a stored file is copied by QuaZipFile::copyFrom().
+
+      Zero, the default, disables the buffer. The setting has no effect
+      when a custom \a ioApi is passed to open(), and takes effect the
+      next time the archive is opened in the mdCreate, mdAppend or mdAdd
+      mode.
+
+      @sa getWriteBufferSize()
+      */
+    void setWriteBufferSize(int size);
+    /// Returns the size of the write buffer.
+    /**
+      @sa setWriteBufferSize()
+      */
+    int getWriteBufferSize() const;
     /// Sets default OS code.
     /**
      * @sa setOsCode()
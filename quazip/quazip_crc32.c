@@ -0,0 +1,324 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+
+The folding is the one described in "Fast CRC Computation for Generic
+Polynomials Using PCLMULQDQ Instruction" by V. Gopal et al. (Intel, 2009),
+as done in the Chromium zlib. The constants are x^n mod P(x), bit-reflected
+and shifted left by one, for the folding distances used.
+*/
+
+#include "quazip_crc32.h"
+
+#ifndef local
+#  define local static
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define QUAZIP_CRC32_X86
+#  include <immintrin.h>
+#elif defined(__GNUC__) && defined(__aarch64__) \
+    && (defined(__linux__) || defined(__APPLE__))
+#  define QUAZIP_CRC32_ARM
+#  include <arm_acle.h>
+#  ifdef __linux__
+#    include <sys/auxv.h>
+#    include <asm/hwcap.h>
+#  endif
+#endif
+
+#if defined(QUAZIP_CRC32_X86) || defined(QUAZIP_CRC32_ARM)
+
+typedef uLong (*quazip_crc32_func)(uLong crc, const Bytef *buf, uInt len);
+
+local uLong quazip_crc32_detect(uLong crc, const Bytef *buf, uInt len);
+
+/* Set by quazip_crc32_detect() on the first call. Several threads may make
+   it at once, so it's only accessed atomically. They all store the same
+   value, so no ordering is needed. */
+local quazip_crc32_func quazip_crc32_impl = quazip_crc32_detect;
+
+#endif
+
+#ifdef QUAZIP_CRC32_X86
+
+/* Shorter buffers are not worth the setup. The 512-bit registers only pay
+   off for long buffers, since the CPU takes a while to power them up. */
+#define QUAZIP_CRC32_PCLMUL_MIN 64
+#define QUAZIP_CRC32_VPCLMUL_MIN 8192
+
+/* Folds x1..x4, 64 bytes in total, into one register together with the
+   remaining len bytes at buf, which must be a multiple of 16, and reduces
+   it to the CRC. */
+__attribute__((target("pclmul,sse4.1")))
+local unsigned quazip_crc32_fold_tail(__m128i x1, __m128i x2, __m128i x3,
+                                      __m128i x4, const Bytef *buf,
+                                      size_t len)
+{
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i x0, x5;
+
+    /* Fold into 128 bits. */
+    x0 = k3k4;
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /* Single fold blocks of 16, if any. */
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i *)buf);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    /* Fold 128 bits to 64 bits. */
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = k5k0;
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask32);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /* Barrett reduction to 32 bits. */
+    x0 = poly;
+    x2 = _mm_and_si128(x1, mask32);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, mask32);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return (unsigned)_mm_extract_epi32(x1, 1);
+}
+
+/* The CRC of len bytes, at least 64 and a multiple of 16, with the CRC
+   register (not the CRC itself, so inverted) passed and returned. */
+__attribute__((target("pclmul,sse4.1")))
+local unsigned quazip_crc32_pclmul_fold(unsigned crc, const Bytef *buf,
+                                        size_t len)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    __m128i x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)crc));
+    buf += 64;
+    len -= 64;
+
+    /* Fold 4 registers forward by 512 bits at a time. */
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+                           _mm_loadu_si128((const __m128i *)(buf + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+                           _mm_loadu_si128((const __m128i *)(buf + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+                           _mm_loadu_si128((const __m128i *)(buf + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+                           _mm_loadu_si128((const __m128i *)(buf + 0x30)));
+        buf += 64;
+        len -= 64;
+    }
+    return quazip_crc32_fold_tail(x1, x2, x3, x4, buf, len);
+}
+
+/* The same with 512-bit registers, for at least 256 bytes. */
+__attribute__((target("avx512f,vpclmulqdq,pclmul,sse4.1")))
+local unsigned quazip_crc32_vpclmul_fold(unsigned crc, const Bytef *buf,
+                                         size_t len)
+{
+    /* folding distances of 2048 and 512 bits */
+    const __m512i k2048 = _mm512_broadcast_i32x4(
+            _mm_set_epi64x(0x01322d1430, 0x011542778a));
+    const __m512i k512 = _mm512_broadcast_i32x4(
+            _mm_set_epi64x(0x01c6e41596, 0x0154442bd4));
+    __m512i z0, z1, z2, z3;
+
+    z0 = _mm512_loadu_si512((const void *)(buf + 0x00));
+    z1 = _mm512_loadu_si512((const void *)(buf + 0x40));
+    z2 = _mm512_loadu_si512((const void *)(buf + 0x80));
+    z3 = _mm512_loadu_si512((const void *)(buf + 0xC0));
+    z0 = _mm512_xor_si512(z0, _mm512_zextsi128_si512(
+            _mm_cvtsi32_si128((int)crc)));
+    buf += 256;
+    len -= 256;
+
+    /* 0x96 is a ^ b ^ c */
+#define QUAZIP_CRC32_FOLD512(z, k, next) \
+    _mm512_ternarylogic_epi64(_mm512_clmulepi64_epi128((z), (k), 0x00), \
+                              _mm512_clmulepi64_epi128((z), (k), 0x11), \
+                              (next), 0x96)
+    while (len >= 256) {
+        z0 = QUAZIP_CRC32_FOLD512(z0, k2048,
+                _mm512_loadu_si512((const void *)(buf + 0x00)));
+        z1 = QUAZIP_CRC32_FOLD512(z1, k2048,
+                _mm512_loadu_si512((const void *)(buf + 0x40)));
+        z2 = QUAZIP_CRC32_FOLD512(z2, k2048,
+                _mm512_loadu_si512((const void *)(buf + 0x80)));
+        z3 = QUAZIP_CRC32_FOLD512(z3, k2048,
+                _mm512_loadu_si512((const void *)(buf + 0xC0)));
+        buf += 256;
+        len -= 256;
+    }
+    /* Fold 4 registers into one, then the rest 64 bytes at a time. */
+    z0 = QUAZIP_CRC32_FOLD512(z0, k512, z1);
+    z0 = QUAZIP_CRC32_FOLD512(z0, k512, z2);
+    z0 = QUAZIP_CRC32_FOLD512(z0, k512, z3);
+    while (len >= 64) {
+        z0 = QUAZIP_CRC32_FOLD512(z0, k512,
+                _mm512_loadu_si512((const void *)buf));
+        buf += 64;
+        len -= 64;
+    }
+#undef QUAZIP_CRC32_FOLD512
+    return quazip_crc32_fold_tail(_mm512_extracti32x4_epi32(z0, 0),
+                                  _mm512_extracti32x4_epi32(z0, 1),
+                                  _mm512_extracti32x4_epi32(z0, 2),
+                                  _mm512_extracti32x4_epi32(z0, 3),
+                                  buf, len);
+}
+
+local uLong quazip_crc32_pclmul(uLong crc, const Bytef *buf, uInt len)
+{
+    if (buf != Z_NULL && len >= QUAZIP_CRC32_PCLMUL_MIN) {
+        const uInt chunk = len & ~(uInt)15;
+        crc = ~quazip_crc32_pclmul_fold(~(unsigned)crc, buf, chunk)
+                & 0xffffffffUL;
+        buf += chunk;
+        len -= chunk;
+    }
+    return crc32(crc, buf, len);
+}
+
+local uLong quazip_crc32_vpclmul(uLong crc, const Bytef *buf, uInt len)
+{
+    if (buf != Z_NULL && len >= QUAZIP_CRC32_VPCLMUL_MIN) {
+        const uInt chunk = len & ~(uInt)15;
+        crc = ~quazip_crc32_vpclmul_fold(~(unsigned)crc, buf, chunk)
+                & 0xffffffffUL;
+        buf += chunk;
+        len -= chunk;
+    }
+    return quazip_crc32_pclmul(crc, buf, len);
+}
+
+local quazip_crc32_func quazip_crc32_select(void)
+{
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("pclmul") || !__builtin_cpu_supports("sse4.1"))
+        return crc32;
+    if (__builtin_cpu_supports("avx512f")
+            && __builtin_cpu_supports("vpclmulqdq"))
+        return quazip_crc32_vpclmul;
+    return quazip_crc32_pclmul;
+}
+
+#elif defined(QUAZIP_CRC32_ARM)
+
+__attribute__((target("+crc")))
+local uLong quazip_crc32_armv8(uLong crc, const Bytef *buf, uInt len)
+{
+    uint32_t c;
+    if (buf == Z_NULL)
+        return crc32(crc, buf, len);
+    c = ~(uint32_t)crc;
+    while (len != 0 && ((size_t)buf & 7) != 0) {
+        c = __crc32b(c, *buf++);
+        --len;
+    }
+    while (len >= 32) {
+        const uint64_t *p = (const uint64_t *)buf;
+        c = __crc32d(c, p[0]);
+        c = __crc32d(c, p[1]);
+        c = __crc32d(c, p[2]);
+        c = __crc32d(c, p[3]);
+        buf += 32;
+        len -= 32;
+    }
+    while (len >= 8) {
+        c = __crc32d(c, *(const uint64_t *)buf);
+        buf += 8;
+        len -= 8;
+    }
+    while (len != 0) {
+        c = __crc32b(c, *buf++);
+        --len;
+    }
+    return ~c & 0xffffffffUL;
+}
+
+local quazip_crc32_func quazip_crc32_select(void)
+{
+#if defined(__APPLE__) || defined(__ARM_FEATURE_CRC32)
+    return quazip_crc32_armv8;
+#else
+    return (getauxval(AT_HWCAP) & HWCAP_CRC32) != 0 ? quazip_crc32_armv8
+                                                     : crc32;
+#endif
+}
+
+#endif
+
+#if defined(QUAZIP_CRC32_X86) || defined(QUAZIP_CRC32_ARM)
+
+local uLong quazip_crc32_detect(uLong crc, const Bytef *buf, uInt len)
+{
+    const quazip_crc32_func impl = quazip_crc32_select();
+    __atomic_store_n(&quazip_crc32_impl, impl, __ATOMIC_RELAXED);
+    return impl(crc, buf, len);
+}
+
+uLong quazip_crc32(uLong crc, const Bytef *buf, uInt len)
+{
+    return __atomic_load_n(&quazip_crc32_impl, __ATOMIC_RELAXED)(crc, buf, len);
+}
+
+#else
+
+uLong quazip_crc32(uLong crc, const Bytef *buf, uInt len)
+{
+    return crc32(crc, buf, len);
+}
+
+#endif
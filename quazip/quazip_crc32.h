@@ -0,0 +1,48 @@
+#ifndef QUAZIP_CRC32_H
+#define QUAZIP_CRC32_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <zlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The same as crc32() in zlib, but faster where the CPU helps.
+
+   On x86 and x86-64 the data is folded with PCLMULQDQ, or with
+   VPCLMULQDQ on AVX-512 CPUs, and on ARMv8 the CRC32 instructions are
+   used. The CPU is checked once, at the first call, and the zlib
+   function is used when none of these is available, when the compiler
+   doesn't support them, and for short buffers.
+*/
+extern uLong quazip_crc32(uLong crc, const Bytef *buf, uInt len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* QUAZIP_CRC32_H */
@@ -59,5 +59,7 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #define QUAZIP_EXTRA_EXT_MOD_TIME_FLAG 1
 #define QUAZIP_EXTRA_EXT_AC_TIME_FLAG 2
 #define QUAZIP_EXTRA_EXT_CR_TIME_FLAG 4
+/// Restart points written by QuaZipFile::setRestartPointInterval().
+#define QUAZIP_EXTRA_RESTART_POINTS_MAGIC 0x5251u
 
 #endif // QUAZIP_GLOBAL_H
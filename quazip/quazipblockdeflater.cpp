@@ -0,0 +1,189 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quazipblockdeflater.h"
+#include "quazip_crc32.h"
+
+#include <QtCore/QRunnable>
+
+#include <algorithm>
+#include <cstring>
+
+/// A block of data and what it is deflated to.
+struct QuaZipBlockDeflater::Block {
+    QByteArray input;
+    QByteArray dictionary;
+    bool last = false;
+    /// The fields below are written by the worker.
+    QByteArray output;
+    uLong crc = 0;
+    int error = Z_OK;
+    /// Guarded by m_mutex.
+    bool done = false;
+};
+
+QuaZipBlockDeflater::QuaZipBlockDeflater(zipFile zip, int threadCount, int blockSize,
+                                         int level, int memLevel, int strategy,
+                                         bool restartPoints):
+    m_zip(zip),
+    m_blockSize(std::max(blockSize, MIN_BLOCK_SIZE)),
+    m_level(level),
+    m_memLevel(memLevel),
+    m_strategy(strategy),
+    m_independent(restartPoints),
+    // enough to keep all the threads busy while the oldest block is written
+    m_maxPending(static_cast<size_t>(threadCount) * 2),
+    m_crc(crc32(0L, Z_NULL, 0)),
+    m_uncompressedSize(0),
+    m_compressedSize(0)
+{
+    m_pool.setMaxThreadCount(threadCount);
+    m_current.reserve(m_blockSize);
+}
+
+QuaZipBlockDeflater::~QuaZipBlockDeflater()
+{
+    m_pool.waitForDone();
+}
+
+int QuaZipBlockDeflater::write(const char *data, qint64 size)
+{
+    while (size > 0) {
+        const qint64 chunk = std::min<qint64>(size, m_blockSize - m_current.size());
+        m_current.append(data, static_cast<int>(chunk));
+        data += chunk;
+        size -= chunk;
+        if (m_current.size() == m_blockSize) {
+            int err = submit(false);
+            if (err != ZIP_OK)
+                return err;
+        }
+    }
+    return ZIP_OK;
+}
+
+int QuaZipBlockDeflater::finish()
+{
+    // even with no data at all, the last block is needed to end the stream
+    return submit(true);
+}
+
+int QuaZipBlockDeflater::submit(bool last)
+{
+    std::unique_ptr<Block> block(new Block());
+    block->input = m_current;
+    block->dictionary = m_dictionary;
+    block->last = last;
+    if (!m_independent)
+        m_dictionary = m_current.right(MIN_BLOCK_SIZE);
+    m_current = QByteArray();
+    if (!last)
+        m_current.reserve(m_blockSize);
+    Block *submitted = block.get();
+    m_pending.push_back(std::move(block));
+    m_pool.start(QRunnable::create([this, submitted]() {
+        deflateBlock(submitted);
+        QMutexLocker locker(&m_mutex);
+        submitted->done = true;
+        m_deflated.wakeAll();
+    }));
+    while (m_pending.size() > m_maxPending || (last && !m_pending.empty())) {
+        int err = writeFirst();
+        if (err != ZIP_OK)
+            return err;
+    }
+    return ZIP_OK;
+}
+
+int QuaZipBlockDeflater::writeFirst()
+{
+    Block *block = m_pending.front().get();
+    {
+        QMutexLocker locker(&m_mutex);
+        while (!block->done)
+            m_deflated.wait(&m_mutex);
+    }
+    if (block->error != Z_OK)
+        return block->error;
+    int err = zipWriteInFileInZip(m_zip, block->output.constData(),
+                                  static_cast<unsigned>(block->output.size()));
+    if (err != ZIP_OK)
+        return err;
+    m_crc = crc32_combine(m_crc, block->crc, block->input.size());
+    m_uncompressedSize += static_cast<quint64>(block->input.size());
+    m_compressedSize += static_cast<quint64>(block->output.size());
+    if (m_independent && !block->last)
+        m_restartPoints.append(m_compressedSize);
+    m_pending.pop_front();
+    return ZIP_OK;
+}
+
+void QuaZipBlockDeflater::deflateBlock(Block *block) const
+{
+    const QByteArray &input = block->input;
+    block->crc = quazip_crc32(crc32(0L, Z_NULL, 0),
+                       reinterpret_cast<const Bytef*>(input.constData()),
+                       static_cast<uInt>(input.size()));
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    int err = deflateInit2(&stream, m_level, Z_DEFLATED, -MAX_WBITS,
+                           m_memLevel, m_strategy);
+    if (err != Z_OK) {
+        block->error = err;
+        return;
+    }
+    if (!block->dictionary.isEmpty()) {
+        err = deflateSetDictionary(&stream,
+                reinterpret_cast<const Bytef*>(block->dictionary.constData()),
+                static_cast<uInt>(block->dictionary.size()));
+    }
+    const int flush = block->last ? Z_FINISH : Z_SYNC_FLUSH;
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.constData()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    // the flush marker and the headers of the stored blocks, if any
+    block->output.resize(static_cast<int>(deflateBound(&stream, stream.avail_in)) + 16);
+    int produced = 0;
+    bool complete = false;
+    while (err == Z_OK || err == Z_BUF_ERROR) {
+        stream.next_out = reinterpret_cast<Bytef*>(block->output.data()) + produced;
+        stream.avail_out = static_cast<uInt>(block->output.size() - produced);
+        err = deflate(&stream, flush);
+        produced = static_cast<int>(block->output.size()) - static_cast<int>(stream.avail_out);
+        if (err == Z_STREAM_END || (flush == Z_SYNC_FLUSH && err == Z_OK && stream.avail_out != 0)) {
+            err = Z_OK;
+            complete = true;
+            break;
+        }
+        if (stream.avail_out != 0) // no progress possible
+            break;
+        block->output.resize(block->output.size() * 2);
+    }
+    block->output.resize(produced);
+    // Z_DATA_ERROR just means that the stream wasn't finished, as intended
+    int endErr = deflateEnd(&stream);
+    if (!complete)
+        block->error = err == Z_OK ? Z_BUF_ERROR : err;
+    else
+        block->error = endErr == Z_DATA_ERROR ? Z_OK : endErr;
+}
@@ -0,0 +1,122 @@
+#ifndef QUAZIP_QUAZIPBLOCKDEFLATER_H
+#define QUAZIP_QUAZIPBLOCKDEFLATER_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QThreadPool>
+#include <QtCore/QWaitCondition>
+
+#include <deque>
+#include <memory>
+
+#include "zip.h"
+
+/// \cond internal
+
+/// Deflates the data of one entry in blocks, in several threads.
+/**
+  \internal
+
+  The data is cut into blocks of a fixed size, and every block is deflated
+  by a thread of its own into a raw deflate stream, primed with the last
+  32 KiB of the previous block as the dictionary, so the ratio is almost
+  the same as that of a single stream. Every block but the last one is
+  ended with Z_SYNC_FLUSH, which leaves it byte-aligned and not final, so
+  the compressed blocks are simply written one after another to the entry,
+  which must be open in the raw mode. The CRCs of the blocks are combined
+  with crc32_combine().
+
+  With restart points, the blocks are deflated without the dictionary, so
+  inflating can start at the beginning of any block, which makes it
+  Z_FULL_FLUSH in effect. The compressed offsets of the blocks are then
+  kept, see restartPoints().
+
+  The blocks are written in order by the thread calling write() and
+  finish(). A limited number of blocks is kept in flight, so write()
+  blocks if the workers fall behind.
+  */
+class QuaZipBlockDeflater {
+public:
+    /// The smallest block size, the size of the deflate window.
+    static constexpr int MIN_BLOCK_SIZE = 32768;
+    /// Creates a deflater writing to the entry currently open in \a zip.
+    QuaZipBlockDeflater(zipFile zip, int threadCount, int blockSize,
+                        int level, int memLevel, int strategy,
+                        bool restartPoints = false);
+    /// Waits for the workers, throwing away whatever they produce.
+    ~QuaZipBlockDeflater();
+    /// Adds \a size bytes of data.
+    /**
+      \return \c ZIP_OK or the zlib or ZIP error code.
+      */
+    int write(const char *data, qint64 size);
+    /// Deflates and writes the rest of the data, ending the stream.
+    int finish();
+    /// The CRC of all the data written so far.
+    inline quint32 crc() const { return static_cast<quint32>(m_crc); }
+    /// The size of all the data written so far.
+    inline quint64 uncompressedSize() const { return m_uncompressedSize; }
+    /// The block size, the uncompressed distance between restart points.
+    inline int blockSize() const { return m_blockSize; }
+    /// The compressed offsets of the blocks but the first one.
+    /**
+      Only kept with restart points. The block \a i + 1 starts at this
+      offset and at the uncompressed offset (\a i + 1) * blockSize().
+      */
+    inline const QList<quint64> &restartPoints() const { return m_restartPoints; }
+private:
+    Q_DISABLE_COPY(QuaZipBlockDeflater)
+    struct Block;
+    void deflateBlock(Block *block) const;
+    int submit(bool last);
+    int writeFirst();
+    zipFile m_zip;
+    int m_blockSize;
+    int m_level;
+    int m_memLevel;
+    int m_strategy;
+    bool m_independent;
+    size_t m_maxPending;
+    /// The data not submitted yet.
+    QByteArray m_current;
+    /// The last bytes of the previous block.
+    QByteArray m_dictionary;
+    /// The blocks submitted, in order.
+    std::deque<std::unique_ptr<Block>> m_pending;
+    uLong m_crc;
+    quint64 m_uncompressedSize;
+    quint64 m_compressedSize;
+    QList<quint64> m_restartPoints;
+    QMutex m_mutex;
+    QWaitCondition m_deflated;
+    QThreadPool m_pool;
+};
+
+/// \endcond
+
+#endif // QUAZIP_QUAZIPBLOCKDEFLATER_H
@@ -0,0 +1,455 @@
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include "quazipcatalog.h"
+
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QIODevice>
+
+#include <cstring>
+#include <vector>
+
+/// \cond internal
+
+static const char QUAZIP_CATALOG_MAGIC[8] = {'Q', 'Z', 'C', 'A', 'T', 'L', 'G', '1'};
+static const char QUAZIP_CATALOG_SAVED_MAGIC[8] = {'Q', 'Z', 'C', 'A', 'T', 'I', 'D', 'X'};
+static const quint32 QUAZIP_CATALOG_BYTE_ORDER = 0x01020304u;
+static const quint32 QUAZIP_CATALOG_VERSION = 2;
+
+static inline qint64 QuaZipCatalog_align(qint64 size)
+{
+    return (size + 7) & ~static_cast<qint64>(7);
+}
+
+QuaZipCatalog::QuaZipCatalog():
+    m_count(0),
+    m_arena(nullptr),
+    m_arenaSize(0),
+    m_indexMask(0)
+{
+    std::memset(m_u64, 0, sizeof(m_u64));
+    std::memset(m_u32, 0, sizeof(m_u32));
+    std::memset(m_u16, 0, sizeof(m_u16));
+    std::memset(m_slotEntries, 0, sizeof(m_slotEntries));
+    std::memset(m_slotHashes, 0, sizeof(m_slotHashes));
+}
+
+qint64 QuaZipCatalog::storageSize(quint64 count, quint64 arenaSize)
+{
+    qint64 size = QuaZipCatalog_align(sizeof(Header));
+    size += Column64Count * QuaZipCatalog_align(count * sizeof(quint64));
+    size += Column32Count * QuaZipCatalog_align(count * sizeof(quint32));
+    size += Column16Count * QuaZipCatalog_align(count * sizeof(quint16));
+    size += QuaZipCatalog_align(arenaSize);
+    return size;
+}
+
+bool QuaZipCatalog::setStorage(const QByteArray &storage)
+{
+    if (storage.size() < static_cast<qsizetype>(sizeof(Header)))
+        return false;
+    Header header;
+    std::memcpy(&header, storage.constData(), sizeof(Header));
+    if (std::memcmp(header.magic, QUAZIP_CATALOG_MAGIC, sizeof(header.magic)) != 0)
+        return false;
+    // guard against overflow in storageSize() for garbage headers
+    if (header.count > static_cast<quint64>(storage.size())
+            || header.arenaSize > static_cast<quint64>(storage.size()))
+        return false;
+    if (storageSize(header.count, header.arenaSize) != storage.size())
+        return false;
+    const char *data = storage.constData();
+    qint64 offset = QuaZipCatalog_align(sizeof(Header));
+    for (int i = 0; i < Column64Count; ++i) {
+        m_u64[i] = reinterpret_cast<const quint64*>(data + offset);
+        offset += QuaZipCatalog_align(header.count * sizeof(quint64));
+    }
+    for (int i = 0; i < Column32Count; ++i) {
+        m_u32[i] = reinterpret_cast<const quint32*>(data + offset);
+        offset += QuaZipCatalog_align(header.count * sizeof(quint32));
+    }
+    for (int i = 0; i < Column16Count; ++i) {
+        m_u16[i] = reinterpret_cast<const quint16*>(data + offset);
+        offset += QuaZipCatalog_align(header.count * sizeof(quint16));
+    }
+    m_arena = data + offset;
+    m_arenaSize = header.arenaSize;
+    // make sure no entry points outside of the arena
+    for (quint64 i = 0; i < header.count; ++i) {
+        quint64 end = m_u64[ArenaOffset][i] + m_u16[NameLength][i]
+                + m_u16[ExtraLength][i] + m_u16[CommentLength][i];
+        if (m_u64[ArenaOffset][i] > m_arenaSize || end > m_arenaSize)
+            return false;
+    }
+    m_storage = storage;
+    m_count = static_cast<qint64>(header.count);
+    return true;
+}
+
+QuaZipCatalog *QuaZipCatalog::build(unzFile unzFile, int *zipError)
+{
+    std::vector<quint64> u64[Column64Count];
+    std::vector<quint32> u32[Column32Count];
+    std::vector<quint16> u16[Column16Count];
+    QByteArray arena;
+    int err = unzGoToFirstFile(unzFile);
+    while (err == UNZ_OK) {
+        unz_file_info64 info_z;
+        err = unzGetCurrentFileInfo64(unzFile, &info_z, nullptr, 0, nullptr, 0, nullptr, 0);
+        if (err != UNZ_OK)
+            break;
+        qint64 arenaOffset = arena.size();
+        qint64 variable = static_cast<qint64>(info_z.size_filename)
+                + info_z.size_file_extra + info_z.size_file_comment;
+        if (arena.capacity() < arenaOffset + variable)
+            arena.reserve(qMax<qint64>(arenaOffset + variable, 2 * arena.capacity()));
+        arena.resize(arenaOffset + variable);
+        char *name = arena.data() + arenaOffset;
+        char *extra = name + info_z.size_filename;
+        char *comment = extra + info_z.size_file_extra;
+        err = unzGetCurrentFileInfo64(unzFile, nullptr,
+                name, info_z.size_filename,
+                extra, info_z.size_file_extra,
+                comment, info_z.size_file_comment);
+        if (err != UNZ_OK)
+            break;
+        unz64_file_pos pos;
+        err = unzGetFilePos64(unzFile, &pos);
+        if (err != UNZ_OK)
+            break;
+        u64[CompressedSize].push_back(info_z.compressed_size);
+        u64[UncompressedSize].push_back(info_z.uncompressed_size);
+        u64[LocalHeaderPos].push_back(unzGetCurrentFileLocalHeaderPos64(unzFile));
+        u64[CentralDirPos].push_back(pos.pos_in_zip_directory);
+        u64[ArenaOffset].push_back(arenaOffset);
+        u32[Crc].push_back(info_z.crc);
+        u32[DosDate].push_back(info_z.dosDate);
+        u32[ExternalAttr].push_back(info_z.external_fa);
+        u16[VersionCreated].push_back(info_z.version);
+        u16[VersionNeeded].push_back(info_z.version_needed);
+        u16[Flags].push_back(info_z.flag);
+        u16[Method].push_back(info_z.compression_method);
+        u16[InternalAttr].push_back(info_z.internal_fa);
+        u16[DiskNumberStart].push_back(info_z.disk_num_start);
+        u16[NameLength].push_back(info_z.size_filename);
+        u16[ExtraLength].push_back(info_z.size_file_extra);
+        u16[CommentLength].push_back(info_z.size_file_comment);
+        err = unzGoToNextFile(unzFile);
+    }
+    if (err != UNZ_END_OF_LIST_OF_FILE) {
+        *zipError = err;
+        unzGoToFirstFile(unzFile);
+        return nullptr;
+    }
+    unzGoToFirstFile(unzFile);
+    quint64 count = u64[CompressedSize].size();
+    QByteArray storage(storageSize(count, arena.size()), '\0');
+    char *data = storage.data();
+    Header header;
+    std::memcpy(header.magic, QUAZIP_CATALOG_MAGIC, sizeof(header.magic));
+    header.count = count;
+    header.arenaSize = arena.size();
+    std::memcpy(data, &header, sizeof(header));
+    qint64 offset = QuaZipCatalog_align(sizeof(Header));
+    for (const auto &column : u64) {
+        if (count > 0)
+            std::memcpy(data + offset, column.data(), count * sizeof(quint64));
+        offset += QuaZipCatalog_align(count * sizeof(quint64));
+    }
+    for (const auto &column : u32) {
+        if (count > 0)
+            std::memcpy(data + offset, column.data(), count * sizeof(quint32));
+        offset += QuaZipCatalog_align(count * sizeof(quint32));
+    }
+    for (const auto &column : u16) {
+        if (count > 0)
+            std::memcpy(data + offset, column.data(), count * sizeof(quint16));
+        offset += QuaZipCatalog_align(count * sizeof(quint16));
+    }
+    if (!arena.isEmpty())
+        std::memcpy(data + offset, arena.constData(), arena.size());
+    QuaZipCatalog *catalog = new QuaZipCatalog();
+    if (!catalog->setStorage(storage)) {
+        delete catalog;
+        *zipError = UNZ_INTERNALERROR;
+        return nullptr;
+    }
+    *zipError = UNZ_OK;
+    return catalog;
+}
+
+bool QuaZipCatalog::Source::operator==(const Source &other) const
+{
+    return centralPos == other.centralPos
+            && centralDirOffset == other.centralDirOffset
+            && centralDirSize == other.centralDirSize
+            && entryCount == other.entryCount
+            && archiveSize == other.archiveSize
+            && modificationTime == other.modificationTime;
+}
+
+QuaZipCatalog *QuaZipCatalog::load(const QByteArray &data, const Source &source,
+                                   bool nameIndex)
+{
+    if (data.size() < static_cast<qsizetype>(sizeof(SavedHeader)))
+        return nullptr;
+    SavedHeader header;
+    std::memcpy(&header, data.constData(), sizeof(header));
+    if (std::memcmp(header.magic, QUAZIP_CATALOG_SAVED_MAGIC, sizeof(header.magic)) != 0
+            || header.byteOrder != QUAZIP_CATALOG_BYTE_ORDER
+            || header.version != QUAZIP_CATALOG_VERSION
+            || !(header.source == source))
+        return nullptr;
+    quint64 available = data.size() - sizeof(SavedHeader);
+    if (header.storageSize > available
+            || header.nameIndexSize != available - header.storageSize)
+        return nullptr;
+    if (nameIndex && header.nameIndexSize == 0)
+        return nullptr;
+    const char *storage = data.constData() + sizeof(SavedHeader);
+    QuaZipCatalog *catalog = new QuaZipCatalog();
+    catalog->m_saved = data;
+    if (!catalog->setStorage(QByteArray::fromRawData(storage, header.storageSize))
+            || (nameIndex && !catalog->setNameIndexStorage(QByteArray::fromRawData(
+                    storage + header.storageSize, header.nameIndexSize)))) {
+        delete catalog;
+        return nullptr;
+    }
+    return catalog;
+}
+
+QuaZipCatalog *QuaZipCatalog::load(const QString &fileName, const Source &source,
+                                   bool nameIndex)
+{
+    QSharedPointer<QFile> file(new QFile(fileName));
+    if (!file->open(QIODevice::ReadOnly))
+        return nullptr;
+    uchar *mapped = file->size() > 0 ? file->map(0, file->size()) : nullptr;
+    if (mapped == nullptr)
+        return load(file.data(), source, nameIndex);
+    QuaZipCatalog *catalog = load(QByteArray::fromRawData(
+            reinterpret_cast<const char*>(mapped), file->size()), source, nameIndex);
+    if (catalog != nullptr)
+        catalog->m_mappedFile = file;
+    return catalog;
+}
+
+QuaZipCatalog *QuaZipCatalog::load(QIODevice *device, const Source &source,
+                                   bool nameIndex)
+{
+    if (!device->isReadable() || !device->seek(0))
+        return nullptr;
+    return load(device->readAll(), source, nameIndex);
+}
+
+bool QuaZipCatalog::save(QIODevice *device, const Source &source) const
+{
+    SavedHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, QUAZIP_CATALOG_SAVED_MAGIC, sizeof(header.magic));
+    header.byteOrder = QUAZIP_CATALOG_BYTE_ORDER;
+    header.version = QUAZIP_CATALOG_VERSION;
+    header.source = source;
+    header.storageSize = m_storage.size();
+    header.nameIndexSize = m_nameIndex.size();
+    return device->write(reinterpret_cast<const char*>(&header), sizeof(header))
+                == static_cast<qint64>(sizeof(header))
+            && device->write(m_storage) == m_storage.size()
+            && device->write(m_nameIndex) == m_nameIndex.size();
+}
+
+QByteArray QuaZipCatalog::rawName(qint64 index) const
+{
+    return QByteArray::fromRawData(m_arena + m_u64[ArenaOffset][index],
+                                   m_u16[NameLength][index]);
+}
+
+QString QuaZipCatalog::name(qint64 index) const
+{
+    return QString::fromUtf8(m_arena + m_u64[ArenaOffset][index],
+                             m_u16[NameLength][index]);
+}
+
+void QuaZipCatalog::fileInfo(qint64 index, QuaZipFileInfo64 *info) const
+{
+    const char *name = m_arena + m_u64[ArenaOffset][index];
+    const char *extra = name + m_u16[NameLength][index];
+    const char *comment = extra + m_u16[ExtraLength][index];
+    quint32 dosDate = m_u32[DosDate][index];
+    info->versionCreated = m_u16[VersionCreated][index];
+    info->versionNeeded = m_u16[VersionNeeded][index];
+    info->flags = m_u16[Flags][index];
+    info->method = m_u16[Method][index];
+    info->crc = m_u32[Crc][index];
+    info->compressedSize = m_u64[CompressedSize][index];
+    info->uncompressedSize = m_u64[UncompressedSize][index];
+    info->diskNumberStart = m_u16[DiskNumberStart][index];
+    info->internalAttr = m_u16[InternalAttr][index];
+    info->externalAttr = m_u32[ExternalAttr][index];
+    info->name = QString::fromUtf8(name, m_u16[NameLength][index]);
+    info->comment = QString::fromUtf8(comment, m_u16[CommentLength][index]);
+    info->extra = QByteArray(extra, m_u16[ExtraLength][index]);
+    // the same conversion unzip.c does for tmu_date
+    info->dateTime = QDateTime(
+        QDate(((dosDate >> 25) & 0x7f) + 1980, (dosDate >> 21) & 0x0f,
+              (dosDate >> 16) & 0x1f),
+        QTime((dosDate >> 11) & 0x1f, (dosDate >> 5) & 0x3f,
+              2 * (dosDate & 0x1f)));
+}
+
+unz64_file_pos QuaZipCatalog::filePos(qint64 index) const
+{
+    unz64_file_pos pos;
+    pos.pos_in_zip_directory = m_u64[CentralDirPos][index];
+    pos.num_of_file = static_cast<ZPOS64_T>(index);
+    return pos;
+}
+
+quint32 QuaZipCatalog::hashName(const char *data, qsizetype size)
+{
+    // 32-bit FNV-1a
+    quint32 hash = 2166136261u;
+    for (qsizetype i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+QByteArray QuaZipCatalog::nameKey(qint64 index, bool caseSensitive,
+                                  QByteArray *buffer) const
+{
+    QByteArray raw = rawName(index);
+    for (char c : raw) {
+        if (static_cast<unsigned char>(c) >= 0x80) {
+            // names are looked up as name() returns them, so the bytes
+            // that aren't valid UTF-8 are keyed as replacement characters
+            const QString name = QString::fromUtf8(raw);
+            *buffer = caseSensitive ? name.toUtf8() : name.toLower().toUtf8();
+            return *buffer;
+        }
+    }
+    if (caseSensitive)
+        return raw;
+    buffer->resize(raw.size());
+    char *key = buffer->data();
+    for (qsizetype i = 0; i < raw.size(); ++i) {
+        char c = raw.at(i);
+        key[i] = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    }
+    return *buffer;
+}
+
+bool QuaZipCatalog::setNameIndexStorage(const QByteArray &storage)
+{
+    quint64 capacity;
+    if (storage.size() < static_cast<qsizetype>(sizeof(capacity)))
+        return false;
+    std::memcpy(&capacity, storage.constData(), sizeof(capacity));
+    if (capacity < 2 || (capacity & (capacity - 1)) != 0
+            || capacity > static_cast<quint64>(storage.size())
+            || static_cast<quint64>(storage.size())
+               != sizeof(capacity) + 4 * capacity * sizeof(quint32))
+        return false;
+    const quint32 *tables = reinterpret_cast<const quint32*>(
+                storage.constData() + sizeof(capacity));
+    for (int t = 0; t < 2; ++t) {
+        const quint32 *entries = tables + 2 * t * capacity;
+        bool hasEmpty = false;
+        for (quint64 slot = 0; slot < capacity; ++slot) {
+            if (entries[slot] > static_cast<quint64>(m_count))
+                return false;
+            hasEmpty = hasEmpty || entries[slot] == 0;
+        }
+        // lookups stop at the first empty slot
+        if (!hasEmpty)
+            return false;
+        m_slotEntries[t] = entries;
+        m_slotHashes[t] = entries + capacity;
+    }
+    m_nameIndex = storage;
+    m_indexMask = capacity - 1;
+    return true;
+}
+
+void QuaZipCatalog::buildNameIndex()
+{
+    // the slots store entry indexes as 32-bit numbers
+    if (static_cast<quint64>(m_count) >= 0xFFFFFFFFu)
+        return;
+    // keep the load factor at or below 1/2
+    quint64 capacity = 16;
+    while (capacity < 2 * static_cast<quint64>(m_count))
+        capacity <<= 1;
+    QByteArray storage(sizeof(capacity) + 4 * capacity * sizeof(quint32), '\0');
+    std::memcpy(storage.data(), &capacity, sizeof(capacity));
+    quint32 *tables = reinterpret_cast<quint32*>(storage.data() + sizeof(capacity));
+    QByteArray buffer, otherBuffer;
+    for (int t = 0; t < 2; ++t) {
+        bool caseSensitive = t == 0;
+        quint32 *entries = tables + 2 * t * capacity;
+        quint32 *hashes = entries + capacity;
+        for (qint64 i = 0; i < m_count; ++i) {
+            QByteArray key = nameKey(i, caseSensitive, &buffer);
+            quint32 hash = hashName(key.constData(), key.size());
+            quint64 slot = hash & (capacity - 1);
+            bool duplicate = false;
+            while (entries[slot] != 0) {
+                if (hashes[slot] == hash
+                        && nameKey(entries[slot] - 1, caseSensitive, &otherBuffer) == key) {
+                    duplicate = true;
+                    break;
+                }
+                slot = (slot + 1) & (capacity - 1);
+            }
+            if (!duplicate) {
+                entries[slot] = static_cast<quint32>(i + 1);
+                hashes[slot] = hash;
+            }
+        }
+    }
+    setNameIndexStorage(storage);
+}
+
+qint64 QuaZipCatalog::indexOf(const QString &fileName, Qt::CaseSensitivity cs) const
+{
+    if (!hasNameIndex())
+        return -1;
+    bool caseSensitive = cs == Qt::CaseSensitive;
+    int t = caseSensitive ? 0 : 1;
+    QByteArray query = caseSensitive ? fileName.toUtf8() : fileName.toLower().toUtf8();
+    quint32 hash = hashName(query.constData(), query.size());
+    QByteArray buffer;
+    for (quint64 slot = hash & m_indexMask; ; slot = (slot + 1) & m_indexMask) {
+        quint32 entry = m_slotEntries[t][slot];
+        if (entry == 0)
+            return -1;
+        if (m_slotHashes[t][slot] == hash
+                && nameKey(entry - 1, caseSensitive, &buffer) == query)
+            return entry - 1;
+    }
+}
+
+/// \endcond
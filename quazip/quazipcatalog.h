@@ -0,0 +1,246 @@
+#ifndef QUAZIP_QUAZIPCATALOG_H
+#define QUAZIP_QUAZIPCATALOG_H
+
+/*
+Copyright (C) 2005-2014 Sergey A. Tachenov
+
+This file is part of QuaZip.
+
+QuaZip is free software: you can redistribute it and/or modify
+it under the terms of the GNU Lesser General Public License as published by
+the Free Software Foundation, either version 2.1 of the License, or
+(at your option) any later version.
+
+QuaZip is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU Lesser General Public License for more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with QuaZip.  If not, see <http://www.gnu.org/licenses/>.
+
+See COPYING file for the full LGPL text.
+
+Original ZIP package is copyrighted by Gilles Vollant and contributors,
+see quazip/(un)zip.h files for details. Basically it's the zlib license.
+*/
+
+#include <QtCore/QByteArray>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QString>
+#include <QtCore/Qt>
+
+#include "unzip.h"
+#include "quazipfileinfo.h"
+
+/// \cond internal
+class QFile;
+class QIODevice;
+
+/// The parsed central directory of an archive open in mdUnzip mode.
+/**
+  \internal
+
+  The catalog is built once by walking the central directory and is
+  immutable afterwards. The entries are stored in a structure-of-arrays
+  layout: one column per field, all packed into a single buffer along with
+  an arena holding the raw names, extra fields and comments. This keeps
+  the per-entry overhead to a few dozen bytes and means that the whole
+  catalog can be written out and mapped back as is, see save() and load().
+  */
+class QuaZipCatalog {
+public:
+    /// Identifies the state of the archive a catalog was built from.
+    /**
+      A saved catalog is only loaded back if all of these match.
+      */
+    struct Source {
+        /// The position of the end of central directory record.
+        quint64 centralPos;
+        /// The offset of the central directory.
+        quint64 centralDirOffset;
+        /// The size of the central directory.
+        quint64 centralDirSize;
+        /// The number of entries in the central directory.
+        quint64 entryCount;
+        /// The size of the archive.
+        quint64 archiveSize;
+        /// The archive modification time in ms since epoch or -1 if unknown.
+        qint64 modificationTime;
+        /// Returns \c true if the sources are the same.
+        bool operator==(const Source &other) const;
+    };
+    /// Walks the central directory of \a unzFile and builds a catalog.
+    /**
+      The current file of \a unzFile is reset to the first one.
+
+      \return The new catalog or \c nullptr on error, in which case the
+      UNZ_* error code is stored in \a zipError.
+      */
+    static QuaZipCatalog *build(unzFile unzFile, int *zipError);
+    /// Loads a catalog written by save() from the file \a fileName.
+    /**
+      The file is mapped into memory if possible, so the catalog doesn't
+      have to be read in full.
+
+      \return The catalog or \c nullptr if the file doesn't exist, is
+      malformed or was saved for a different \a source. If \a nameIndex
+      is \c true, a catalog saved without the name index is rejected too.
+      */
+    static QuaZipCatalog *load(const QString &fileName, const Source &source,
+                               bool nameIndex);
+    /// Loads a catalog written by save() from the start of \a device.
+    /** \overload */
+    static QuaZipCatalog *load(QIODevice *device, const Source &source,
+                               bool nameIndex);
+    /// Writes the catalog and its name index to \a device.
+    /**
+      The data is in the native byte order and is only meant to be loaded
+      back on the same machine.
+      */
+    bool save(QIODevice *device, const Source &source) const;
+    /// Returns the number of entries.
+    inline qint64 count() const { return m_count; }
+    /// Returns the raw (undecoded) name of the entry \a index.
+    /** The returned array references the catalog memory, no copy is made. */
+    QByteArray rawName(qint64 index) const;
+    /// Returns the name of the entry \a index.
+    QString name(qint64 index) const;
+    /// Fills \a info with the information about the entry \a index.
+    void fileInfo(qint64 index, QuaZipFileInfo64 *info) const;
+    /// Returns the position of the entry \a index in the central directory.
+    unz64_file_pos filePos(qint64 index) const;
+    /// Returns the position of the local header of the entry \a index.
+    inline quint64 localHeaderPos(qint64 index) const
+    {
+        return m_u64[LocalHeaderPos][index];
+    }
+    /// Returns the compressed size of the entry \a index.
+    inline quint64 compressedSize(qint64 index) const
+    {
+        return m_u64[CompressedSize][index];
+    }
+    /// Returns the uncompressed size of the entry \a index.
+    inline quint64 uncompressedSize(qint64 index) const
+    {
+        return m_u64[UncompressedSize][index];
+    }
+    /// Returns the compression method of the entry \a index.
+    inline quint16 method(qint64 index) const
+    {
+        return m_u16[Method][index];
+    }
+    /// Returns the general purpose flags of the entry \a index.
+    inline quint16 flags(qint64 index) const
+    {
+        return m_u16[Flags][index];
+    }
+    /// Returns the CRC of the entry \a index.
+    inline quint32 crc(qint64 index) const
+    {
+        return m_u32[Crc][index];
+    }
+    /// Builds the name index used by indexOf().
+    /**
+      The index is a pair of open-addressing hash tables, one over the raw
+      name bytes and one over the lowercased names, so that lookups never
+      have to convert the names of the entries to QString. ASCII names are
+      lowercased in place; only names with other characters go through
+      QString::toLower() when the index is built.
+
+      If the same name occurs more than once, the first entry wins.
+      */
+    void buildNameIndex();
+    /// Returns \c true if buildNameIndex() has been called.
+    inline bool hasNameIndex() const { return m_indexMask != 0; }
+    /// Looks up an entry by its name using the name index.
+    /** \return The index of the entry or -1 if there is no such entry. */
+    qint64 indexOf(const QString &fileName, Qt::CaseSensitivity cs) const;
+private:
+    enum Column64 {
+        CompressedSize,
+        UncompressedSize,
+        LocalHeaderPos,
+        CentralDirPos,
+        ArenaOffset,
+        Column64Count
+    };
+    enum Column32 {
+        Crc,
+        DosDate,
+        ExternalAttr,
+        Column32Count
+    };
+    enum Column16 {
+        VersionCreated,
+        VersionNeeded,
+        Flags,
+        Method,
+        InternalAttr,
+        DiskNumberStart,
+        NameLength,
+        ExtraLength,
+        CommentLength,
+        Column16Count
+    };
+    /// The header at the start of the storage.
+    struct Header {
+        char magic[8];
+        quint64 count;
+        quint64 arenaSize;
+    };
+    /// The header of the data written by save().
+    struct SavedHeader {
+        char magic[8];
+        quint32 byteOrder;
+        quint32 version;
+        Source source;
+        quint64 storageSize;
+        quint64 nameIndexSize;
+    };
+    QuaZipCatalog();
+    Q_DISABLE_COPY(QuaZipCatalog)
+    /// Loads a catalog from \a data written by save().
+    /** The catalog references \a data rather than copying it. */
+    static QuaZipCatalog *load(const QByteArray &data, const Source &source,
+                               bool nameIndex);
+    /// Returns the storage size needed for the given entry count and arena size.
+    static qint64 storageSize(quint64 count, quint64 arenaSize);
+    /// Takes \a storage over and sets up the column pointers.
+    /** \return \c false if the storage is malformed. */
+    bool setStorage(const QByteArray &storage);
+    /// Takes the name index \a storage over and sets up the table pointers.
+    /** \return \c false if the storage is malformed. */
+    bool setNameIndexStorage(const QByteArray &storage);
+    /// Returns the key the entry \a index is indexed by.
+    /**
+      The key is the name as name() returns it, UTF-8 encoded, and
+      lowercased for case insensitive lookups. For an ASCII name in a
+      case sensitive lookup that is the raw name itself, otherwise
+      \a buffer is used to store it.
+      */
+    QByteArray nameKey(qint64 index, bool caseSensitive, QByteArray *buffer) const;
+    /// The hash function used for the name index.
+    /** Unlike qHash(), it is stable across runs and machines. */
+    static quint32 hashName(const char *data, qsizetype size);
+    QByteArray m_storage;
+    qint64 m_count;
+    const quint64 *m_u64[Column64Count];
+    const quint32 *m_u32[Column32Count];
+    const quint16 *m_u16[Column16Count];
+    const char *m_arena;
+    quint64 m_arenaSize;
+    QByteArray m_nameIndex;
+    quint64 m_indexMask;
+    /// The entry index plus one for each slot, 0 marks an empty slot.
+    const quint32 *m_slotEntries[2];
+    /// The name hash for each slot.
+    const quint32 *m_slotHashes[2];
+    /// The data the catalog was loaded from, if any.
+    QByteArray m_saved;
+    /// The file \a m_saved is mapped from, if any.
+    QSharedPointer<QFile> m_mappedFile;
+};
+/// \endcond
+
+#endif // QUAZIP_QUAZIPCATALOG_H
@@ -302,7 +302,17 @@ bool QuaZipDirPrivate::entryInfoList(QStringList _nameFilters,
     int baseLength = basePath.length();
     result.clear();
     QuaZipDirRestoreCurrent saveCurrent(zip);
-    if (!zip->goToFirstFile()) {
+    // with the catalog, the listing doesn't have to walk the directory
+    bool useCatalog = zip->isCatalogEnabled();
+    QList<QuaZipFileInfo64> catalog;
+    int index = 0;
+    if (useCatalog) {
+        // only the entries under basePath, found without copying the rest
+        catalog = zip->getFileInfoList64(basePath);
+        if (catalog.isEmpty()) {
+            return zip->getZipError() == UNZ_OK;
+        }
+    } else if (!zip->goToFirstFile()) {
         return zip->getZipError() == UNZ_OK;
     }
     QDir::Filters fltr = _filter;
@@ -316,7 +326,8 @@ bool QuaZipDirPrivate::entryInfoList(QStringList _nameFilters,
     QSet<QString> dirsFound;
     QList<QuaZipFileInfo64> list;
     do {
-        QString name = zip->getCurrentFileName();
+        QString name = useCatalog ? catalog.at(index).name
+                                  : zip->getCurrentFileName();
         if (!name.startsWith(basePath))
             continue;
         QString relativeName = name.mid(baseLength);
@@ -340,6 +351,12 @@ bool QuaZipDirPrivate::entryInfoList(QStringList _nameFilters,
             continue;
         if (!nmfltr.isEmpty() && !QDir::match(nmfltr, relativeName))
             continue;
+        if (useCatalog && isReal) {
+            QuaZipFileInfo64 info = catalog.at(index);
+            info.name = relativeName;
+            list.append(info);
+            continue;
+        }
         bool ok;
         QuaZipFileInfo64 info = QuaZipDir_getFileInfo(zip, &ok, relativeName,
             isReal);
@@ -347,7 +364,7 @@ bool QuaZipDirPrivate::entryInfoList(QStringList _nameFilters,
             return false;
         }
         list.append(info);
-    } while (zip->goToNextFile());
+    } while (useCatalog ? ++index < catalog.size() : zip->goToNextFile());
     QDir::SortFlags srt = sort;
     if (srt == QDir::NoSort)
         srt = sorting;
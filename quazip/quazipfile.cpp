@@ -25,10 +25,104 @@ quazip/(un)zip.h files for details, basically it's zlib license.
 #include "quazipfile.h"
 
 #include "quazipfileinfo.h"
+#include "quazipblockdeflater.h"
+#include "quazip_crc32.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFileDevice>
+#include <QtCore/QThread>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/sendfile.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
 #define QUAZIP_VERSION_MADE_BY 0x1Eu
+#define QUAZIP_DEFAULT_COMPRESSION_BLOCK_SIZE (128 * 1024)
+#define QUAZIP_SEEK_INDEX_MAGIC 0x49535a51u // "QZSI"
+#define QUAZIP_SEEK_INDEX_VERSION 1u
+#define QUAZIP_COPY_BUFFER_SIZE (256 * 1024)
+// the largest piece passed to the kernel, or to crc32_combine()
+#define QUAZIP_COPY_CHUNK_SIZE (1024 * 1024 * 1024)
+
+namespace {
+
+#ifdef Q_OS_LINUX
+// Copies size bytes at inPos of in to outPos of out in the kernel, trying
+// copy_file_range() first and then sendfile(). Returns the number of bytes
+// copied, less than size if the kernel can't copy (the rest of) them, or
+// -1 on an I/O error.
+qint64 quazip_copy_range(int in, qint64 inPos, int out, qint64 outPos, qint64 size)
+{
+    qint64 done = 0;
+    bool copyFileRange = true;
+    while (done < size) {
+        const size_t chunk = static_cast<size_t>(
+                std::min<qint64>(size - done, QUAZIP_COPY_CHUNK_SIZE));
+        ssize_t count;
+        if (copyFileRange) {
+            loff_t from = inPos + done;
+            loff_t to = outPos + done;
+            count = copy_file_range(in, &from, out, &to, chunk, 0);
+            if (count < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL
+                              || errno == EBADF || errno == EOPNOTSUPP)) {
+                copyFileRange = false;
+                continue;
+            }
+        } else {
+            off_t from = static_cast<off_t>(inPos + done);
+            if (lseek(out, static_cast<off_t>(outPos + done), SEEK_SET) < 0)
+                return done;
+            count = sendfile(out, in, &from, chunk);
+            if (count < 0 && (errno == ENOSYS || errno == EINVAL || errno == EBADF))
+                return done;
+        }
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (count == 0)
+            break; // the input is shorter than it should be
+        done += count;
+    }
+    return done;
+}
+
+// Computes the CRC of size bytes at pos of handle, one CRC for each piece
+// of QUAZIP_COPY_CHUNK_SIZE bytes. Returns false on an I/O error.
+bool quazip_crc_range(int handle, qint64 pos, qint64 size, QList<quint32> *crcs)
+{
+    QByteArray buffer(QUAZIP_COPY_BUFFER_SIZE, Qt::Uninitialized);
+    for (qint64 done = 0; done < size; ) {
+        if (done % QUAZIP_COPY_CHUNK_SIZE == 0)
+            crcs->append(static_cast<quint32>(crc32(0L, Z_NULL, 0)));
+        const qint64 chunkEnd = std::min<qint64>(size,
+                (done / QUAZIP_COPY_CHUNK_SIZE + 1) * QUAZIP_COPY_CHUNK_SIZE);
+        ssize_t count = pread(handle, buffer.data(),
+                static_cast<size_t>(std::min<qint64>(chunkEnd - done, buffer.size())),
+                static_cast<off_t>(pos + done));
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0)
+            return false;
+        crcs->last() = static_cast<quint32>(quazip_crc32(crcs->last(),
+                reinterpret_cast<const Bytef*>(buffer.constData()),
+                static_cast<uInt>(count)));
+        done += count;
+    }
+    return true;
+}
+#endif
+
+}
 
 /// The implementation class for QuaZip.
 /**
@@ -70,6 +164,53 @@ class QuaZipFilePrivate {
     bool internal;
     /// The last error.
     int zipError;
+    /// The number of threads to compress with, see setCompressionThreadCount().
+    int compressionThreadCount;
+    /// The size of the blocks compressed by each thread.
+    int compressionBlockSize;
+    /// The interval of the restart points written, 0 to write none.
+    int restartPointInterval;
+    /// Compresses the data written in several threads, if enabled.
+    std::unique_ptr<QuaZipBlockDeflater> blockDeflater;
+    /// A point where inflating can resume, see unzSetAccessPointCallback().
+    struct AccessPoint {
+        quint64 uncompressed;
+        quint64 compressed;
+        int bits;
+        QByteArray window;
+    };
+    /// The interval of the seek index access points, 0 to record none.
+    qint64 seekIndexInterval;
+    /// The access points of the file open for reading, in order.
+    QList<AccessPoint> seekIndex;
+    /// Whether the access points are being recorded.
+    bool seekIndexRecording;
+    /// Whether the file open for reading is positioned without inflating.
+    bool directSeek;
+    /// Adds an access point, called from unzReadCurrentFile().
+    static void ZCALLBACK addAccessPoint(voidpf opaque, ZPOS64_T uncompressed,
+        ZPOS64_T compressed, int bits, const unsigned char *window, uInt windowSize);
+    /// Reads and throws away the data up to \a pos.
+    /** \return \c true if \a pos is reached.
+     **/
+    bool skipTo(qint64 pos);
+    /// Adds the restart points written to the central extra field.
+    int writeRestartPoints();
+    /// Puts the restart points of the file open for reading in the seek index.
+    void readRestartPoints();
+    /// Whether the data written goes to the archive as it is.
+    bool directWrite;
+    /// Copies the data of the file open for reading in the kernel.
+    /** Copies \a size bytes from the start of the data to the current
+     * position of \a device, if both are local files.
+     * \return The number of bytes copied, possibly 0, or -1 on an error.
+     * If \a crc isn't null, the CRC of the bytes copied is added to it.
+     **/
+    qint64 copyRangeTo(QIODevice *device, qint64 size, uLong *crc);
+    /// Copies the rest of \a device to the file open for writing in the kernel.
+    /** \return The number of bytes copied, possibly 0, or -1 on an error.
+     **/
+    qint64 copyRangeFrom(QIODevice *device);
     /// Resets \ref zipError.
     inline void resetZipError() const {setZipError(UNZ_OK);}
     /// Sets the zip error.
@@ -89,7 +230,14 @@ class QuaZipFilePrivate {
       uncompressedSize(0),
       crc(0),
       internal(true),
-      zipError(UNZ_OK) {}
+      zipError(UNZ_OK),
+      compressionThreadCount(1),
+      compressionBlockSize(QUAZIP_DEFAULT_COMPRESSION_BLOCK_SIZE),
+      restartPointInterval(0),
+      seekIndexInterval(0),
+      seekIndexRecording(false),
+      directSeek(false),
+      directWrite(false) {}
     /// The constructor for the corresponding QuaZipFile constructor.
     inline QuaZipFilePrivate(QuaZipFile *_q, const QString &_zipName):
       q(_q),
@@ -99,7 +247,14 @@ class QuaZipFilePrivate {
       uncompressedSize(0),
       crc(0),
       internal(true),
-      zipError(UNZ_OK)
+      zipError(UNZ_OK),
+      compressionThreadCount(1),
+      compressionBlockSize(QUAZIP_DEFAULT_COMPRESSION_BLOCK_SIZE),
+      restartPointInterval(0),
+      seekIndexInterval(0),
+      seekIndexRecording(false),
+      directSeek(false),
+      directWrite(false)
       {
         zip=new QuaZip(_zipName);
       }
@@ -112,7 +267,14 @@ class QuaZipFilePrivate {
       uncompressedSize(0),
       crc(0),
       internal(true),
-      zipError(UNZ_OK)
+      zipError(UNZ_OK),
+      compressionThreadCount(1),
+      compressionBlockSize(QUAZIP_DEFAULT_COMPRESSION_BLOCK_SIZE),
+      restartPointInterval(0),
+      seekIndexInterval(0),
+      seekIndexRecording(false),
+      directSeek(false),
+      directWrite(false)
       {
         zip=new QuaZip(_zipName);
         this->fileName=_fileName;
@@ -129,7 +291,14 @@ class QuaZipFilePrivate {
       uncompressedSize(0),
       crc(0),
       internal(false),
-      zipError(UNZ_OK) {}
+      zipError(UNZ_OK),
+      compressionThreadCount(1),
+      compressionBlockSize(QUAZIP_DEFAULT_COMPRESSION_BLOCK_SIZE),
+      restartPointInterval(0),
+      seekIndexInterval(0),
+      seekIndexRecording(false),
+      directSeek(false),
+      directWrite(false) {}
     /// The destructor.
     inline ~QuaZipFilePrivate()
     {
@@ -241,6 +410,179 @@ void QuaZipFile::setFileName(const QString& fileName, QuaZip::CaseSensitivity cs
   p->caseSensitivity=cs;
 }
 
+void ZCALLBACK QuaZipFilePrivate::addAccessPoint(voidpf opaque, ZPOS64_T uncompressed,
+    ZPOS64_T compressed, int bits, const unsigned char *window, uInt windowSize)
+{
+  QuaZipFilePrivate *p = static_cast<QuaZipFilePrivate*>(opaque);
+  // after a seek back, the same points are passed again
+  if (!p->seekIndex.isEmpty() && uncompressed <= p->seekIndex.last().uncompressed)
+    return;
+  AccessPoint point;
+  point.uncompressed = uncompressed;
+  point.compressed = compressed;
+  point.bits = bits;
+  point.window = QByteArray(reinterpret_cast<const char*>(window), static_cast<int>(windowSize));
+  p->seekIndex.append(point);
+}
+
+bool QuaZipFilePrivate::skipTo(qint64 pos)
+{
+  unzFile uf = zip->getUnzFile();
+  QByteArray buffer(65536, Qt::Uninitialized);
+  qint64 current = static_cast<qint64>(unztell64(uf));
+  while (current < pos) {
+    int bytesRead = unzReadCurrentFile(uf, buffer.data(),
+        static_cast<unsigned>(std::min<qint64>(pos - current, buffer.size())));
+    if (bytesRead < 0) {
+      setZipError(bytesRead);
+      return false;
+    }
+    if (bytesRead == 0)
+      return false; // past the end
+    current += bytesRead;
+  }
+  return true;
+}
+
+int QuaZipFilePrivate::writeRestartPoints()
+{
+  QList<quint64> points = blockDeflater->restartPoints();
+  quint64 interval = static_cast<quint64>(blockDeflater->blockSize());
+  // the room for the points, after the header, the version and the interval
+  const qint64 room = static_cast<qint64>(
+      zipGetCentralExtraFieldRoom(zip->getZipFile())) - 13;
+  // the point i is at the uncompressed offset (i + 1) * interval
+  while (!points.isEmpty() && points.size() * 8 > room) {
+    // keeping every second point, the ones at (i + 1) * interval for odd i,
+    // leaves the points at multiples of twice the interval
+    QList<quint64> kept;
+    for (int i = 1; i < points.size(); i += 2)
+      kept.append(points.at(i));
+    points = kept;
+    interval *= 2;
+  }
+  if (points.isEmpty())
+    return ZIP_OK;
+  QByteArray extra;
+  QDataStream out(&extra, QIODevice::WriteOnly);
+  out.setByteOrder(QDataStream::LittleEndian);
+  out << static_cast<quint16>(QUAZIP_EXTRA_RESTART_POINTS_MAGIC)
+      << static_cast<quint16>(9 + points.size() * 8)
+      << static_cast<quint8>(1) << interval;
+  for (quint64 point : points)
+    out << point;
+  return zipAddCentralExtraField(zip->getZipFile(), extra.constData(),
+      static_cast<uInt>(extra.size()));
+}
+
+void QuaZipFilePrivate::readRestartPoints()
+{
+  QuaZipFileInfo64 info;
+  if (!zip->getCurrentFileInfo(&info) || info.method != Z_DEFLATED || info.isEncrypted())
+    return;
+  const QList<QByteArray> fields =
+      QuaZipFileInfo64::parseExtraField(info.extra).value(QUAZIP_EXTRA_RESTART_POINTS_MAGIC);
+  if (fields.isEmpty())
+    return;
+  QDataStream in(fields.first());
+  in.setByteOrder(QDataStream::LittleEndian);
+  quint8 version = 0;
+  quint64 interval = 0;
+  in >> version >> interval;
+  if (in.status() != QDataStream::Ok || version != 1 || interval == 0)
+    return;
+  QList<AccessPoint> points;
+  quint64 previous = 0;
+  for (quint64 uncompressed = interval; !in.atEnd(); uncompressed += interval) {
+    AccessPoint point;
+    in >> point.compressed;
+    if (in.status() != QDataStream::Ok || uncompressed > info.uncompressedSize
+        || point.compressed <= previous || point.compressed > info.compressedSize)
+      return; // damaged, ignore it all
+    point.uncompressed = uncompressed;
+    point.bits = 0;
+    points.append(point);
+    previous = point.compressed;
+  }
+  seekIndex = points;
+}
+
+qint64 QuaZipFilePrivate::copyRangeTo(QIODevice *device, qint64 size, uLong *crc)
+{
+#ifdef Q_OS_LINUX
+  QFileDevice *archive = qobject_cast<QFileDevice*>(
+      static_cast<QIODevice*>(unzGetStream(zip->getUnzFile())));
+  QFileDevice *file = qobject_cast<QFileDevice*>(device);
+  if (archive == nullptr || file == nullptr || archive->handle() == -1
+      || file->handle() == -1 || !file->flush())
+    return 0;
+  const qint64 from = static_cast<qint64>(unzGetCurrentFileZStreamPos64(zip->getUnzFile()));
+  const qint64 to = file->pos();
+  const qint64 copied = quazip_copy_range(archive->handle(), from, file->handle(), to, size);
+  if (copied <= 0)
+    return copied;
+  if (!file->seek(to + copied))
+    return -1;
+  if (crc != nullptr) {
+    QList<quint32> crcs;
+    if (!quazip_crc_range(archive->handle(), from, copied, &crcs))
+      return -1;
+    for (int i = 0; i < crcs.size(); ++i) {
+      const qint64 length = std::min<qint64>(copied - i * qint64(QUAZIP_COPY_CHUNK_SIZE),
+                                             QUAZIP_COPY_CHUNK_SIZE);
+      *crc = crc32_combine(*crc, crcs.at(i), static_cast<z_off_t>(length));
+    }
+  }
+  return copied;
+#else
+  Q_UNUSED(device);
+  Q_UNUSED(size);
+  Q_UNUSED(crc);
+  return 0;
+#endif
+}
+
+qint64 QuaZipFilePrivate::copyRangeFrom(QIODevice *device)
+{
+#ifdef Q_OS_LINUX
+  QFileDevice *archive = qobject_cast<QFileDevice*>(
+      static_cast<QIODevice*>(zipGetStream(zip->getZipFile())));
+  QFileDevice *file = qobject_cast<QFileDevice*>(device);
+  if (archive == nullptr || file == nullptr || archive->handle() == -1
+      || file->handle() == -1 || file->isSequential() || archive->isSequential())
+    return 0;
+  zipFile zf = zip->getZipFile();
+  // whatever minizip and the archive device have buffered goes first
+  setZipError(zipWrittenInFileInZip64(zf, 0, 0));
+  if (zipError != ZIP_OK)
+    return -1;
+  if (!archive->flush())
+    return -1;
+  const qint64 from = file->pos();
+  const qint64 to = archive->pos();
+  const qint64 copied = quazip_copy_range(file->handle(), from, archive->handle(), to,
+                                          file->size() - from);
+  if (copied <= 0)
+    return copied;
+  QList<quint32> crcs;
+  if (!quazip_crc_range(file->handle(), from, copied, &crcs)
+      || !archive->seek(to + copied) || !file->seek(from + copied))
+    return -1;
+  for (int i = 0; i < crcs.size(); ++i) {
+    const qint64 length = std::min<qint64>(copied - i * qint64(QUAZIP_COPY_CHUNK_SIZE),
+                                           QUAZIP_COPY_CHUNK_SIZE);
+    setZipError(zipWrittenInFileInZip64(zf, static_cast<ZPOS64_T>(length), crcs.at(i)));
+    if (zipError != ZIP_OK)
+      return -1;
+  }
+  writePos += copied;
+  return copied;
+#else
+  Q_UNUSED(device);
+  return 0;
+#endif
+}
+
 void QuaZipFilePrivate::setZipError(int _zipError) const
 {
   QuaZipFilePrivate *fakeThis = const_cast<QuaZipFilePrivate*>(this); // non-const
@@ -299,6 +641,18 @@ bool QuaZipFile::open(OpenMode mode, int *method, int *level, bool raw, const ch
     }
     setOpenMode(mode);
     p->raw=raw;
+    p->seekIndex.clear();
+    unz_file_info64 info_z;
+    p->directSeek = unzGetCurrentFileInfo64(p->zip->getUnzFile(), &info_z,
+        nullptr, 0, nullptr, 0, nullptr, 0) == UNZ_OK
+        && (raw || info_z.compression_method == 0);
+    if (!p->directSeek)
+      p->readRestartPoints();
+    // fails for the files that can't have access points, which is fine
+    p->seekIndexRecording = p->seekIndexInterval > 0 && !p->directSeek
+        && unzSetAccessPointCallback(p->zip->getUnzFile(),
+              static_cast<ZPOS64_T>(p->seekIndexInterval),
+              QuaZipFilePrivate::addAccessPoint, p) == UNZ_OK;
     return true;
   }
   qWarning("QuaZipFile::open(): open mode %d not supported by this function", (int)mode);
@@ -330,6 +684,14 @@ bool QuaZipFile::open(OpenMode mode, const QuaZipNewInfo& info,
           (int)mode, static_cast<int>(p->zip->getMode()));
       return false;
     }
+    int threadCount = p->compressionThreadCount;
+    if (threadCount <= 0)
+      threadCount = QThread::idealThreadCount();
+    const bool restartPoints = p->restartPointInterval > 0;
+    // the blocks are written raw, so the CRC is only known at the end
+    const bool blocks = (threadCount > 1 || restartPoints) && method == Z_DEFLATED
+        && !raw && password == nullptr && windowBits == -MAX_WBITS;
+    p->blockDeflater.reset();
     info_z.tmz_date.tm_year=info.dateTime.date().year();
     info_z.tmz_date.tm_mon=info.dateTime.date().month() - 1;
     info_z.tmz_date.tm_mday=info.dateTime.date().day();
@@ -349,7 +711,7 @@ bool QuaZipFile::open(OpenMode mode, const QuaZipNewInfo& info,
           info.extraLocal.constData(), info.extraLocal.length(),
           info.extraGlobal.constData(), info.extraGlobal.length(),
           info.comment.toUtf8().constData(),
-          method, level, static_cast<int>(raw),
+          method, level, static_cast<int>(raw || blocks),
           windowBits, memLevel, strategy,
           password, static_cast<uLong>(crc),
           (p->zip->getOsCode() << 8) | QUAZIP_VERSION_MADE_BY,
@@ -361,10 +723,17 @@ bool QuaZipFile::open(OpenMode mode, const QuaZipNewInfo& info,
     p->writePos=0;
     setOpenMode(mode);
     p->raw=raw;
+    p->directWrite = (raw || method == 0) && password == nullptr;
     if(raw) {
       p->crc=crc;
       p->uncompressedSize=info.uncompressedSize;
     }
+    if (blocks) {
+      p->blockDeflater.reset(new QuaZipBlockDeflater(p->zip->getZipFile(),
+            std::max(threadCount, 1),
+            restartPoints ? p->restartPointInterval : p->compressionBlockSize,
+            level, memLevel, strategy, restartPoints));
+    }
     return true;
   }
   qWarning("QuaZipFile::open(): open mode %d not supported by this function", (int)mode);
@@ -470,10 +839,24 @@ void QuaZipFile::close()
     qWarning("QuaZipFile::close(): file isn't open");
     return;
   }
-  if(openMode()&ReadOnly)
+  if(openMode()&ReadOnly) {
     p->setZipError(unzCloseCurrentFile(p->zip->getUnzFile()));
+    p->seekIndex.clear();
+    p->seekIndexRecording = false;
+  }
   else if(openMode()&WriteOnly)
-    if(isRaw()) p->setZipError(zipCloseFileInZipRaw64(p->zip->getZipFile(), p->uncompressedSize, p->crc));
+    if (p->blockDeflater) {
+      int err = p->blockDeflater->finish();
+      if (err == ZIP_OK)
+        err = p->writeRestartPoints();
+      // the entry is closed even on errors, or zip.c would close it later
+      // as an ordinary one; the first error is the one reported
+      const int closeErr = zipCloseFileInZipRaw64(p->zip->getZipFile(),
+              p->blockDeflater->uncompressedSize(), p->blockDeflater->crc());
+      p->setZipError(err != ZIP_OK ? err : closeErr);
+      p->blockDeflater.reset();
+    }
+    else if(isRaw()) p->setZipError(zipCloseFileInZipRaw64(p->zip->getZipFile(), p->uncompressedSize, p->crc));
     else p->setZipError(zipCloseFileInZip(p->zip->getZipFile()));
   else {
     qWarning("Wrong open mode: %d", (int)openMode());
@@ -501,7 +884,10 @@ qint64 QuaZipFile::readData(char *data, qint64 maxSize)
 qint64 QuaZipFile::writeData(const char* data, qint64 maxSize)
 {
   p->setZipError(ZIP_OK);
-  p->setZipError(zipWriteInFileInZip(p->zip->getZipFile(), data, static_cast<uint>(maxSize)));
+  if (p->blockDeflater)
+    p->setZipError(p->blockDeflater->write(data, maxSize));
+  else
+    p->setZipError(zipWriteInFileInZip(p->zip->getZipFile(), data, static_cast<uint>(maxSize)));
   if (p->zipError != ZIP_OK) {
     return -1;
   }
@@ -509,6 +895,161 @@ qint64 QuaZipFile::writeData(const char* data, qint64 maxSize)
   return maxSize;
 }
 
+void QuaZipFile::setSeekIndexInterval(qint64 interval)
+{
+  p->seekIndexInterval = interval;
+}
+
+qint64 QuaZipFile::getSeekIndexInterval() const
+{
+  return p->seekIndexInterval;
+}
+
+bool QuaZipFile::seek(qint64 pos)
+{
+  if (p->zip == nullptr || !isOpen() || !(openMode() & ReadOnly))
+    return QIODevice::seek(pos);
+  p->resetZipError();
+  if (pos < 0)
+    return false;
+  unzFile uf = p->zip->getUnzFile();
+  // whatever QIODevice has buffered is from the old position
+  QIODevice::skip(QIODevice::bytesAvailable());
+  if (p->directSeek) {
+    p->setZipError(unzSeekCurrentFile64(uf, static_cast<ZPOS64_T>(pos),
+          static_cast<ZPOS64_T>(pos), 0, nullptr, 0));
+    return p->zipError == UNZ_OK;
+  }
+  const qint64 current = static_cast<qint64>(unztell64(uf));
+  // the last access point not after pos
+  auto next = std::upper_bound(p->seekIndex.cbegin(), p->seekIndex.cend(), pos,
+      [](qint64 pos, const QuaZipFilePrivate::AccessPoint &point) {
+        return static_cast<quint64>(pos) < point.uncompressed;
+      });
+  const QuaZipFilePrivate::AccessPoint *point =
+      next == p->seekIndex.cbegin() ? nullptr : &*(next - 1);
+  const qint64 resume = point == nullptr ? 0 : static_cast<qint64>(point->uncompressed);
+  if (pos < current || resume > current) {
+    int err = point == nullptr
+        ? unzSeekCurrentFile64(uf, 0, 0, 0, nullptr, 0)
+        : unzSeekCurrentFile64(uf, point->uncompressed, point->compressed, point->bits,
+              reinterpret_cast<const unsigned char*>(point->window.constData()),
+              static_cast<uInt>(point->window.size()));
+    if (err != UNZ_OK) {
+      p->setZipError(err);
+      return false;
+    }
+  }
+  return p->skipTo(pos);
+}
+
+bool QuaZipFile::buildSeekIndex()
+{
+  p->resetZipError();
+  if (p->zip == nullptr || !isOpen() || !(openMode() & ReadOnly))
+    return false;
+  if (p->directSeek)
+    return true; // needs no index
+  if (!p->seekIndexRecording)
+    return false;
+  const qint64 current = pos();
+  // the points before the last one are known already
+  if (!seek(p->seekIndex.isEmpty() ? 0 : static_cast<qint64>(p->seekIndex.last().uncompressed)))
+    return false;
+  if (!p->skipTo(std::numeric_limits<qint64>::max()) && p->zipError != UNZ_OK)
+    return false;
+  return seek(current);
+}
+
+QByteArray QuaZipFile::getSeekIndex() const
+{
+  p->resetZipError();
+  if (p->zip == nullptr || !isOpen() || !(openMode() & ReadOnly) || p->seekIndex.isEmpty())
+    return QByteArray();
+  unz_file_info64 info_z;
+  p->setZipError(unzGetCurrentFileInfo64(p->zip->getUnzFile(), &info_z,
+        nullptr, 0, nullptr, 0, nullptr, 0));
+  if (p->zipError != UNZ_OK)
+    return QByteArray();
+  QByteArray index;
+  QDataStream out(&index, QIODevice::WriteOnly);
+  out << static_cast<quint32>(QUAZIP_SEEK_INDEX_MAGIC)
+      << static_cast<quint32>(QUAZIP_SEEK_INDEX_VERSION)
+      << static_cast<quint32>(info_z.crc)
+      << static_cast<quint64>(info_z.compressed_size)
+      << static_cast<quint64>(info_z.uncompressed_size)
+      << static_cast<quint32>(p->seekIndex.size());
+  for (const auto &point : p->seekIndex)
+    out << point.uncompressed << point.compressed << static_cast<qint8>(point.bits) << point.window;
+  return index;
+}
+
+bool QuaZipFile::setSeekIndex(const QByteArray &index)
+{
+  p->resetZipError();
+  if (p->zip == nullptr || !isOpen() || !(openMode() & ReadOnly))
+    return false;
+  unz_file_info64 info_z;
+  p->setZipError(unzGetCurrentFileInfo64(p->zip->getUnzFile(), &info_z,
+        nullptr, 0, nullptr, 0, nullptr, 0));
+  if (p->zipError != UNZ_OK)
+    return false;
+  QDataStream in(index);
+  quint32 magic = 0, version = 0, crc = 0, count = 0;
+  quint64 compressedSize = 0, uncompressedSize = 0;
+  in >> magic >> version >> crc >> compressedSize >> uncompressedSize >> count;
+  if (in.status() != QDataStream::Ok || magic != QUAZIP_SEEK_INDEX_MAGIC
+      || version != QUAZIP_SEEK_INDEX_VERSION || crc != info_z.crc
+      || compressedSize != info_z.compressed_size
+      || uncompressedSize != info_z.uncompressed_size)
+    return false;
+  QList<QuaZipFilePrivate::AccessPoint> points;
+  for (quint32 i = 0; i < count; ++i) {
+    QuaZipFilePrivate::AccessPoint point;
+    qint8 bits = 0;
+    in >> point.uncompressed >> point.compressed >> bits >> point.window;
+    point.bits = bits;
+    if (in.status() != QDataStream::Ok || bits < 0 || bits > 7
+        || point.uncompressed > uncompressedSize || point.compressed > compressedSize
+        || point.window.size() > UNZ_WINDOW_SIZE
+        || (!points.isEmpty() && point.uncompressed <= points.last().uncompressed))
+      return false;
+    points.append(point);
+  }
+  p->seekIndex = points;
+  return true;
+}
+
+void QuaZipFile::setCompressionThreadCount(int threadCount)
+{
+  p->compressionThreadCount = threadCount;
+}
+
+int QuaZipFile::getCompressionThreadCount() const
+{
+  return p->compressionThreadCount;
+}
+
+void QuaZipFile::setCompressionBlockSize(int blockSize)
+{
+  p->compressionBlockSize = blockSize;
+}
+
+int QuaZipFile::getCompressionBlockSize() const
+{
+  return p->compressionBlockSize;
+}
+
+void QuaZipFile::setRestartPointInterval(int interval)
+{
+  p->restartPointInterval = interval;
+}
+
+int QuaZipFile::getRestartPointInterval() const
+{
+  return p->restartPointInterval;
+}
+
 QString QuaZipFile::getFileName() const
 {
   return p->fileName;
@@ -546,6 +1087,94 @@ QByteArray QuaZipFile::getLocalExtraField()
     return extra;
 }
 
+QByteArray QuaZipFile::mappedData() const
+{
+    p->setZipError(UNZ_OK);
+    if (p->zip == nullptr || p->zip->getMode() != QuaZip::mdUnzip || !isOpen())
+        return QByteArray();
+    const void *view = nullptr;
+    ZPOS64_T size = 0;
+    int err = unzGetCurrentFileView64(p->zip->getUnzFile(), &view, &size);
+    if (err == UNZ_PARAMERROR) // just not viewable, not an error
+        return QByteArray();
+    p->setZipError(err);
+    if (err != UNZ_OK
+            || size > static_cast<ZPOS64_T>(std::numeric_limits<qsizetype>::max()))
+        return QByteArray();
+    return QByteArray::fromRawData(static_cast<const char*>(view),
+                                   static_cast<qsizetype>(size));
+}
+
+bool QuaZipFile::copyTo(QIODevice *device, bool checkCrc)
+{
+  p->resetZipError();
+  if (p->zip == nullptr || !isOpen() || !(openMode() & ReadOnly)) {
+    qWarning("QuaZipFile::copyTo(): file is not open for reading");
+    return false;
+  }
+  QuaZipFileInfo64 info;
+  // the fast ways only work for the data as it is, from the start
+  const bool fast = p->directSeek && pos() == 0 && getFileInfo(&info) && !info.isEncrypted();
+  checkCrc = fast && checkCrc && !p->raw;
+  uLong crc = crc32(0L, Z_NULL, 0);
+  if (fast) {
+    const qint64 size = static_cast<qint64>(p->raw ? info.compressedSize : info.uncompressedSize);
+    const QByteArray data = mappedData();
+    qint64 copied;
+    if (size != 0 && data.size() == size) {
+      // a uInt length at a time, or files of 4 GB and more get a wrong CRC
+      for (qint64 done = 0; checkCrc && done < size; done += QUAZIP_COPY_CHUNK_SIZE) {
+        crc = quazip_crc32(crc, reinterpret_cast<const Bytef*>(data.constData() + done),
+                    static_cast<uInt>(std::min<qint64>(size - done, QUAZIP_COPY_CHUNK_SIZE)));
+      }
+      copied = device->write(data) == size ? size : -1;
+    } else {
+      copied = p->copyRangeTo(device, size, checkCrc ? &crc : nullptr);
+    }
+    // unzip isn't told about the data copied, so it doesn't check the CRC
+    if (copied < 0 || (copied > 0 && !seek(copied)))
+      return false;
+  }
+  // the rest the usual way
+  QByteArray buffer(QUAZIP_COPY_BUFFER_SIZE, Qt::Uninitialized);
+  while (!atEnd()) {
+    const qint64 bytesRead = read(buffer.data(), buffer.size());
+    if (bytesRead <= 0)
+      return false;
+    if (checkCrc)
+      crc = quazip_crc32(crc, reinterpret_cast<const Bytef*>(buffer.constData()),
+                  static_cast<uInt>(bytesRead));
+    if (device->write(buffer.constData(), bytesRead) != bytesRead)
+      return false;
+  }
+  if (p->zipError != UNZ_OK)
+    return false;
+  if (checkCrc && static_cast<quint32>(crc) != info.crc) {
+    p->setZipError(UNZ_CRCERROR);
+    return false;
+  }
+  return true;
+}
+
+bool QuaZipFile::copyFrom(QIODevice *device)
+{
+  p->resetZipError();
+  if (p->zip == nullptr || !isOpen() || !(openMode() & WriteOnly)) {
+    qWarning("QuaZipFile::copyFrom(): file is not open for writing");
+    return false;
+  }
+  if (p->directWrite && p->copyRangeFrom(device) < 0)
+    return false;
+  // the rest the usual way
+  QByteArray buffer(QUAZIP_COPY_BUFFER_SIZE, Qt::Uninitialized);
+  while (!device->atEnd()) {
+    const qint64 bytesRead = device->read(buffer.data(), buffer.size());
+    if (bytesRead <= 0 || write(buffer.constData(), bytesRead) != bytesRead)
+      return false;
+  }
+  return p->zipError == ZIP_OK;
+}
+
 QDateTime QuaZipFile::getExtModTime()
 {
     return QuaZipFileInfo64::getExtTime(getLocalExtraField(), QUAZIP_EXTRA_EXT_MOD_TIME_FLAG);
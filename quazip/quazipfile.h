@@ -70,6 +70,12 @@ class QuaZipFilePrivate;
  * size() and pos() functions. This should be kept in mind while using
  * this class.
  *
+ * Still, seek() works when reading. Stored files, and any file open in
+ * the raw mode, are positioned right away. Deflated files are re-read
+ * from the start, or, if they have a \ref setSeekIndexInterval()
+ * "seek index" or were written with \ref setRestartPointInterval()
+ * "restart points", from the nearest point before the position.
+ *
  **/
 class QUAZIP_EXPORT QuaZipFile: public QIODevice {
   friend class QuaZipFilePrivate;
@@ -347,6 +353,126 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
         const char *password =nullptr, quint32 crc =0,
         int method =Z_DEFLATED, int level =Z_DEFAULT_COMPRESSION, bool raw =false,
         int windowBits =-MAX_WBITS, int memLevel =DEF_MEM_LEVEL, int strategy =Z_DEFAULT_STRATEGY);
+    /// Sets the number of threads compressing the data written.
+    /** Takes effect on the next open() for writing. If it is more than
+     * 1 (or 0 or less, which means QThread::idealThreadCount()), the
+     * data written is cut into blocks of getCompressionBlockSize()
+     * bytes, which are deflated by that many threads at once. Each block
+     * is primed with the end of the previous one, and all of them make up
+     * a single ordinary deflate stream, readable by any unzip. The
+     * compression ratio is slightly worse than when compressing in one
+     * thread, and the output is not the same.
+     *
+     * This is only done for the Z_DEFLATED method with the default
+     * \a windowBits and without a password, otherwise the file is
+     * compressed in the calling thread as usual.
+     *
+     * The default is 1, compressing in the calling thread.
+     **/
+    void setCompressionThreadCount(int threadCount);
+    /// Returns the number of threads compressing the data written.
+    /** \sa setCompressionThreadCount()
+     **/
+    int getCompressionThreadCount() const;
+    /// Sets the size of the blocks compressed by each thread.
+    /** The default is 128 KiB, and anything less than 32 KiB is treated
+     * as 32 KiB. Takes effect on the next open() for writing.
+     *
+     * \sa setCompressionThreadCount()
+     **/
+    void setCompressionBlockSize(int blockSize);
+    /// Returns the size of the blocks compressed by each thread.
+    /** \sa setCompressionBlockSize()
+     **/
+    int getCompressionBlockSize() const;
+    /// Sets the interval of the restart points written.
+    /** If \a interval is positive, the data written is deflated in
+     * independent pieces of \a interval bytes, as if Z_FULL_FLUSH was
+     * done after each one, and the compressed offsets where they start
+     * are stored in an extra field of the central directory. When the
+     * file is read by QuaZipFile, seek() goes straight to the nearest
+     * restart point without having to build a \ref setSeekIndexInterval()
+     * "seek index" first. For any other unzip, this is just an ordinary
+     * deflated file with an unknown extra field.
+     *
+     * The restart points cost some compression ratio, the more so the
+     * shorter the interval; anything less than 32 KiB is treated as
+     * 32 KiB. If there are too many of them to fit the extra field,
+     * every other one is dropped, as many times as needed.
+     *
+     * The pieces are deflated just like the blocks described in
+     * setCompressionThreadCount(), by as many threads, the interval being
+     * the block size, and with the same restrictions on the method, the
+     * window bits and the password.
+     *
+     * Takes effect on the next open() for writing. The default is 0,
+     * writing no restart points.
+     **/
+    void setRestartPointInterval(int interval);
+    /// Returns the interval of the restart points written.
+    /** \sa setRestartPointInterval()
+     **/
+    int getRestartPointInterval() const;
+    /// Sets the interval of the seek index access points.
+    /** If \a interval is positive, an access point is recorded about every
+     * \a interval bytes of uncompressed data while a deflated file is
+     * read, and then seek() resumes inflating from the nearest one
+     * instead of from the start of the file. Each point takes 32 KiB
+     * of memory, so with the interval of 1 MiB the index takes about 3%
+     * of the uncompressed size.
+     *
+     * The index is built as the file is read, or at once with
+     * buildSeekIndex(), and is discarded when the file is closed, but
+     * it can be saved with getSeekIndex() and restored with
+     * setSeekIndex().
+     *
+     * Takes effect on the next open() for reading. The default is 0,
+     * recording nothing.
+     **/
+    void setSeekIndexInterval(qint64 interval);
+    /// Returns the interval of the seek index access points.
+    /** \sa setSeekIndexInterval()
+     **/
+    qint64 getSeekIndexInterval() const;
+    /// Builds the seek index of the file open for reading.
+    /** Reads the file from the last recorded access point to the end
+     * and goes back to the current position, so this is cheap if the
+     * index is complete already.
+     *
+     * \return \c true on success, including the files that need no
+     * index, \c false if there is no seek index for this file (see
+     * setSeekIndexInterval()) or an error occurs.
+     **/
+    bool buildSeekIndex();
+    /// Returns the seek index of the file open for reading.
+    /** The index can be stored anywhere and passed to setSeekIndex()
+     * when the same file is open again, possibly by another QuaZipFile
+     * or in another process. It contains the access points recorded so
+     * far, call buildSeekIndex() first to get them all.
+     *
+     * \return The index, or an empty array if there is none.
+     **/
+    QByteArray getSeekIndex() const;
+    /// Restores the seek index of the file open for reading.
+    /** \a index must have been returned by getSeekIndex() for the same
+     * file. The index is checked against the CRC and the sizes of the
+     * file, but not against the data.
+     *
+     * \return \c true if the index was restored, \c false if it isn't
+     * for this file or is damaged.
+     **/
+    bool setSeekIndex(const QByteArray &index);
+    /// Goes to the position \a pos of the file open for reading.
+    /** See \ref quazipfile-sequential "this" for how fast it is.
+     * When writing, this fails just as it does for any other
+     * sequential device.
+     *
+     * \return \c true on success, \c false if the position is out of
+     * range or the file can't be positioned, such as a file that is
+     * encrypted or compressed with bzip2 for a position before the
+     * current one.
+     **/
+    bool seek(qint64 pos) override;
     /// Returns \c true, but \ref quazipfile-sequential "beware"!
     bool isSequential()const override;
     /// Returns current position in the file.
@@ -468,6 +594,54 @@ class QUAZIP_EXPORT QuaZipFile: public QIODevice {
         (or file is not open)
       */
     QByteArray getLocalExtraField();
+    /// Returns the data of the file without copying it.
+    /**
+      If the archive is \ref QuaZip::setMemoryMappingEnabled() "memory-mapped"
+      and the file is open for reading either in raw mode or stored without
+      compression, returns the data of the whole file as an array that
+      references the mapping directly. This is the fastest way to get at
+      stored data, as nothing is read or copied at all. The current
+      position in the file doesn't matter and doesn't change.
+
+      The array is only valid until the archive is closed. Unlike read(),
+      this doesn't check the CRC.
+
+      @return the data, or a null array if it can't be accessed this way,
+        for example because the file is compressed, encrypted or the
+        archive isn't mapped
+      */
+    QByteArray mappedData() const;
+    /// Copies the rest of the file open for reading to \a device.
+    /**
+      If nothing has been read yet, and the file is stored without
+      compression (or open in raw mode) and not encrypted, the data
+      doesn't go through the usual buffers: it is written right from the
+      mapping if the archive is \ref QuaZip::setMemoryMappingEnabled()
+      "memory-mapped", or, if both the archive and \a device are local
+      files, copied by the kernel (copy_file_range() or sendfile() on
+      Linux). Otherwise, or for whatever the kernel couldn't copy, it is
+      read and written as usual.
+
+      On the fast paths, unzip doesn't see the data, so its CRC is
+      checked with an extra pass over it, unless \a checkCrc is \c false.
+      That pass only reads, so it is still cheaper than copying. The CRC
+      of a file in raw mode can't be checked.
+
+      @return \c true on success, \c false on an I/O error or a CRC
+        mismatch (getZipError() is then UNZ_CRCERROR)
+      */
+    bool copyTo(QIODevice *device, bool checkCrc = true);
+    /// Writes the rest of \a device to the file open for writing.
+    /**
+      If the file is stored without compression (or open in raw mode) and
+      not encrypted, and both the archive and \a device are local files,
+      the data is copied by the kernel (copy_file_range() or sendfile() on
+      Linux) and then read once more to compute the CRC. Otherwise, or for
+      whatever the kernel couldn't copy, it is read and written as usual.
+
+      @return \c true on success, \c false on an I/O error
+      */
+    bool copyFrom(QIODevice *device);
     /// Returns the extended modification timestamp
     /**
     * The getExt*Time() functions only work if there is an extended timestamp
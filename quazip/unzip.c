@@ -78,6 +78,7 @@
 typedef uLongf z_crc_t;
 #endif
 #include "unzip.h"
+#include "quazip_crc32.h"
 
 #ifdef STDC
 #  include <stddef.h>
@@ -161,6 +162,13 @@ typedef struct
     uLong compression_method;   /* compression method (0==store) */
     ZPOS64_T byte_before_the_zipfile;/* byte before the zipfile, (>0 for sfx)*/
     int   raw;
+    int   crc_checked;          /* 0 if some data was skipped by a seek */
+
+    unz_access_point_func access_point_func; /* NULL if none wanted */
+    voidpf access_point_opaque;
+    ZPOS64_T access_point_span;  /* minimal distance between access points */
+    ZPOS64_T last_access_point;  /* uncompressed offset of the last one */
+    unsigned char* window;       /* for the access points, UNZ_WINDOW_SIZE */
 } file_in_zip64_read_info_s;
 
 
@@ -181,6 +189,8 @@ typedef struct
     ZPOS64_T size_central_dir;     /* size of the central directory  */
     ZPOS64_T offset_central_dir;   /* offset of start of central directory with
                                    respect to the starting disk number */
+    unsigned char* central_dir;    /* the whole central directory, read once
+                                   at open, NULL if it couldn't be loaded */
 
     unz_file_info64 cur_file_info; /* public info about the current file in zip*/
     unz_file_info64_internal cur_file_info_internal; /* private info about it*/
@@ -345,6 +355,30 @@ local int unz64local_getLong64 (const zlib_filefunc64_32_def* pzlib_filefunc_def
     return err;
 }
 
+/* ===========================================================================
+   Reads little-endian values from a memory buffer, used to parse the
+   central directory once it has been loaded with a single read.
+*/
+local uLong unz64local_bufGetShort OF((const unsigned char* p));
+local uLong unz64local_bufGetShort (const unsigned char* p)
+{
+    return (uLong)p[0] | ((uLong)p[1]<<8);
+}
+
+local uLong unz64local_bufGetLong OF((const unsigned char* p));
+local uLong unz64local_bufGetLong (const unsigned char* p)
+{
+    return (uLong)p[0] | ((uLong)p[1]<<8) |
+        ((uLong)p[2]<<16) | ((uLong)p[3]<<24);
+}
+
+local ZPOS64_T unz64local_bufGetLong64 OF((const unsigned char* p));
+local ZPOS64_T unz64local_bufGetLong64 (const unsigned char* p)
+{
+    return (ZPOS64_T)unz64local_bufGetLong(p) |
+        ((ZPOS64_T)unz64local_bufGetLong(p+4)<<32);
+}
+
 /* My own strcmpi / strcasecmp */
 local int strcmpcasenosensitive_internal (const char* fileName1, const char* fileName2)
 {
@@ -572,6 +606,54 @@ local ZPOS64_T unz64local_SearchCentralDir64(const zlib_filefunc64_32_def* pzlib
     return relativeOffset;
 }
 
+/*
+  Read the whole central directory into memory with as few reads as
+  possible, so that walking the entries doesn't go through the I/O
+  callbacks byte by byte. Returns NULL if the directory couldn't be loaded,
+  in which case the records are read from the file as before.
+*/
+#ifndef UNZ_MAXCENTRALDIRCHUNK
+#define UNZ_MAXCENTRALDIRCHUNK (0x40000000)
+#endif
+
+local unsigned char* unz64local_LoadCentralDir OF((
+    const zlib_filefunc64_32_def* pzlib_filefunc_def,
+    voidpf filestream,
+    ZPOS64_T offset,
+    ZPOS64_T size));
+
+local unsigned char* unz64local_LoadCentralDir(const zlib_filefunc64_32_def* pzlib_filefunc_def,
+                                               voidpf filestream,
+                                               ZPOS64_T offset,
+                                               ZPOS64_T size)
+{
+    unsigned char* buf;
+    ZPOS64_T done = 0;
+
+    if ((size == 0) || (size != (ZPOS64_T)(size_t)size))
+        return NULL;
+
+    if (ZSEEK64(*pzlib_filefunc_def,filestream,offset,ZLIB_FILEFUNC_SEEK_SET)!=0)
+        return NULL;
+
+    buf = (unsigned char*)ALLOC((size_t)size);
+    if (buf==NULL)
+        return NULL;
+
+    while (done < size)
+    {
+        uLong chunk = (size - done > UNZ_MAXCENTRALDIRCHUNK) ?
+            (uLong)UNZ_MAXCENTRALDIRCHUNK : (uLong)(size - done);
+        if (ZREAD64(*pzlib_filefunc_def,filestream,buf+done,chunk)!=chunk)
+        {
+            TRYFREE(buf);
+            return NULL;
+        }
+        done += chunk;
+    }
+    return buf;
+}
+
 /*
   Open a Zip file. path contain the full pathname (by example,
      on a Windows NT computer "c:\\test\\zlib114.zip" or on an Unix computer
@@ -606,6 +688,8 @@ extern unzFile unzOpenInternal (voidpf file,
     us.flags = flags;
     us.z_filefunc.zseek32_file = NULL;
     us.z_filefunc.ztell32_file = NULL;
+    us.z_filefunc.zview64_file = NULL;
+    us.z_filefunc.zflush64_file = NULL;
     if (pzlib_filefunc64_32_def==NULL)
         fill_qiodevice64_filefunc(&us.z_filefunc.zfile_func64);
     else
@@ -754,6 +838,11 @@ extern unzFile unzOpenInternal (voidpf file,
     us.central_pos = central_pos;
     us.pfile_in_zip_read = NULL;
     us.encrypted = 0;
+    us.central_dir = NULL;
+    if ((us.flags & UNZ_DEFER_CENTRAL_DIR) == 0)
+        us.central_dir = unz64local_LoadCentralDir(&us.z_filefunc, us.filestream,
+                                                   us.offset_central_dir+us.byte_before_the_zipfile,
+                                                   us.size_central_dir);
 
 
     s=(unz64_s*)ALLOC(sizeof(unz64_s));
@@ -762,6 +851,57 @@ extern unzFile unzOpenInternal (voidpf file,
         *s=us;
         unzGoToFirstFile((unzFile)s);
     }
+    else
+        TRYFREE(us.central_dir);
+    return (unzFile)s;
+}
+
+
+/*
+  Open another handle to the zipfile that file is open on, without looking
+  for the central directory again. The new handle has its own stream,
+  opened with the given I/O functions on the stream of file, its own
+  current file and its own file to read, so that both handles can be used
+  independently, even from different threads if the I/O functions allow
+  it. Only UNZ_DEFER_CENTRAL_DIR and UNZ_AUTO_CLOSE are used from flags.
+*/
+extern unzFile ZEXPORT unzOpenShared (unzFile file,
+                                      zlib_filefunc64_32_def* pzlib_filefunc64_32_def,
+                                      unsigned flags)
+{
+    unz64_s us;
+    unz64_s *s;
+    if ((file==NULL) || (pzlib_filefunc64_32_def==NULL))
+        return NULL;
+    us=*(unz64_s*)file;
+    us.flags = flags;
+    us.z_filefunc = *pzlib_filefunc64_32_def;
+    us.filestream = ZOPEN64(us.z_filefunc,
+                            ((unz64_s*)file)->filestream,
+                            ZLIB_FILEFUNC_MODE_READ |
+                            ZLIB_FILEFUNC_MODE_EXISTING);
+    if (us.filestream==NULL)
+        return NULL;
+    us.pfile_in_zip_read = NULL;
+    us.encrypted = 0;
+    us.central_dir = NULL;
+    if ((us.flags & UNZ_DEFER_CENTRAL_DIR) == 0)
+        us.central_dir = unz64local_LoadCentralDir(&us.z_filefunc, us.filestream,
+                                                   us.offset_central_dir+us.byte_before_the_zipfile,
+                                                   us.size_central_dir);
+
+    s=(unz64_s*)ALLOC(sizeof(unz64_s));
+    if (s==NULL)
+    {
+        TRYFREE(us.central_dir);
+        if ((us.flags & UNZ_AUTO_CLOSE) != 0)
+            ZCLOSE64(us.z_filefunc, us.filestream);
+        else
+            ZFAKECLOSE64(us.z_filefunc, us.filestream);
+        return NULL;
+    }
+    *s=us;
+    unzGoToFirstFile((unzFile)s);
     return (unzFile)s;
 }
 
@@ -787,6 +927,8 @@ extern unzFile ZEXPORT unzOpen2_64 (voidpf file,
         zlib_filefunc64_32_def_fill.zfile_func64 = *pzlib_filefunc_def;
         zlib_filefunc64_32_def_fill.ztell32_file = NULL;
         zlib_filefunc64_32_def_fill.zseek32_file = NULL;
+        zlib_filefunc64_32_def_fill.zview64_file = NULL;
+        zlib_filefunc64_32_def_fill.zflush64_file = NULL;
         return unzOpenInternal(file, &zlib_filefunc64_32_def_fill, 1, UNZ_DEFAULT_FLAGS);
     }
     return unzOpenInternal(file, NULL, 1, UNZ_DEFAULT_FLAGS);
@@ -821,6 +963,7 @@ extern int ZEXPORT unzClose (unzFile file)
         ZCLOSE64(s->z_filefunc, s->filestream);
     else
         ZFAKECLOSE64(s->z_filefunc, s->filestream);
+    TRYFREE(s->central_dir);
     TRYFREE(s);
     return UNZ_OK;
 }
@@ -862,6 +1005,39 @@ extern int ZEXPORT unzGetFileFlags (unzFile file, unsigned* pflags)
     return UNZ_OK;
 }
 
+extern int ZEXPORT unzGetCentralDirInfo64 (unzFile file,
+                                           ZPOS64_T* pcentral_pos,
+                                           ZPOS64_T* poffset_central_dir,
+                                           ZPOS64_T* psize_central_dir)
+{
+    unz64_s* s;
+    if (file==NULL)
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    if (pcentral_pos!=NULL)
+        *pcentral_pos = s->central_pos;
+    if (poffset_central_dir!=NULL)
+        *poffset_central_dir = s->offset_central_dir+s->byte_before_the_zipfile;
+    if (psize_central_dir!=NULL)
+        *psize_central_dir = s->size_central_dir;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzLoadCentralDir (unzFile file)
+{
+    unz64_s* s;
+    if (file==NULL)
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    if ((s->central_dir!=NULL) || (s->size_central_dir==0))
+        return UNZ_OK;
+    /* every read from the file seeks first, so the position needn't be kept */
+    s->central_dir = unz64local_LoadCentralDir(&s->z_filefunc, s->filestream,
+                                               s->offset_central_dir+s->byte_before_the_zipfile,
+                                               s->size_central_dir);
+    return (s->central_dir!=NULL) ? UNZ_OK : UNZ_ERRNO;
+}
+
 /*
    Translate date/time from Dos format to tm_unz (readable more easilty)
 */
@@ -892,6 +1068,54 @@ local int unz64local_GetCurrentFileInfoInternal OF((unzFile file,
                                                   char *szComment,
                                                   uLong commentBufferSize));
 
+/*
+  Read the central directory record at the current position from the file
+  into a newly allocated buffer. Only used when the central directory
+  couldn't be loaded at open, or when the record lies outside of it.
+*/
+local int unz64local_ReadCentralDirRecord OF((unz64_s* s,
+                                             unsigned char** precord,
+                                             ZPOS64_T* psize));
+
+local int unz64local_ReadCentralDirRecord (unz64_s* s,
+                                          unsigned char** precord,
+                                          ZPOS64_T* psize)
+{
+    unsigned char header[SIZECENTRALDIRITEM];
+    unsigned char* record;
+    uLong variable;
+
+    *precord = NULL;
+    *psize = 0;
+    if (ZSEEK64(s->z_filefunc, s->filestream,
+              s->pos_in_central_dir+s->byte_before_the_zipfile,
+              ZLIB_FILEFUNC_SEEK_SET)!=0)
+        return UNZ_ERRNO;
+
+    if (ZREAD64(s->z_filefunc, s->filestream,header,SIZECENTRALDIRITEM)!=SIZECENTRALDIRITEM)
+        return UNZ_ERRNO;
+
+    if (unz64local_bufGetLong(header)!=0x02014b50)
+        return UNZ_BADZIPFILE;
+
+    variable = unz64local_bufGetShort(header+28) +
+        unz64local_bufGetShort(header+30) +
+        unz64local_bufGetShort(header+32);
+    record = (unsigned char*)ALLOC(SIZECENTRALDIRITEM+variable);
+    if (record==NULL)
+        return UNZ_INTERNALERROR;
+    memcpy(record,header,SIZECENTRALDIRITEM);
+    if ((variable>0) &&
+        (ZREAD64(s->z_filefunc, s->filestream,record+SIZECENTRALDIRITEM,variable)!=variable))
+    {
+        TRYFREE(record);
+        return UNZ_ERRNO;
+    }
+    *precord = record;
+    *psize = SIZECENTRALDIRITEM+variable;
+    return UNZ_OK;
+}
+
 local int unz64local_GetCurrentFileInfoInternal (unzFile file,
                                                   unz_file_info64 *pfile_info,
                                                   unz_file_info64_internal
@@ -907,81 +1131,69 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
     unz_file_info64 file_info;
     unz_file_info64_internal file_info_internal;
     int err=UNZ_OK;
-    uLong uMagic;
-    ZPOS64_T llSeek=0;
-    uLong uL;
+    const unsigned char* record = NULL;
+    unsigned char* allocated = NULL;
+    const unsigned char* p;
+    ZPOS64_T record_size = 0;
 
     if (file==NULL)
         return UNZ_PARAMERROR;
     s=(unz64_s*)file;
-    if (ZSEEK64(s->z_filefunc, s->filestream,
-              s->pos_in_central_dir+s->byte_before_the_zipfile,
-              ZLIB_FILEFUNC_SEEK_SET)!=0)
-        err=UNZ_ERRNO;
-
 
-    /* we check the magic */
-    if (err==UNZ_OK)
+    /* use the central directory loaded at open if the record is inside it */
+    if ((s->central_dir!=NULL) &&
+        (s->pos_in_central_dir>=s->offset_central_dir) &&
+        (s->pos_in_central_dir-s->offset_central_dir+SIZECENTRALDIRITEM<=s->size_central_dir))
     {
-        if (unz64local_getLong(&s->z_filefunc, s->filestream,&uMagic) != UNZ_OK)
-            err=UNZ_ERRNO;
-        else if (uMagic!=0x02014b50)
-            err=UNZ_BADZIPFILE;
+        ZPOS64_T start = s->pos_in_central_dir-s->offset_central_dir;
+        const unsigned char* header = s->central_dir+start;
+        ZPOS64_T needed = SIZECENTRALDIRITEM +
+            unz64local_bufGetShort(header+28) +
+            unz64local_bufGetShort(header+30) +
+            unz64local_bufGetShort(header+32);
+        if (start+needed<=s->size_central_dir)
+        {
+            record = header;
+            record_size = needed;
+        }
     }
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.version) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.version_needed) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.flag) != UNZ_OK)
-        err=UNZ_ERRNO;
+    if (record==NULL)
+    {
+        err = unz64local_ReadCentralDirRecord(s,&allocated,&record_size);
+        record = allocated;
+    }
 
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.compression_method) != UNZ_OK)
-        err=UNZ_ERRNO;
+    /* we check the magic */
+    if ((err==UNZ_OK) && (unz64local_bufGetLong(record)!=0x02014b50))
+        err=UNZ_BADZIPFILE;
 
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&file_info.dosDate) != UNZ_OK)
-        err=UNZ_ERRNO;
+    if (err!=UNZ_OK)
+    {
+        TRYFREE(allocated);
+        return err;
+    }
 
+    file_info.version = unz64local_bufGetShort(record+4);
+    file_info.version_needed = unz64local_bufGetShort(record+6);
+    file_info.flag = unz64local_bufGetShort(record+8);
+    file_info.compression_method = unz64local_bufGetShort(record+10);
+    file_info.dosDate = unz64local_bufGetLong(record+12);
     unz64local_DosDateToTmuDate(file_info.dosDate,&file_info.tmu_date);
-
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&file_info.crc) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
-        err=UNZ_ERRNO;
-    file_info.compressed_size = uL;
-
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
-        err=UNZ_ERRNO;
-    file_info.uncompressed_size = uL;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.size_filename) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.size_file_extra) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.size_file_comment) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.disk_num_start) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getShort(&s->z_filefunc, s->filestream,&file_info.internal_fa) != UNZ_OK)
-        err=UNZ_ERRNO;
-
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&file_info.external_fa) != UNZ_OK)
-        err=UNZ_ERRNO;
-
+    file_info.crc = unz64local_bufGetLong(record+16);
+    file_info.compressed_size = unz64local_bufGetLong(record+20);
+    file_info.uncompressed_size = unz64local_bufGetLong(record+24);
+    file_info.size_filename = unz64local_bufGetShort(record+28);
+    file_info.size_file_extra = unz64local_bufGetShort(record+30);
+    file_info.size_file_comment = unz64local_bufGetShort(record+32);
+    file_info.disk_num_start = unz64local_bufGetShort(record+34);
+    file_info.internal_fa = unz64local_bufGetShort(record+36);
+    file_info.external_fa = unz64local_bufGetLong(record+38);
                 /* relative offset of local header */
-    if (unz64local_getLong(&s->z_filefunc, s->filestream,&uL) != UNZ_OK)
-        err=UNZ_ERRNO;
-    file_info_internal.offset_curfile = uL;
+    file_info_internal.offset_curfile = unz64local_bufGetLong(record+42);
 
-    llSeek+=file_info.size_filename;
-    if ((err==UNZ_OK) && (szFileName!=NULL))
+    p = record+SIZECENTRALDIRITEM;
+    if (szFileName!=NULL)
     {
         uLong uSizeRead ;
         if (file_info.size_filename<fileNameBufferSize)
@@ -993,107 +1205,68 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
             uSizeRead = fileNameBufferSize;
 
         if ((file_info.size_filename>0) && (fileNameBufferSize>0))
-            if (ZREAD64(s->z_filefunc, s->filestream,szFileName,uSizeRead)!=uSizeRead)
-                err=UNZ_ERRNO;
-        llSeek -= uSizeRead;
+            memcpy(szFileName,p,uSizeRead);
     }
+    p += file_info.size_filename;
 
     /* Read extrafield */
-    if ((err==UNZ_OK) && (extraField!=NULL))
+    if (extraField!=NULL)
     {
-        ZPOS64_T uSizeRead ;
+        uLong uSizeRead ;
         if (file_info.size_file_extra<extraFieldBufferSize)
             uSizeRead = file_info.size_file_extra;
         else
             uSizeRead = extraFieldBufferSize;
 
-        if (llSeek!=0)
-        {
-            if (ZSEEK64(s->z_filefunc, s->filestream,llSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
-                llSeek=0;
-            else
-                err=UNZ_ERRNO;
-        }
-
         if ((file_info.size_file_extra>0) && (extraFieldBufferSize>0))
-            if (ZREAD64(s->z_filefunc, s->filestream,extraField,(uLong)uSizeRead)!=uSizeRead)
-                err=UNZ_ERRNO;
-
-        llSeek += file_info.size_file_extra - (uLong)uSizeRead;
+            memcpy(extraField,p,uSizeRead);
     }
-    else
-        llSeek += file_info.size_file_extra;
-
 
-    if ((err==UNZ_OK) && (file_info.size_file_extra != 0))
+    if (file_info.size_file_extra != 0)
     {
-                                uLong acc = 0;
+        uLong acc = 0;
 
-        /* since lSeek now points to after the extra field we need to move back */
-        llSeek -= file_info.size_file_extra;
-
-        if (llSeek!=0)
+        while(acc+4 <= file_info.size_file_extra)
         {
-            if (ZSEEK64(s->z_filefunc, s->filestream,llSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
-                llSeek=0;
-            else
-                err=UNZ_ERRNO;
-        }
-
-        while(acc < file_info.size_file_extra)
-        {
-            uLong headerId;
-                                                uLong dataSize;
+            const unsigned char* data = p+acc+4;
+            uLong headerId = unz64local_bufGetShort(p+acc);
+            uLong dataSize = unz64local_bufGetShort(p+acc+2);
 
-            if (unz64local_getShort(&s->z_filefunc, s->filestream,&headerId) != UNZ_OK)
-                err=UNZ_ERRNO;
-
-            if (unz64local_getShort(&s->z_filefunc, s->filestream,&dataSize) != UNZ_OK)
-                err=UNZ_ERRNO;
+            if (acc+4+dataSize > file_info.size_file_extra)
+                dataSize = file_info.size_file_extra-acc-4;
 
             /* ZIP64 extra fields */
             if (headerId == 0x0001)
             {
-                uLong _uL;
+                const unsigned char* dataEnd = data+dataSize;
 
-                if(file_info.uncompressed_size == (ZPOS64_T)0xFFFFFFFFu)
+                if((file_info.uncompressed_size == (ZPOS64_T)0xFFFFFFFFu) && (data+8<=dataEnd))
                 {
-                    if (unz64local_getLong64(&s->z_filefunc, s->filestream,&file_info.uncompressed_size) != UNZ_OK)
-                        err=UNZ_ERRNO;
+                    file_info.uncompressed_size = unz64local_bufGetLong64(data);
+                    data += 8;
                 }
 
-                if(file_info.compressed_size == (ZPOS64_T)0xFFFFFFFFu)
+                if((file_info.compressed_size == (ZPOS64_T)0xFFFFFFFFu) && (data+8<=dataEnd))
                 {
-                    if (unz64local_getLong64(&s->z_filefunc, s->filestream,&file_info.compressed_size) != UNZ_OK)
-                        err=UNZ_ERRNO;
+                    file_info.compressed_size = unz64local_bufGetLong64(data);
+                    data += 8;
                 }
 
-                if(file_info_internal.offset_curfile == (ZPOS64_T)0xFFFFFFFFu)
+                if((file_info_internal.offset_curfile == (ZPOS64_T)0xFFFFFFFFu) && (data+8<=dataEnd))
                 {
                     /* Relative Header offset */
-                    if (unz64local_getLong64(&s->z_filefunc, s->filestream,&file_info_internal.offset_curfile) != UNZ_OK)
-                        err=UNZ_ERRNO;
+                    file_info_internal.offset_curfile = unz64local_bufGetLong64(data);
+                    data += 8;
                 }
-
-                if(file_info.disk_num_start == 0xFFFFFFFFu)
-                {
-                    /* Disk Start Number */
-                    if (unz64local_getLong(&s->z_filefunc, s->filestream, &_uL) != UNZ_OK)
-                        err=UNZ_ERRNO;
-                }
-
-            }
-            else
-            {
-                if (ZSEEK64(s->z_filefunc, s->filestream,dataSize,ZLIB_FILEFUNC_SEEK_CUR)!=0)
-                    err=UNZ_ERRNO;
+                /* Disk Start Number is not needed, spanning isn't supported */
             }
 
             acc += 2 + 2 + dataSize;
         }
     }
+    p += file_info.size_file_extra;
 
-    if ((err==UNZ_OK) && (szComment!=NULL))
+    if (szComment!=NULL)
     {
         uLong uSizeRead ;
         if (file_info.size_file_comment<commentBufferSize)
@@ -1104,27 +1277,16 @@ local int unz64local_GetCurrentFileInfoInternal (unzFile file,
         else
             uSizeRead = commentBufferSize;
 
-        if (llSeek!=0)
-        {
-            if (ZSEEK64(s->z_filefunc, s->filestream,llSeek,ZLIB_FILEFUNC_SEEK_CUR)==0)
-                llSeek=0;
-            else
-                err=UNZ_ERRNO;
-        }
-
         if ((file_info.size_file_comment>0) && (commentBufferSize>0))
-            if (ZREAD64(s->z_filefunc, s->filestream,szComment,uSizeRead)!=uSizeRead)
-                err=UNZ_ERRNO;
-        llSeek+=file_info.size_file_comment - uSizeRead;
+            memcpy(szComment,p,uSizeRead);
     }
-    else
-        llSeek+=file_info.size_file_comment;
 
+    TRYFREE(allocated);
 
-    if ((err==UNZ_OK) && (pfile_info!=NULL))
+    if (pfile_info!=NULL)
         *pfile_info=file_info;
 
-    if ((err==UNZ_OK) && (pfile_info_internal!=NULL))
+    if (pfile_info_internal!=NULL)
         *pfile_info_internal=file_info_internal;
 
     return err;
@@ -1522,6 +1684,12 @@ extern int ZEXPORT unzOpenCurrentFile3 (unzFile file, int* method,
     pfile_in_zip_read_info->size_local_extrafield = size_local_extrafield;
     pfile_in_zip_read_info->pos_local_extrafield=0;
     pfile_in_zip_read_info->raw=raw;
+    pfile_in_zip_read_info->crc_checked=1;
+    pfile_in_zip_read_info->access_point_func=NULL;
+    pfile_in_zip_read_info->access_point_opaque=NULL;
+    pfile_in_zip_read_info->access_point_span=0;
+    pfile_in_zip_read_info->last_access_point=0;
+    pfile_in_zip_read_info->window=NULL;
 
     if (pfile_in_zip_read_info->read_buffer==NULL)
     {
@@ -1688,6 +1856,54 @@ extern ZPOS64_T ZEXPORT unzGetCurrentFileZStreamPos64( unzFile file)
 
 /** Addition for GDAL : END */
 
+extern voidpf ZEXPORT unzGetStream (unzFile file)
+{
+    if (file==NULL)
+        return NULL;
+    return ((unz64_s*)file)->filestream;
+}
+
+/*
+  Point the input of the current file straight at its data if the I/O
+  functions can hand out pointers, so that it isn't copied to read_buffer.
+  Encrypted data has to be decoded in place and always goes through the
+  buffer. Returns UNZ_OK if next_in now points at the next chunk.
+*/
+#ifndef UNZ_MAXVIEWCHUNK
+#define UNZ_MAXVIEWCHUNK (0x40000000)
+#endif
+
+local int unz64local_ViewCompressed OF((unz64_s* s,
+                                        file_in_zip64_read_info_s* pfile_in_zip_read_info));
+
+local int unz64local_ViewCompressed(unz64_s* s,
+                                    file_in_zip64_read_info_s* pfile_in_zip_read_info)
+{
+    const void* view;
+    ZPOS64_T available = 0;
+    uInt uViewThis = UNZ_MAXVIEWCHUNK;
+
+    if ((pfile_in_zip_read_info->z_filefunc.zview64_file==NULL) || s->encrypted)
+        return UNZ_PARAMERROR;
+    view = ZVIEW64(pfile_in_zip_read_info->z_filefunc,
+                   pfile_in_zip_read_info->filestream,
+                   pfile_in_zip_read_info->pos_in_zipfile +
+                      pfile_in_zip_read_info->byte_before_the_zipfile,
+                   &available);
+    if ((view==NULL) || (available==0))
+        return UNZ_ERRNO;
+    if (pfile_in_zip_read_info->rest_read_compressed<uViewThis)
+        uViewThis = (uInt)pfile_in_zip_read_info->rest_read_compressed;
+    if (available<uViewThis)
+        uViewThis = (uInt)available;
+
+    pfile_in_zip_read_info->pos_in_zipfile += uViewThis;
+    pfile_in_zip_read_info->rest_read_compressed -= uViewThis;
+    pfile_in_zip_read_info->stream.next_in = (Bytef*)view;
+    pfile_in_zip_read_info->stream.avail_in = uViewThis;
+    return UNZ_OK;
+}
+
 /*
   Read bytes from the current file.
   buf contain buffer where data must be copied
@@ -1698,6 +1914,38 @@ extern ZPOS64_T ZEXPORT unzGetCurrentFileZStreamPos64( unzFile file)
   return <0 with error code if there is an error
     (UNZ_ERRNO for IO error, or zLib error for uncompress error)
 */
+local void unz64local_AccessPoint OF((unz64_s* s,
+                                      file_in_zip64_read_info_s* pfile_in_zip_read_info));
+
+/* Calls the access point callback if inflate has just stopped at the end of
+   a block, which is not the last one, far enough from the last point. */
+local void unz64local_AccessPoint(unz64_s* s,
+                                  file_in_zip64_read_info_s* pfile_in_zip_read_info)
+{
+    uInt window_size = UNZ_WINDOW_SIZE;
+    ZPOS64_T compressed_offset;
+    int data_type = pfile_in_zip_read_info->stream.data_type;
+
+    if (((data_type & 128) == 0) || ((data_type & 64) != 0))
+        return;
+    if (pfile_in_zip_read_info->total_out_64 <
+            pfile_in_zip_read_info->last_access_point +
+            pfile_in_zip_read_info->access_point_span)
+        return;
+    if (inflateGetDictionary(&pfile_in_zip_read_info->stream,
+                             pfile_in_zip_read_info->window, &window_size)!=Z_OK)
+        return;
+    compressed_offset = s->cur_file_info.compressed_size -
+        pfile_in_zip_read_info->rest_read_compressed -
+        pfile_in_zip_read_info->stream.avail_in;
+    pfile_in_zip_read_info->last_access_point = pfile_in_zip_read_info->total_out_64;
+    pfile_in_zip_read_info->access_point_func(pfile_in_zip_read_info->access_point_opaque,
+                                              pfile_in_zip_read_info->total_out_64,
+                                              compressed_offset, data_type & 7,
+                                              pfile_in_zip_read_info->window,
+                                              window_size);
+}
+
 extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
 {
     int err=UNZ_OK;
@@ -1737,6 +1985,46 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
     while (pfile_in_zip_read_info->stream.avail_out>0)
     {
         if ((pfile_in_zip_read_info->stream.avail_in==0) &&
+            (pfile_in_zip_read_info->rest_read_compressed>0) &&
+            (unz64local_ViewCompressed(s, pfile_in_zip_read_info)==UNZ_OK))
+        {
+            /* next_in points right into the file data, nothing to copy */
+        }
+        else if ((pfile_in_zip_read_info->stream.avail_in==0) &&
+            (pfile_in_zip_read_info->rest_read_compressed>0) &&
+            ((pfile_in_zip_read_info->compression_method==0) || (pfile_in_zip_read_info->raw)) &&
+            (!s->encrypted) &&
+            (pfile_in_zip_read_info->stream.avail_out>=UNZ_BUFSIZE))
+        {
+            /* a large read of stored data goes straight to the caller's buffer */
+            uInt uReadThis = pfile_in_zip_read_info->stream.avail_out;
+            if (pfile_in_zip_read_info->rest_read_compressed<uReadThis)
+                uReadThis = (uInt)pfile_in_zip_read_info->rest_read_compressed;
+            if (ZSEEK64(pfile_in_zip_read_info->z_filefunc,
+                      pfile_in_zip_read_info->filestream,
+                      pfile_in_zip_read_info->pos_in_zipfile +
+                         pfile_in_zip_read_info->byte_before_the_zipfile,
+                         ZLIB_FILEFUNC_SEEK_SET)!=0)
+                return UNZ_ERRNO;
+            if (ZREAD64(pfile_in_zip_read_info->z_filefunc,
+                      pfile_in_zip_read_info->filestream,
+                      pfile_in_zip_read_info->stream.next_out,
+                      uReadThis)!=uReadThis)
+                return UNZ_ERRNO;
+            pfile_in_zip_read_info->pos_in_zipfile += uReadThis;
+            pfile_in_zip_read_info->rest_read_compressed-=uReadThis;
+            pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uReadThis;
+            pfile_in_zip_read_info->crc32 = quazip_crc32(pfile_in_zip_read_info->crc32,
+                                pfile_in_zip_read_info->stream.next_out,
+                                uReadThis);
+            pfile_in_zip_read_info->rest_read_uncompressed-=uReadThis;
+            pfile_in_zip_read_info->stream.avail_out -= uReadThis;
+            pfile_in_zip_read_info->stream.next_out += uReadThis;
+            pfile_in_zip_read_info->stream.total_out += uReadThis;
+            iRead += uReadThis;
+            continue;
+        }
+        else if ((pfile_in_zip_read_info->stream.avail_in==0) &&
             (pfile_in_zip_read_info->rest_read_compressed>0))
         {
             uInt uReadThis = UNZ_BUFSIZE;
@@ -1780,7 +2068,7 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
 
         if ((pfile_in_zip_read_info->compression_method==0) || (pfile_in_zip_read_info->raw))
         {
-            uInt uDoCopy,i ;
+            uInt uDoCopy;
 
             if ((pfile_in_zip_read_info->stream.avail_in == 0) &&
                 (pfile_in_zip_read_info->rest_read_compressed == 0))
@@ -1792,13 +2080,12 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
             else
                 uDoCopy = pfile_in_zip_read_info->stream.avail_in ;
 
-            for (i=0;i<uDoCopy;i++)
-                *(pfile_in_zip_read_info->stream.next_out+i) =
-                        *(pfile_in_zip_read_info->stream.next_in+i);
+            memcpy(pfile_in_zip_read_info->stream.next_out,
+                   pfile_in_zip_read_info->stream.next_in, uDoCopy);
 
             pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uDoCopy;
 
-            pfile_in_zip_read_info->crc32 = crc32(pfile_in_zip_read_info->crc32,
+            pfile_in_zip_read_info->crc32 = quazip_crc32(pfile_in_zip_read_info->crc32,
                                 pfile_in_zip_read_info->stream.next_out,
                                 uDoCopy);
             pfile_in_zip_read_info->rest_read_uncompressed-=uDoCopy;
@@ -1835,7 +2122,7 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
 
             pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uOutThis;
 
-            pfile_in_zip_read_info->crc32 = crc32(pfile_in_zip_read_info->crc32,bufBefore, (uInt)(uOutThis));
+            pfile_in_zip_read_info->crc32 = quazip_crc32(pfile_in_zip_read_info->crc32,bufBefore, (uInt)(uOutThis));
             pfile_in_zip_read_info->rest_read_uncompressed -= uOutThis;
             iRead += (uInt)(uTotalOutAfter - uTotalOutBefore);
 
@@ -1857,7 +2144,8 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
             uInt uAvailOutBefore,uAvailOutAfter;
             const Bytef *bufBefore;
             uInt uOutThis;
-            int flush=Z_SYNC_FLUSH;
+            /* stop at the block boundaries, where the access points are */
+            int flush=(pfile_in_zip_read_info->access_point_func!=NULL) ? Z_BLOCK : Z_SYNC_FLUSH;
 
             uAvailOutBefore = pfile_in_zip_read_info->stream.avail_out;
             bufBefore = pfile_in_zip_read_info->stream.next_out;
@@ -1873,12 +2161,15 @@ extern int ZEXPORT unzReadCurrentFile  (unzFile file, voidp buf, unsigned len)
             pfile_in_zip_read_info->total_out_64 = pfile_in_zip_read_info->total_out_64 + uOutThis;
 
             pfile_in_zip_read_info->crc32
-                    = crc32(pfile_in_zip_read_info->crc32,bufBefore, uOutThis);
+                    = quazip_crc32(pfile_in_zip_read_info->crc32,bufBefore, uOutThis);
 
             pfile_in_zip_read_info->rest_read_uncompressed -= uOutThis;
 
             iRead += uAvailOutBefore - uAvailOutAfter;
 
+            if ((err==Z_OK) && (pfile_in_zip_read_info->access_point_func!=NULL))
+                unz64local_AccessPoint(s, pfile_in_zip_read_info);
+
             if (err==Z_STREAM_END)
                 return (iRead==0) ? UNZ_EOF : iRead;
             if (err!=Z_OK)
@@ -2023,7 +2314,7 @@ extern int ZEXPORT unzCloseCurrentFile (unzFile file)
 
 
     if ((pfile_in_zip_read_info->rest_read_uncompressed == 0) &&
-        (!pfile_in_zip_read_info->raw))
+        (!pfile_in_zip_read_info->raw) && pfile_in_zip_read_info->crc_checked)
     {
         if (pfile_in_zip_read_info->crc32 != pfile_in_zip_read_info->crc32_wait)
             err=UNZ_CRCERROR;
@@ -2032,6 +2323,7 @@ extern int ZEXPORT unzCloseCurrentFile (unzFile file)
 
     TRYFREE(pfile_in_zip_read_info->read_buffer);
     pfile_in_zip_read_info->read_buffer = NULL;
+    TRYFREE(pfile_in_zip_read_info->window);
     if (pfile_in_zip_read_info->stream_initialised == Z_DEFLATED)
         inflateEnd(&pfile_in_zip_read_info->stream);
 #ifdef HAVE_BZIP2
@@ -2131,6 +2423,154 @@ extern int ZEXPORT unzSetOffset (unzFile file, uLong pos)
 }
 
 
+extern ZPOS64_T ZEXPORT unzGetCurrentFileLocalHeaderPos64(unzFile file)
+{
+    unz64_s* s;
+
+    if (file==NULL)
+          return 0; /*UNZ_PARAMERROR; */
+    s=(unz64_s*)file;
+    if (!s->current_file_ok)
+      return 0;
+    return s->cur_file_info_internal.offset_curfile + s->byte_before_the_zipfile;
+}
+
+extern int ZEXPORT unzGetCurrentFileView64 (unzFile file,
+                                            const void** pview,
+                                            ZPOS64_T* psize)
+{
+    unz64_s* s;
+    file_in_zip64_read_info_s* pfile_in_zip_read_info;
+    ZPOS64_T start;
+    ZPOS64_T available = 0;
+    const void* view;
+    if ((file==NULL) || (pview==NULL) || (psize==NULL))
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    pfile_in_zip_read_info=s->pfile_in_zip_read;
+    if (pfile_in_zip_read_info==NULL)
+        return UNZ_PARAMERROR;
+    if (((pfile_in_zip_read_info->compression_method!=0) && (!pfile_in_zip_read_info->raw)) ||
+        s->encrypted || (pfile_in_zip_read_info->z_filefunc.zview64_file==NULL))
+        return UNZ_PARAMERROR;
+    /* wherever reading has got to, the data starts this far back */
+    start = pfile_in_zip_read_info->pos_in_zipfile -
+        (s->cur_file_info.compressed_size - pfile_in_zip_read_info->rest_read_compressed);
+    view = ZVIEW64(pfile_in_zip_read_info->z_filefunc,
+                   pfile_in_zip_read_info->filestream,
+                   start + pfile_in_zip_read_info->byte_before_the_zipfile,
+                   &available);
+    if ((view==NULL) || (available<s->cur_file_info.compressed_size))
+        return UNZ_ERRNO;
+    *pview = view;
+    *psize = s->cur_file_info.compressed_size;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzSetAccessPointCallback (unzFile file,
+                                              ZPOS64_T span,
+                                              unz_access_point_func func,
+                                              voidpf opaque)
+{
+    unz64_s* s;
+    file_in_zip64_read_info_s* pfile_in_zip_read_info;
+    if (file==NULL)
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    pfile_in_zip_read_info=s->pfile_in_zip_read;
+    if (pfile_in_zip_read_info==NULL)
+        return UNZ_PARAMERROR;
+    if ((pfile_in_zip_read_info->stream_initialised!=Z_DEFLATED) ||
+        pfile_in_zip_read_info->raw || s->encrypted)
+        return UNZ_PARAMERROR;
+    if ((func!=NULL) && (pfile_in_zip_read_info->window==NULL))
+    {
+        pfile_in_zip_read_info->window = (unsigned char*)ALLOC(UNZ_WINDOW_SIZE);
+        if (pfile_in_zip_read_info->window==NULL)
+            return UNZ_INTERNALERROR;
+    }
+    pfile_in_zip_read_info->access_point_func = func;
+    pfile_in_zip_read_info->access_point_opaque = opaque;
+    pfile_in_zip_read_info->access_point_span = span;
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzSeekCurrentFile64 (unzFile file,
+                                         ZPOS64_T uncompressed_offset,
+                                         ZPOS64_T compressed_offset,
+                                         int bits,
+                                         const unsigned char* window,
+                                         uInt window_size)
+{
+    unz64_s* s;
+    file_in_zip64_read_info_s* pfile_in_zip_read_info;
+    ZPOS64_T start;
+    int deflated;
+    if (file==NULL)
+        return UNZ_PARAMERROR;
+    s=(unz64_s*)file;
+    pfile_in_zip_read_info=s->pfile_in_zip_read;
+    if ((pfile_in_zip_read_info==NULL) || s->encrypted)
+        return UNZ_PARAMERROR;
+    deflated = (pfile_in_zip_read_info->stream_initialised==Z_DEFLATED) &&
+        !pfile_in_zip_read_info->raw;
+    if (!deflated)
+    {
+        if ((pfile_in_zip_read_info->compression_method!=0) && !pfile_in_zip_read_info->raw)
+            return UNZ_PARAMERROR;
+        compressed_offset = uncompressed_offset;
+        bits = 0;
+    }
+    if ((compressed_offset > s->cur_file_info.compressed_size) ||
+        (uncompressed_offset > s->cur_file_info.uncompressed_size && !pfile_in_zip_read_info->raw) ||
+        (bits < 0) || (bits > 7) || ((bits != 0) && (compressed_offset == 0)) ||
+        (window_size > UNZ_WINDOW_SIZE))
+        return UNZ_PARAMERROR;
+    /* wherever reading has got to, the data starts this far back */
+    start = pfile_in_zip_read_info->pos_in_zipfile -
+        (s->cur_file_info.compressed_size - pfile_in_zip_read_info->rest_read_compressed);
+    if (bits != 0)
+        compressed_offset--; /* the byte the point starts in */
+    pfile_in_zip_read_info->pos_in_zipfile = start + compressed_offset;
+    pfile_in_zip_read_info->rest_read_compressed =
+        s->cur_file_info.compressed_size - compressed_offset;
+    pfile_in_zip_read_info->stream.next_in = NULL;
+    pfile_in_zip_read_info->stream.avail_in = 0;
+    if (deflated)
+    {
+        int err = inflateReset(&pfile_in_zip_read_info->stream);
+        if ((err==Z_OK) && (bits != 0))
+        {
+            unsigned char c;
+            if (ZSEEK64(pfile_in_zip_read_info->z_filefunc,
+                        pfile_in_zip_read_info->filestream,
+                        pfile_in_zip_read_info->pos_in_zipfile +
+                           pfile_in_zip_read_info->byte_before_the_zipfile,
+                        ZLIB_FILEFUNC_SEEK_SET)!=0)
+                return UNZ_ERRNO;
+            if (ZREAD64(pfile_in_zip_read_info->z_filefunc,
+                        pfile_in_zip_read_info->filestream, &c, 1)!=1)
+                return UNZ_ERRNO;
+            pfile_in_zip_read_info->pos_in_zipfile++;
+            pfile_in_zip_read_info->rest_read_compressed--;
+            err = inflatePrime(&pfile_in_zip_read_info->stream, bits, c >> (8 - bits));
+        }
+        if ((err==Z_OK) && (window!=NULL) && (window_size!=0))
+            err = inflateSetDictionary(&pfile_in_zip_read_info->stream, window, window_size);
+        if (err!=Z_OK)
+            return err;
+    }
+    pfile_in_zip_read_info->total_out_64 = uncompressed_offset;
+    pfile_in_zip_read_info->rest_read_uncompressed =
+        (uncompressed_offset < s->cur_file_info.uncompressed_size)
+        ? s->cur_file_info.uncompressed_size - uncompressed_offset : 0;
+    pfile_in_zip_read_info->last_access_point = uncompressed_offset;
+    /* back at the start, the CRC can be checked again */
+    pfile_in_zip_read_info->crc32 = 0;
+    pfile_in_zip_read_info->crc_checked = (uncompressed_offset == 0);
+    return UNZ_OK;
+}
+
 int ZEXPORT unzSetFlags(unzFile file, unsigned flags)
 {
     unz64_s* s;
@@ -87,6 +87,8 @@ typedef voidp unzFile;
 
 #define UNZ_AUTO_CLOSE 0x01u
 #define UNZ_DEFAULT_FLAGS UNZ_AUTO_CLOSE
+/* Don't read the central directory into memory on open, see unzLoadCentralDir() */
+#define UNZ_DEFER_CENTRAL_DIR 0x02u
 #define UNZ_ENCODING_UTF8 0x0800u
 
 /* tm_unz contain date/time info */
@@ -214,6 +216,17 @@ extern unzFile unzOpenInternal (voidpf file,
                                zlib_filefunc64_32_def* pzlib_filefunc64_32_def,
                                int is64bitOpenFunction, unsigned flags);
 
+/*
+ * Opens one more handle to the zipfile open as file, reusing what was read
+ * when it was opened. The new handle has its own stream, opened with
+ * pzlib_filefunc64_32_def on the stream of file, its own current file and
+ * its own file to read. The stream of file must stay open for as long as
+ * the new handle is used. Returns NULL if the stream can't be opened.
+ * */
+extern unzFile ZEXPORT unzOpenShared OF((unzFile file,
+                                         zlib_filefunc64_32_def* pzlib_filefunc64_32_def,
+                                         unsigned flags));
+
 
 
 extern int ZEXPORT unzClose OF((unzFile file));
@@ -230,6 +243,24 @@ extern int ZEXPORT unzGetGlobalInfo64 OF((unzFile file,
                                         unz_global_info64 *pglobal_info));
 
 extern int ZEXPORT unzGetFileFlags OF((unzFile file, unsigned* pflags));
+
+extern int ZEXPORT unzGetCentralDirInfo64 OF((unzFile file,
+                                              ZPOS64_T* pcentral_pos,
+                                              ZPOS64_T* poffset_central_dir,
+                                              ZPOS64_T* psize_central_dir));
+/*
+  Get the position of the end of central directory record and the offset
+  and size of the central directory. The offset includes any data before
+  the archive, as in SFX files. Any of the pointers may be NULL.
+  return UNZ_OK if there is no problem. */
+
+extern int ZEXPORT unzLoadCentralDir OF((unzFile file));
+/*
+  Read the central directory into memory if it was deferred by opening
+  with UNZ_DEFER_CENTRAL_DIR. Until then, the entries are read from the
+  file one by one, which is fine for a few lookups but slow for walking
+  the whole directory.
+  return UNZ_OK if the directory is in memory. */
 /*
   Write info about the ZipFile in the *pglobal_info structure.
   No preparation of the structure is needed
@@ -345,6 +376,14 @@ extern ZPOS64_T ZEXPORT unzGetCurrentFileZStreamPos64 OF((unzFile file));
 
 /** Addition for GDAL : END */
 
+extern voidpf ZEXPORT unzGetStream OF((unzFile file));
+/*
+  Return the stream the zipfile is read from, as returned by the open
+    function of the I/O API (the QIODevice for QuaZip), or NULL.
+  Together with unzGetCurrentFileZStreamPos64(), it lets the caller copy
+    the data of a stored file by other means.
+*/
+
 
 /***************************************************************************/
 /* for reading the content of the current zipfile, you can open it, read data
@@ -451,6 +490,65 @@ extern uLong ZEXPORT unzGetOffset (unzFile file);
 extern int ZEXPORT unzSetOffset64 (unzFile file, ZPOS64_T pos);
 extern int ZEXPORT unzSetOffset (unzFile file, uLong pos);
 
+/* Get the position of the local header of the current file in the
+   underlying file (including any data before the archive, as in SFX files),
+   or 0 if there is no current file */
+extern ZPOS64_T ZEXPORT unzGetCurrentFileLocalHeaderPos64 (unzFile file);
+
+/* Get a pointer to the whole data of the current file, which must be open
+   either in raw mode or stored (not compressed), and not encrypted. This
+   only works if the I/O functions can hand out pointers, as the memory
+   mapped ones do. The pointer is valid until the zipfile is closed.
+   return UNZ_OK if *pview and *psize are set, UNZ_PARAMERROR if the file
+   can't be viewed this way */
+extern int ZEXPORT unzGetCurrentFileView64 OF((unzFile file,
+                                               const void** pview,
+                                               ZPOS64_T* psize));
+
+/* Access points let inflating resume in the middle of a deflated file,
+   as in zlib's examples/zran.c.
+
+   The callback is called while reading the current file with
+   unzReadCurrentFile, at deflate block boundaries at least span bytes of
+   uncompressed data apart. It gets the uncompressed and compressed
+   offsets of the point within the file data, the number of bits of the
+   byte before the compressed offset that still belong to the data (0-7),
+   and the last (up to) 32K of uncompressed data. The file must be open
+   and deflated, not raw and not encrypted.
+   Pass a NULL func to stop calling it.
+   return UNZ_OK, or UNZ_PARAMERROR if there can be no access points */
+typedef void (ZCALLBACK *unz_access_point_func) OF((voidpf opaque,
+                                                    ZPOS64_T uncompressed_offset,
+                                                    ZPOS64_T compressed_offset,
+                                                    int bits,
+                                                    const unsigned char* window,
+                                                    uInt window_size));
+
+#define UNZ_WINDOW_SIZE (32768)
+
+extern int ZEXPORT unzSetAccessPointCallback OF((unzFile file,
+                                                 ZPOS64_T span,
+                                                 unz_access_point_func func,
+                                                 voidpf opaque));
+
+/* Go to the given position in the current file, which must be open and
+   not encrypted.
+   For a deflated file (not raw), the position must be the start of the file
+   (0, 0, 0, NULL, 0) or an access point exactly as it was passed to the
+   access point callback. For a stored file or a file open in raw mode,
+   only uncompressed_offset is used, and it is the position in the data
+   as read by unzReadCurrentFile.
+   Unless the position is the start of the file, the CRC is not checked
+   when the file is closed.
+   return UNZ_OK, UNZ_PARAMERROR if the file can't be positioned this way,
+   or another error code */
+extern int ZEXPORT unzSeekCurrentFile64 OF((unzFile file,
+                                            ZPOS64_T uncompressed_offset,
+                                            ZPOS64_T compressed_offset,
+                                            int bits,
+                                            const unsigned char* window,
+                                            uInt window_size));
+
 extern int ZEXPORT unzSetFlags(unzFile file, unsigned flags);
 extern int ZEXPORT unzClearFlags(unzFile file, unsigned flags);
 
@@ -38,6 +38,7 @@
 typedef uLongf z_crc_t;
 #endif
 #include "zip.h"
+#include "quazip_crc32.h"
 
 #ifdef STDC
 #  include <stddef.h>
@@ -108,7 +109,13 @@ typedef uLongf z_crc_t;
 const char zip_copyright[] =" zip 1.01 Copyright 1998-2004 Gilles Vollant - http://www.winimage.com/zLibDll";
 
 
-#define SIZEDATA_INDATABLOCK (4096-(4*4))
+/* The smallest allocation of the central directory buffer */
+#define CENTRAL_DIR_MIN_CAPACITY (64*1024)
+/* The expected size of a central directory record, for zipReserveCentralDir():
+   the fixed part and a name with a few extra fields */
+#define CENTRAL_DIR_RECORD_SIZE (SIZECENTRALHEADER+96)
+/* The largest single read or write of the central directory */
+#define CENTRAL_DIR_MAX_IO (0x40000000)
 
 #define LOCALHEADERMAGIC    (0x04034b50)
 #define DESCRIPTORHEADERMAGIC    (0x08074b50)
@@ -122,20 +129,14 @@ const char zip_copyright[] =" zip 1.01 Copyright 1998-2004 Gilles Vollant - http
 
 #define SIZECENTRALHEADER (0x2e) /* 46 */
 
-typedef struct linkedlist_datablock_internal_s
+/* The central directory is built in one growing buffer, so that adding
+   a record is usually a copy and the whole directory is written at once. */
+typedef struct central_dir_buffer_s
 {
-  struct linkedlist_datablock_internal_s* next_datablock;
-  uLong  avail_in_this_block;
-  uLong  filled_in_this_block;
-  uLong  unused; /* for future use and alignement */
-  unsigned char data[SIZEDATA_INDATABLOCK];
-} linkedlist_datablock_internal;
-
-typedef struct linkedlist_data_s
-{
-    linkedlist_datablock_internal* first_block;
-    linkedlist_datablock_internal* last_block;
-} linkedlist_data;
+    unsigned char* data;
+    ZPOS64_T size;      /* bytes used */
+    ZPOS64_T capacity;  /* bytes allocated */
+} central_dir_buffer;
 
 
 typedef struct
@@ -177,7 +178,7 @@ typedef struct
 {
     zlib_filefunc64_32_def z_filefunc;
     voidpf filestream;        /* io structore of the zipfile */
-    linkedlist_data central_dir;/* datablock with central dir in construction*/
+    central_dir_buffer central_dir;/* central dir in construction */
     int  in_opened_file_inzip;  /* 1 if a file in the zip is currently writ.*/
     curfile64_info ci;            /* info on the file curretly writing */
 
@@ -199,90 +200,53 @@ typedef struct
 #include "minizip_crypt.h"
 #endif
 
-local linkedlist_datablock_internal* allocate_new_datablock()
+local void init_central_dir(central_dir_buffer* cd)
 {
-    linkedlist_datablock_internal* ldi;
-    ldi = (linkedlist_datablock_internal*)
-                 ALLOC(sizeof(linkedlist_datablock_internal));
-    if (ldi!=NULL)
-    {
-        ldi->next_datablock = NULL ;
-        ldi->filled_in_this_block = 0 ;
-        ldi->avail_in_this_block = SIZEDATA_INDATABLOCK ;
-    }
-    return ldi;
+    cd->data = NULL;
+    cd->size = cd->capacity = 0;
 }
 
-local void free_datablock(linkedlist_datablock_internal* ldi)
+local void free_central_dir(central_dir_buffer* cd)
 {
-    while (ldi!=NULL)
-    {
-        linkedlist_datablock_internal* ldinext = ldi->next_datablock;
-        TRYFREE(ldi);
-        ldi = ldinext;
-    }
+    TRYFREE(cd->data);
+    init_central_dir(cd);
 }
 
-local void init_linkedlist(linkedlist_data* ll)
+/* Makes room for at least capacity bytes, growing geometrically */
+local int reserve_central_dir(central_dir_buffer* cd, ZPOS64_T capacity)
 {
-    ll->first_block = ll->last_block = NULL;
-}
+    ZPOS64_T new_capacity;
+    unsigned char* new_data;
 
-local void free_linkedlist(linkedlist_data* ll)
-{
-    free_datablock(ll->first_block);
-    ll->first_block = ll->last_block = NULL;
+    if (capacity <= cd->capacity)
+        return ZIP_OK;
+    if (capacity > (ZPOS64_T)-1 / 2)
+        return ZIP_INTERNALERROR;
+    new_capacity = cd->capacity < CENTRAL_DIR_MIN_CAPACITY ? CENTRAL_DIR_MIN_CAPACITY : cd->capacity;
+    while (new_capacity < capacity)
+        new_capacity *= 2;
+    if (new_capacity != (ZPOS64_T)(size_t)new_capacity)
+        return ZIP_INTERNALERROR;
+    new_data = (unsigned char*)realloc(cd->data, (size_t)new_capacity);
+    if (new_data == NULL)
+        return ZIP_INTERNALERROR;
+    cd->data = new_data;
+    cd->capacity = new_capacity;
+    return ZIP_OK;
 }
 
-
-local int add_data_in_datablock(linkedlist_data* ll, const void* buf, uLong len)
+local int add_data_in_central_dir(central_dir_buffer* cd, const void* buf, uLong len)
 {
-    linkedlist_datablock_internal* ldi;
-    const unsigned char* from_copy;
+    int err;
 
-    if (ll==NULL)
+    if (cd==NULL)
         return ZIP_INTERNALERROR;
 
-    if (ll->last_block == NULL)
-    {
-        ll->first_block = ll->last_block = allocate_new_datablock();
-        if (ll->first_block == NULL)
-            return ZIP_INTERNALERROR;
-    }
-
-    ldi = ll->last_block;
-    from_copy = (unsigned char*)buf;
-
-    while (len>0)
-    {
-        uInt copy_this;
-        uInt i;
-        unsigned char* to_copy;
-
-        if (ldi->avail_in_this_block==0)
-        {
-            ldi->next_datablock = allocate_new_datablock();
-            if (ldi->next_datablock == NULL)
-                return ZIP_INTERNALERROR;
-            ldi = ldi->next_datablock ;
-            ll->last_block = ldi;
-        }
-
-        if (ldi->avail_in_this_block < len)
-            copy_this = (uInt)ldi->avail_in_this_block;
-        else
-            copy_this = (uInt)len;
-
-        to_copy = &(ldi->data[ldi->filled_in_this_block]);
-
-        for (i=0;i<copy_this;i++)
-            *(to_copy+i)=*(from_copy+i);
-
-        ldi->filled_in_this_block += copy_this;
-        ldi->avail_in_this_block -= copy_this;
-        from_copy += copy_this ;
-        len -= copy_this;
-    }
+    err = reserve_central_dir(cd, cd->size + len);
+    if (err != ZIP_OK)
+        return err;
+    memcpy(cd->data + cd->size, buf, len);
+    cd->size += len;
     return ZIP_OK;
 }
 
@@ -829,28 +793,23 @@ int LoadCentralDirectoryRecord(zip64_internal* pziinit)
   byte_before_the_zipfile = central_pos - (offset_central_dir+size_central_dir);
   pziinit->add_position_when_writting_offset = byte_before_the_zipfile;
 
-  {
-    ZPOS64_T size_central_dir_to_read = size_central_dir;
-    size_t buf_size = SIZEDATA_INDATABLOCK;
-    void* buf_read = ALLOC(buf_size);
-    if (ZSEEK64(pziinit->z_filefunc, pziinit->filestream, offset_central_dir + byte_before_the_zipfile, ZLIB_FILEFUNC_SEEK_SET) != 0)
-      err=ZIP_ERRNO;
-
-    while ((size_central_dir_to_read>0) && (err==ZIP_OK))
-    {
-      ZPOS64_T read_this = SIZEDATA_INDATABLOCK;
-      if (read_this > size_central_dir_to_read)
-        read_this = size_central_dir_to_read;
+  if (ZSEEK64(pziinit->z_filefunc, pziinit->filestream, offset_central_dir + byte_before_the_zipfile, ZLIB_FILEFUNC_SEEK_SET) != 0)
+    err=ZIP_ERRNO;
 
-      if (ZREAD64(pziinit->z_filefunc, pziinit->filestream,buf_read,(uLong)read_this) != read_this)
-        err=ZIP_ERRNO;
+  /* read straight into the buffer, with room for the records to be added */
+  if (err==ZIP_OK)
+    err = reserve_central_dir(&pziinit->central_dir, size_central_dir + size_central_dir / 8);
 
-      if (err==ZIP_OK)
-        err = add_data_in_datablock(&pziinit->central_dir,buf_read, (uLong)read_this);
+  while ((pziinit->central_dir.size < size_central_dir) && (err==ZIP_OK))
+  {
+    ZPOS64_T read_this = size_central_dir - pziinit->central_dir.size;
+    if (read_this > CENTRAL_DIR_MAX_IO)
+      read_this = CENTRAL_DIR_MAX_IO;
 
-      size_central_dir_to_read-=read_this;
-    }
-    TRYFREE(buf_read);
+    if (ZREAD64(pziinit->z_filefunc, pziinit->filestream, pziinit->central_dir.data + pziinit->central_dir.size, (uLong)read_this) != read_this)
+      err=ZIP_ERRNO;
+    else
+      pziinit->central_dir.size += read_this;
   }
   pziinit->begin_pos = byte_before_the_zipfile;
   pziinit->number_entry = number_entry_CD;
@@ -876,6 +835,8 @@ extern zipFile ZEXPORT zipOpen3 (voidpf file, int append, zipcharpc* globalcomme
     ziinit.flags = flags;
     ziinit.z_filefunc.zseek32_file = NULL;
     ziinit.z_filefunc.ztell32_file = NULL;
+    ziinit.z_filefunc.zview64_file = NULL;
+    ziinit.z_filefunc.zflush64_file = NULL;
     if (pzlib_filefunc64_32_def==NULL)
         fill_qiodevice64_filefunc(&ziinit.z_filefunc.zfile_func64);
     else
@@ -898,7 +859,7 @@ extern zipFile ZEXPORT zipOpen3 (voidpf file, int append, zipcharpc* globalcomme
     ziinit.ci.stream_initialised = 0;
     ziinit.number_entry = 0;
     ziinit.add_position_when_writting_offset = 0;
-    init_linkedlist(&(ziinit.central_dir));
+    init_central_dir(&(ziinit.central_dir));
 
 
 
@@ -933,6 +894,7 @@ extern zipFile ZEXPORT zipOpen3 (voidpf file, int append, zipcharpc* globalcomme
 #    ifndef NO_ADDFILEINEXISTINGZIP
         TRYFREE(ziinit.globalcomment);
 #    endif /* !NO_ADDFILEINEXISTINGZIP*/
+        free_central_dir(&ziinit.central_dir);
         TRYFREE(zi);
         return NULL;
     }
@@ -960,6 +922,8 @@ extern zipFile ZEXPORT zipOpen2_64 (voidpf file, int append, zipcharpc* globalco
         zlib_filefunc64_32_def_fill.zfile_func64 = *pzlib_filefunc_def;
         zlib_filefunc64_32_def_fill.ztell32_file = NULL;
         zlib_filefunc64_32_def_fill.zseek32_file = NULL;
+        zlib_filefunc64_32_def_fill.zview64_file = NULL;
+        zlib_filefunc64_32_def_fill.zflush64_file = NULL;
         return zipOpen3(file, append, globalcomment, &zlib_filefunc64_32_def_fill, ZIP_DEFAULT_FLAGS);
     }
     return zipOpen3(file, append, globalcomment, NULL, ZIP_DEFAULT_FLAGS);
@@ -1472,7 +1436,7 @@ extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned in
     if (zi->in_opened_file_inzip == 0)
         return ZIP_PARAMERROR;
 
-    zi->ci.crc32 = crc32(zi->ci.crc32,buf,(uInt)len);
+    zi->ci.crc32 = quazip_crc32(zi->ci.crc32,buf,(uInt)len);
 
 #ifdef HAVE_BZIP2
     if(zi->ci.method == Z_BZIP2ED && (!zi->ci.raw))
@@ -1534,17 +1498,27 @@ extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned in
               err=deflate(&zi->ci.stream,  Z_NO_FLUSH);
               zi->ci.pos_in_buffered_data += uAvailOutBefore - zi->ci.stream.avail_out;
           }
+          else if ((zi->ci.pos_in_buffered_data == 0) && (zi->ci.encrypt == 0) &&
+                   (zi->ci.stream.avail_in >= Z_BUFSIZE))
+          {
+              /* a large piece of stored data is written without buffering */
+              uInt write_this = zi->ci.stream.avail_in;
+              if (ZWRITE64(zi->z_filefunc,zi->filestream,zi->ci.stream.next_in,write_this) != write_this)
+                  err = ZIP_ERRNO;
+              zi->ci.totalCompressedData += write_this;
+              zi->ci.totalUncompressedData += write_this;
+              zi->ci.stream.avail_in = 0;
+              zi->ci.stream.next_in += write_this;
+          }
           else
           {
-              uInt copy_this,i;
+              uInt copy_this;
               if (zi->ci.stream.avail_in < zi->ci.stream.avail_out)
                   copy_this = zi->ci.stream.avail_in;
               else
                   copy_this = zi->ci.stream.avail_out;
 
-              for (i = 0; i < copy_this; i++)
-                  *(((char*)zi->ci.stream.next_out)+i) =
-                      *(((const char*)zi->ci.stream.next_in)+i);
+              memcpy(zi->ci.stream.next_out, zi->ci.stream.next_in, copy_this);
               {
                   zi->ci.stream.avail_in -= copy_this;
                   zi->ci.stream.avail_out-= copy_this;
@@ -1561,6 +1535,103 @@ extern int ZEXPORT zipWriteInFileInZip (zipFile file,const void* buf,unsigned in
     return err;
 }
 
+extern voidpf ZEXPORT zipGetStream (zipFile file)
+{
+    if (file == NULL)
+        return NULL;
+    return ((zip64_internal*)file)->filestream;
+}
+
+extern int ZEXPORT zipWrittenInFileInZip64 (zipFile file, ZPOS64_T len, uLong crc32)
+{
+    zip64_internal* zi;
+
+    if (file == NULL)
+        return ZIP_PARAMERROR;
+    zi = (zip64_internal*)file;
+
+    if ((zi->in_opened_file_inzip == 0) || (zi->ci.encrypt != 0) ||
+        ((zi->ci.method != 0) && (!zi->ci.raw)))
+        return ZIP_PARAMERROR;
+
+    if (zi->ci.pos_in_buffered_data != 0)
+    {
+        if (zip64FlushWriteBuffer(zi) == ZIP_ERRNO)
+            return ZIP_ERRNO;
+        zi->ci.stream.avail_out = (uInt)Z_BUFSIZE;
+        zi->ci.stream.next_out = zi->ci.buffered_data;
+    }
+    /* and so does whatever the I/O functions buffered */
+    if ((zi->z_filefunc.zflush64_file != NULL) &&
+        (ZFLUSH64(zi->z_filefunc,zi->filestream) != 0))
+        return ZIP_ERRNO;
+    if (len == 0)
+        return ZIP_OK;
+
+    if ((ZPOS64_T)(z_off_t)len != len)
+        return ZIP_PARAMERROR;
+
+    zi->ci.crc32 = crc32_combine(zi->ci.crc32, crc32, (z_off_t)len);
+    zi->ci.totalCompressedData += len;
+    zi->ci.totalUncompressedData += len;
+    return ZIP_OK;
+}
+
+extern uLong ZEXPORT zipGetCentralExtraFieldRoom (zipFile file)
+{
+    zip64_internal* zi;
+    uLong used;
+
+    if (file == NULL)
+        return 0;
+    zi = (zip64_internal*)file;
+    if (zi->in_opened_file_inzip == 0)
+        return 0;
+    used = zi->ci.size_centralExtra + zi->ci.size_centralExtraFree;
+    return used < 0xffff ? 0xffff - used : 0;
+}
+
+extern int ZEXPORT zipAddCentralExtraField (zipFile file, const void* extrafield, uInt size_extrafield)
+{
+    zip64_internal* zi;
+    char* central_header;
+    uLong size_tail;
+
+    if (file == NULL)
+        return ZIP_PARAMERROR;
+    zi = (zip64_internal*)file;
+
+    if (zi->in_opened_file_inzip == 0)
+        return ZIP_PARAMERROR;
+    if ((extrafield == NULL) && (size_extrafield != 0))
+        return ZIP_PARAMERROR;
+    if (zi->ci.size_centralExtra + size_extrafield + zi->ci.size_centralExtraFree > 0xffff)
+        return ZIP_PARAMERROR;
+    if (size_extrafield == 0)
+        return ZIP_OK;
+
+    central_header = (char*)ALLOC((uInt)(zi->ci.size_centralheader + size_extrafield +
+                                         zi->ci.size_centralExtraFree));
+    if (central_header == NULL)
+        return ZIP_INTERNALERROR;
+    /* the comment follows the extra field */
+    size_tail = zi->ci.size_centralheader - (SIZECENTRALHEADER +
+                ((zi->ci.central_header[29] & 0xff) << 8 | (zi->ci.central_header[28] & 0xff)) +
+                zi->ci.size_centralExtra);
+    memcpy(central_header, zi->ci.central_header,
+           zi->ci.size_centralheader - size_tail);
+    memcpy(central_header + zi->ci.size_centralheader - size_tail, extrafield,
+           size_extrafield);
+    memcpy(central_header + zi->ci.size_centralheader - size_tail + size_extrafield,
+           zi->ci.central_header + zi->ci.size_centralheader - size_tail, size_tail);
+    TRYFREE(zi->ci.central_header);
+    zi->ci.central_header = central_header;
+    zi->ci.size_centralheader += size_extrafield;
+    zi->ci.size_centralExtra += size_extrafield;
+    zip64local_putValue_inmemory(zi->ci.central_header+30,zi->ci.size_centralExtra,2);
+    return ZIP_OK;
+}
+
 extern int ZEXPORT zipCloseFileInZipRaw (zipFile file, uLong uncompressed_size, uLong crc32)
 {
     return zipCloseFileInZipRaw64 (file, uncompressed_size, crc32);
@@ -1749,7 +1820,7 @@ extern int ZEXPORT zipCloseFileInZipRaw64 (zipFile file, ZPOS64_T uncompressed_s
     }
 
     if (err==ZIP_OK)
-        err = add_data_in_datablock(&zi->central_dir, zi->ci.central_header, zi->ci.size_centralheader);
+        err = add_data_in_central_dir(&zi->central_dir, zi->ci.central_header, zi->ci.size_centralheader);
 
     TRYFREE(zi->ci.central_header);
 
@@ -1980,20 +2051,19 @@ extern int ZEXPORT zipClose (zipFile file, const char* global_comment)
 
     if (err==ZIP_OK)
     {
-        linkedlist_datablock_internal* ldi = zi->central_dir.first_block;
-        while (ldi!=NULL)
+        ZPOS64_T written = 0;
+        while ((err==ZIP_OK) && (written < zi->central_dir.size))
         {
-            if ((err==ZIP_OK) && (ldi->filled_in_this_block>0))
-            {
-                if (ZWRITE64(zi->z_filefunc,zi->filestream, ldi->data, ldi->filled_in_this_block) != ldi->filled_in_this_block)
-                    err = ZIP_ERRNO;
-            }
-
-            size_centraldir += ldi->filled_in_this_block;
-            ldi = ldi->next_datablock;
+            ZPOS64_T write_this = zi->central_dir.size - written;
+            if (write_this > CENTRAL_DIR_MAX_IO)
+                write_this = CENTRAL_DIR_MAX_IO;
+            if (ZWRITE64(zi->z_filefunc,zi->filestream, zi->central_dir.data + written, (uLong)write_this) != write_this)
+                err = ZIP_ERRNO;
+            written += write_this;
         }
     }
-    free_linkedlist(&(zi->central_dir));
+    size_centraldir = (uLong)zi->central_dir.size;
+    free_central_dir(&(zi->central_dir));
 
     pos = centraldir_pos_inzip - zi->add_position_when_writting_offset;
     if(pos >= 0xffffffff || zi->number_entry > 0xFFFF)
@@ -2091,6 +2161,18 @@ extern int ZEXPORT zipRemoveExtraInfoBlock (char* pData, int* dataLen, short sHe
   return retVal;
 }
 
+extern int ZEXPORT zipReserveCentralDir (zipFile file, ZPOS64_T number_entry)
+{
+    zip64_internal* zi;
+    if (file == NULL)
+        return ZIP_PARAMERROR;
+    zi = (zip64_internal*)file;
+    if (number_entry > (ZPOS64_T)-1 / 2 / CENTRAL_DIR_RECORD_SIZE)
+        return ZIP_PARAMERROR;
+    return reserve_central_dir(&zi->central_dir,
+                               zi->central_dir.size + number_entry * CENTRAL_DIR_RECORD_SIZE);
+}
+
 int ZEXPORT zipSetFlags(zipFile file, unsigned flags)
 {
     zip64_internal* zi;
@@ -334,6 +334,55 @@ extern int ZEXPORT zipWriteInFileInZip OF((zipFile file,
   Write data in the zipfile
 */
 
+extern voidpf ZEXPORT zipGetStream OF((zipFile file));
+/*
+  Return the stream the zipfile is written to, as returned by the open
+    function of the I/O API (the QIODevice for QuaZip), or NULL.
+  Some of the data may still be buffered, see zipWrittenInFileInZip64().
+*/
+
+extern int ZEXPORT zipWrittenInFileInZip64 OF((zipFile file,
+                                               ZPOS64_T len,
+                                               uLong crc32));
+/*
+  Account for len bytes of the current file written by the caller right to
+    the underlying stream at its current position, crc32 being their CRC,
+    such as with a copy done by the kernel.
+  Call it with len 0 before writing, to flush the data buffered so far,
+    by minizip and by the I/O functions.
+  len must fit in z_off_t, so larger pieces have to be accounted in parts.
+  Only stored files and files opened with raw=1 can be written this way,
+    and only without encryption, otherwise ZIP_PARAMERROR is returned.
+*/
+
+extern int ZEXPORT zipAddCentralExtraField OF((zipFile file,
+                                               const void* extrafield,
+                                               uInt size_extrafield));
+/*
+  Add an extra field block to the central directory record of the current
+    file, such as one that can be built only after the data is written.
+  extrafield must contain whole blocks, with their header ID and size.
+  Must be called before closing the file. Returns ZIP_PARAMERROR if the
+    extra field of the record, with the room kept for the zip64 block,
+    would grow beyond 0xffff bytes.
+*/
+
+extern uLong ZEXPORT zipGetCentralExtraFieldRoom OF((zipFile file));
+/*
+  Return how many bytes zipAddCentralExtraField can still add to the
+    central directory record of the current file, or 0 if no file is open.
+*/
+
+extern int ZEXPORT zipReserveCentralDir OF((zipFile file,
+                                            ZPOS64_T number_entry));
+/*
+  Reserve memory for the central directory records of number_entry more
+    files, so that adding them doesn't have to grow the buffer the
+    central directory is kept in until zipClose(). The room reserved is
+    an estimate, a larger directory still works. Returns
+    ZIP_INTERNALERROR if the memory can't be allocated.
+*/
+
 extern int ZEXPORT zipCloseFileInZip OF((zipFile file));
 /*
   Close the current file in the zipfile
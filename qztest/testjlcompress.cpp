@@ -26,6 +26,8 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 
 #include "qztest.h"
 
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QBuffer>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
@@ -420,6 +422,76 @@ void TestJlCompress::compressDirOptions()
     curDir.remove(zipName);
 }
 
+void TestJlCompress::compressDirThreads()
+{
+    QStringList fileNames;
+    for (int i = 0; i < 40; ++i)
+        fileNames << QString("threads%1/test%2.txt").arg(i % 5).arg(i);
+    fileNames << "threads1/subdir/" << "emptydir/";
+    if (!createTestFiles(fileNames, -1, "compressDir_tmp")) {
+        QFAIL("Can't create test files");
+    }
+    // large enough to be compressed to a temporary file
+    if (!createTestFileLarge("threadsbig.bin", 17 * 1024 * 1024, "compressDir_tmp", true)) {
+        QFAIL("Can't create a large test file");
+    }
+    fileNames << "threadsbig.bin";
+    const QDateTime dateTime(QDate(2024, 9, 19), QTime(21, 0, 0), QTimeZone::utc());
+    JlCompress::Options options(dateTime);
+    QVERIFY(JlCompress::compressDir("jlserial.zip", "compressDir_tmp", true,
+                                    QDir::Filters(), options));
+    options.setThreadCount(4);
+    QVERIFY(JlCompress::compressDir("jlthreads.zip", "compressDir_tmp", true,
+                                    QDir::Filters(), options));
+    // the same archive, byte for byte
+    QFile serialFile("jlserial.zip");
+    QFile threadsFile("jlthreads.zip");
+    QVERIFY(serialFile.open(QIODevice::ReadOnly));
+    QVERIFY(threadsFile.open(QIODevice::ReadOnly));
+    QCOMPARE(threadsFile.size(), serialFile.size());
+    QVERIFY(threadsFile.readAll() == serialFile.readAll());
+    serialFile.close();
+    threadsFile.close();
+    removeTestFiles(fileNames, "compressDir_tmp");
+    QDir curDir;
+    curDir.remove("jlserial.zip");
+    curDir.remove("jlthreads.zip");
+}
+
+void TestJlCompress::copyStored()
+{
+    if (!createTestFileLarge("copybig.bin", 5 * 1024 * 1024 + 17, "copy_tmp", true)) {
+        QFAIL("Can't create a large test file");
+    }
+    QFile original("copy_tmp/copybig.bin");
+    QVERIFY(original.open(QIODevice::ReadOnly));
+    const QByteArray contents = original.readAll();
+    original.close();
+    JlCompress::Options options(JlCompress::Options::Storage);
+    // an odd buffer size, so the pieces don't line up with anything
+    options.setBufferSize(100003);
+    {
+        QuaZip zip("jlcopy.zip");
+        QVERIFY(zip.open(QuaZip::mdCreate));
+        QVERIFY(JlCompress::compressFile(&zip, "copy_tmp/copybig.bin", "copybig.bin", options));
+        zip.close();
+        QCOMPARE(zip.getZipError(), ZIP_OK);
+    }
+    for (bool mapped : {false, true}) {
+        QuaZip zip("jlcopy.zip");
+        zip.setMemoryMappingEnabled(mapped);
+        QCOMPARE(JlCompress::extractFile(zip, "copybig.bin", "copy_tmp/extracted.bin"),
+                 QFileInfo("copy_tmp/extracted.bin").absoluteFilePath());
+        QFile extracted("copy_tmp/extracted.bin");
+        QVERIFY(extracted.open(QIODevice::ReadOnly));
+        QVERIFY(extracted.readAll() == contents);
+        extracted.close();
+        QVERIFY(extracted.remove());
+    }
+    removeTestFiles(QStringList() << "copybig.bin", "copy_tmp");
+    QDir().remove("jlcopy.zip");
+}
+
 void TestJlCompress::extractFile_data()
 {
     QTest::addColumn<QString>("zipName");
@@ -692,6 +764,87 @@ void TestJlCompress::extractDir()
     //curDir.remove(zipName);
 }
 
+class ReadCountingBuffer: public QBuffer {
+public:
+    QAtomicInteger<qint64> bytesRead{0};
+protected:
+    qint64 readData(char *data, qint64 maxSize) override {
+        const qint64 read = QBuffer::readData(data, maxSize);
+        if (read > 0)
+            bytesRead.fetchAndAddRelaxed(read);
+        return read;
+    }
+};
+
+void TestJlCompress::extractDirThreads()
+{
+    QStringList fileNames;
+    for (int i = 0; i < 40; ++i)
+        fileNames << QString("threads%1/test%2.txt").arg(i % 5).arg(i);
+    fileNames << "threadsdir/" << "../threadsslip.txt";
+    QString zipName = "jlthreads.zip";
+    if (!createTestFiles(fileNames)) {
+        QFAIL("Couldn't create test files");
+    }
+    if (!createTestFileLarge("threadsbig.bin", 4 * 1024 * 1024, "tmp", true)) {
+        QFAIL("Couldn't create a large test file");
+    }
+    fileNames << "threadsbig.bin";
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Couldn't create test archive");
+    }
+    QDir curDir;
+    const QString serialDir = "tmp/jlthreads/serial/";
+    const QString threadsDir = "tmp/jlthreads/threads/";
+    QStringList serial = JlCompress::extractDir(zipName, serialDir);
+    QCOMPARE(serial.count(), fileNames.count() - 1); // minus the slip
+    JlCompress::Options options;
+    options.setThreadCount(4);
+    QStringList threads = JlCompress::extractDir(zipName, threadsDir, options);
+    QCOMPARE(threads.count(), serial.count());
+    for (int i = 0; i < serial.count(); ++i) {
+        // same order, same contents
+        QString name = QDir(serialDir).relativeFilePath(serial.at(i));
+        QCOMPARE(QDir(threadsDir).relativeFilePath(threads.at(i)), name);
+        QFileInfo serialInfo(serial.at(i));
+        QFileInfo threadsInfo(threads.at(i));
+        QCOMPARE(threadsInfo.isDir(), serialInfo.isDir());
+        QCOMPARE(threadsInfo.permissions(), serialInfo.permissions());
+        if (serialInfo.isDir())
+            continue;
+        QFile serialFile(serial.at(i));
+        QFile threadsFile(threads.at(i));
+        QVERIFY(serialFile.open(QIODevice::ReadOnly));
+        QVERIFY(threadsFile.open(QIODevice::ReadOnly));
+        QCOMPARE(threadsFile.readAll(), serialFile.readAll());
+    }
+    QVERIFY(!QFileInfo::exists("tmp/jlthreads/threadsslip.txt"));
+    // the QIODevice* overload, with the ideal thread count
+    QFile zipFile(zipName);
+    QVERIFY(zipFile.open(QIODevice::ReadOnly));
+    options.setThreadCount(0);
+    QCOMPARE(JlCompress::extractDir(&zipFile, threadsDir, options).count(),
+             serial.count());
+    // reading ahead as extractDir() by name does, the threads still read
+    // little more than the archive itself
+    QVERIFY(zipFile.seek(0));
+    ReadCountingBuffer zipBuffer;
+    zipBuffer.setData(zipFile.readAll());
+    zipFile.close();
+    QVERIFY(zipBuffer.open(QIODevice::ReadOnly | QIODevice::Unbuffered));
+    QuaZip zip(&zipBuffer);
+    zip.setReadAheadSize(1024 * 1024);
+    zip.setPrefetchEnabled(true);
+    options.setThreadCount(4);
+    QCOMPARE(JlCompress::extractDir(zip, threadsDir, options).count(),
+             serial.count());
+    QVERIFY(zipBuffer.bytesRead.loadRelaxed() < 2 * zipBuffer.size());
+    zipBuffer.close();
+    QVERIFY(QDir("tmp/jlthreads").removeRecursively());
+    removeTestFiles(fileNames);
+    curDir.remove(zipName);
+}
+
 void TestJlCompress::zeroPermissions()
 {
     QuaZip zipCreator("zero.zip");
@@ -49,12 +49,15 @@ private slots:
     void compressDir();
     void compressDirOptions_data();
     void compressDirOptions();
+    void compressDirThreads();
+    void copyStored();
     void extractFile_data();
     void extractFile();
     void extractFiles_data();
     void extractFiles();
     void extractDir_data();
     void extractDir();
+    void extractDirThreads();
     void zeroPermissions();
 #ifdef QUAZIP_SYMLINK_TEST
     void symlinkHandling();
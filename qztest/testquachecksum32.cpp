@@ -25,10 +25,14 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include "testquachecksum32.h"
 
 #include <quaadler32.h>
+#include <quachecksumiodevice.h>
 #include <quacrc32.h>
 
+#include <QtCore/QBuffer>
 #include <QtTest/QTest>
 
+#include <zlib.h>
+
 void TestQuaChecksum32::calculate()
 {
     QuaCrc32 crc32;
@@ -48,3 +52,104 @@ void TestQuaChecksum32::update()
     adler32.update("pedia");
     QCOMPARE(adler32.value(), 0x11E60398u);
 }
+
+void TestQuaChecksum32::largeCrc32()
+{
+    // long enough for the hardware-assisted code, at all the alignments
+    QByteArray data(70000, '\0');
+    for (int i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>((i * 131 + i / 251) & 0xff);
+    const int sizes[] = {0, 1, 15, 16, 63, 64, 65, 255, 256, 1000, 4096,
+                         8191, 8192, 8209, 65536, 69900};
+    for (int size: sizes) {
+        for (int offset = 0; offset < 64; offset += 7) {
+            const QByteArray chunk = data.mid(offset, size);
+            const quint32 expected = static_cast<quint32>(crc32(0L,
+                    reinterpret_cast<const Bytef*>(chunk.constData()),
+                    static_cast<uInt>(chunk.size())));
+            QuaCrc32 crc;
+            QCOMPARE(crc.calculate(chunk), expected);
+            crc.update(chunk.left(size / 3));
+            crc.update(chunk.mid(size / 3));
+            QCOMPARE(crc.value(), expected);
+        }
+    }
+}
+
+void TestQuaChecksum32::span()
+{
+    // several minimum-sized pieces and an odd tail
+    QByteArray data(5 * 1024 * 1024 + 123, '\0');
+    for (int i = 0; i < data.size(); ++i)
+        data[i] = static_cast<char>((i * 7 + i / 1021) & 0xff);
+    const QByteArray head = data.left(1000);
+    const QByteArray tail = data.mid(1000);
+    QuaCrc32 crc32;
+    const quint32 crc = crc32.calculate(data);
+    QCOMPARE(crc32.calculate(data.constData(), data.size()), crc);
+    QCOMPARE(crc32.calculate(data.constData(), data.size(), 4), crc);
+    QCOMPARE(crc32.calculate(data.constData(), data.size(), 0), crc);
+    crc32.update(head);
+    crc32.update(tail.constData(), tail.size(), 3);
+    QCOMPARE(crc32.value(), crc);
+    QCOMPARE(QuaCrc32::combine(crc32.calculate(head), crc32.calculate(tail),
+                               tail.size()), crc);
+    QuaAdler32 adler32;
+    const quint32 adler = adler32.calculate(data);
+    QCOMPARE(adler32.calculate(data.constData(), data.size(), 4), adler);
+    adler32.update(head);
+    adler32.update(tail.constData(), tail.size(), 3);
+    QCOMPARE(adler32.value(), adler);
+    QCOMPARE(QuaAdler32::combine(adler32.calculate(head),
+                                 adler32.calculate(tail), tail.size()),
+             adler);
+    // the size doesn't have to fit in 32 bits
+    const qint64 huge = 5LL * 1024 * 1024 * 1024 + 3;
+    QCOMPARE(QuaCrc32::combine(0xADAAC02Eu, 0x12345678u, huge), 0x8223E596u);
+    QCOMPARE(QuaAdler32::combine(0x11E60398u, 0x12345678u, huge), 0x60BC5A0Fu);
+}
+
+void TestQuaChecksum32::views()
+{
+    const char data[] = "Wikipedia";
+    QuaCrc32 crc32;
+    QuaChecksum32 &checksum = crc32;
+    QCOMPARE(checksum.calculate(data, 9), 0xADAAC02Eu);
+    QCOMPARE(checksum.calculate(QByteArrayView(data, 9)), 0xADAAC02Eu);
+    checksum.update(data, 4);
+    checksum.update(QByteArrayView(data + 4, 5));
+    QCOMPARE(checksum.value(), 0xADAAC02Eu);
+    QuaAdler32 adler32;
+    QCOMPARE(adler32.calculate(QByteArrayView(data, 9)), 0x11E60398u);
+    adler32.update(data, 4);
+    adler32.update(QByteArrayView(data + 4, 5));
+    QCOMPARE(adler32.value(), 0x11E60398u);
+}
+
+void TestQuaChecksum32::ioDevice()
+{
+    QByteArray data("Wikipedia");
+    QBuffer input(&data);
+    QVERIFY(input.open(QIODevice::ReadOnly));
+    QuaCrc32 crc32;
+    QuaChecksumIODevice reader(&input, &crc32);
+    QVERIFY(reader.open(QIODevice::ReadOnly));
+    QCOMPARE(reader.read(4), QByteArray("Wiki"));
+    QCOMPARE(reader.readAll(), QByteArray("pedia"));
+    QVERIFY(reader.atEnd());
+    QCOMPARE(reader.getSize(), static_cast<qint64>(9));
+    QCOMPARE(crc32.value(), 0xADAAC02Eu);
+    reader.close();
+    QByteArray written;
+    QBuffer output(&written);
+    QVERIFY(output.open(QIODevice::WriteOnly));
+    QuaAdler32 adler32;
+    QuaChecksumIODevice writer(&output, &adler32);
+    QVERIFY(!writer.open(QIODevice::ReadOnly));
+    QVERIFY(writer.open(QIODevice::WriteOnly));
+    QCOMPARE(writer.write("Wiki"), static_cast<qint64>(4));
+    QCOMPARE(writer.write("pedia"), static_cast<qint64>(5));
+    writer.close();
+    QCOMPARE(written, data);
+    QCOMPARE(adler32.value(), 0x11E60398u);
+}
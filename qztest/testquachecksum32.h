@@ -32,6 +32,10 @@ class TestQuaChecksum32: public QObject {
 private slots:
     void calculate();
     void update();
+    void largeCrc32();
+    void span();
+    void views();
+    void ioDevice();
 };
 
 #endif // QUAZIP_TEST_QUACHECKSUM32_H
@@ -26,7 +26,9 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include <quagzipfile.h>
 #include <zlib.h>
 
+#include <QtCore/QBuffer>
 #include <QtCore/QDir>
+#include <QtCore/QFile>
 #include <QtTest/QTest>
 
 void TestQuaGzipFile::read()
@@ -70,6 +72,239 @@ void TestQuaGzipFile::write()
     curDir.rmdir("tmp");
 }
 
+void TestQuaGzipFile::device()
+{
+    QByteArray first, second;
+    for (int i = 0; i < 20000; ++i) {
+        first.append(QByteArray::number(i));
+        second.append(QByteArray::number(i * 7));
+    }
+    QByteArray buf;
+    QBuffer buffer(&buf);
+    QuaGzipFile testFile;
+    QVERIFY(!testFile.open(&buffer, QIODevice::WriteOnly)); // not open
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    testFile.setBufferSize(1024);
+    testFile.setFlushMode(Z_FINISH);
+    QVERIFY(testFile.open(&buffer, QIODevice::WriteOnly));
+    QCOMPARE(testFile.getIoDevice(), static_cast<QIODevice*>(&buffer));
+    QCOMPARE(testFile.write(first), static_cast<qint64>(first.size()));
+    QVERIFY(testFile.flush()); // ends the first member
+    QCOMPARE(testFile.write(second), static_cast<qint64>(second.size()));
+    testFile.close();
+    QVERIFY(!testFile.isOpen());
+    QVERIFY(buffer.isOpen());
+    buffer.close();
+    // gunzip reads both members
+    QDir curDir;
+    curDir.mkpath("tmp");
+    QFile gz("tmp/test.gz");
+    QVERIFY(gz.open(QIODevice::WriteOnly));
+    gz.write(buf);
+    gz.close();
+    gzFile file = gzopen("tmp/test.gz", "rb");
+    QByteArray unzipped(first.size() + second.size() + 1, 0);
+    QCOMPARE(gzread(file, unzipped.data(), unzipped.size()),
+             static_cast<int>(first.size() + second.size()));
+    gzclose(file);
+    unzipped.chop(1);
+    QCOMPARE(unzipped, first + second);
+    curDir.remove("tmp/test.gz");
+    curDir.rmdir("tmp");
+    // and so does QuaGzipFile, ignoring the trailing garbage
+    buf.append("garbage");
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QuaGzipFile readFile;
+    readFile.setBufferSize(100);
+    QVERIFY(readFile.open(&buffer, QIODevice::ReadOnly));
+    QCOMPARE(readFile.readAll(), first + second);
+    QVERIFY(readFile.atEnd());
+    readFile.close();
+    buffer.close();
+    // a truncated stream is read as far as it goes
+    buf.chop(20);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QVERIFY(readFile.open(&buffer, QIODevice::ReadOnly));
+    QByteArray truncated = readFile.readAll();
+    QVERIFY(!readFile.atEnd());
+    QVERIFY(truncated.size() <= first.size() + second.size());
+    QVERIFY((first + second).startsWith(truncated));
+    // and then it's an error, not the end of it
+    char c;
+    QCOMPARE(readFile.read(&c, 1), static_cast<qint64>(-1));
+    QCOMPARE(readFile.errorString(),
+             QString::fromLatin1("Unexpected end of gzip stream"));
+    readFile.close();
+}
+
+void TestQuaGzipFile::parallel()
+{
+    QByteArray data;
+    for (int i = 0; i < 100000; ++i)
+        data.append(QByteArray::number(i * 13));
+    QDir curDir;
+    curDir.mkpath("tmp");
+    QuaGzipFile testFile("tmp/test.gz");
+    testFile.setThreadCount(4);
+    testFile.setBlockSize(10000);
+    QCOMPARE(testFile.getThreadCount(), 4);
+    QCOMPARE(testFile.getBlockSize(), 10000);
+    QVERIFY(testFile.open(QIODevice::WriteOnly));
+    QCOMPARE(testFile.write(data.left(12345)), static_cast<qint64>(12345));
+    QVERIFY(testFile.flush()); // ends the member early
+    QCOMPARE(testFile.write(data.mid(12345)),
+             static_cast<qint64>(data.size() - 12345));
+    testFile.close();
+    QVERIFY(!testFile.isOpen());
+    // an ordinary gzip file with many members
+    gzFile file = gzopen("tmp/test.gz", "rb");
+    QByteArray unzipped(data.size() + 1, 0);
+    QCOMPARE(gzread(file, unzipped.data(), unzipped.size()),
+             static_cast<int>(data.size()));
+    gzclose(file);
+    unzipped.chop(1);
+    QCOMPARE(unzipped, data);
+    // followed by a member written by zlib, which is read serially
+    file = gzopen("tmp/test.gz", "ab");
+    gzwrite(file, "tail", 4);
+    gzclose(file);
+    QuaGzipFile readFile("tmp/test.gz");
+    readFile.setThreadCount(3);
+    readFile.setBufferSize(4096);
+    QVERIFY(readFile.open(QIODevice::ReadOnly));
+    QCOMPARE(readFile.read(100), data.left(100));
+    QCOMPARE(readFile.readAll(), data.mid(100) + "tail");
+    QVERIFY(readFile.atEnd());
+    readFile.close();
+    // a truncated file is read as far as it goes
+    QFile gz("tmp/test.gz");
+    QVERIFY(gz.open(QIODevice::ReadOnly));
+    QByteArray truncated = gz.read(gz.size() / 2);
+    gz.close();
+    QBuffer buffer(&truncated);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QVERIFY(readFile.open(&buffer, QIODevice::ReadOnly));
+    QByteArray partial = readFile.readAll();
+    QVERIFY(!partial.isEmpty());
+    QVERIFY(data.startsWith(partial));
+    QVERIFY(!readFile.atEnd());
+    char c;
+    QCOMPARE(readFile.read(&c, 1), static_cast<qint64>(-1));
+    QCOMPARE(readFile.errorString(),
+             QString::fromLatin1("Unexpected end of gzip stream"));
+    readFile.close();
+    // a forged member size isn't trusted, the file is read serially then
+    QVERIFY(gz.open(QIODevice::ReadOnly));
+    const QByteArray whole = gz.readAll();
+    gz.close();
+    const char *forgedSizes[] = {"\xff\xff\xff\xff", "\x00\x00\x00\x80",
+                                 "\x00\x00\x00\x10"};
+    for (const char *forgedSize : forgedSizes) {
+        QByteArray forged = whole;
+        forged.replace(16, 4, forgedSize, 4); // the QZ subfield data
+        QBuffer forgedBuffer(&forged);
+        QVERIFY(forgedBuffer.open(QIODevice::ReadOnly));
+        QVERIFY(readFile.open(&forgedBuffer, QIODevice::ReadOnly));
+        QCOMPARE(readFile.readAll(), data + "tail");
+        QVERIFY(readFile.atEnd());
+        readFile.close();
+    }
+    // so is one that's plausible, but reaches into the next member
+    QByteArray overlapping = whole;
+    const quint32 memberSize = static_cast<quint8>(whole.at(16))
+            | static_cast<quint8>(whole.at(17)) << 8
+            | static_cast<quint8>(whole.at(18)) << 16
+            | static_cast<quint32>(static_cast<quint8>(whole.at(19))) << 24;
+    const quint32 tooLarge = memberSize + 300;
+    const char overlappingSize[] = {
+        static_cast<char>(tooLarge), static_cast<char>(tooLarge >> 8),
+        static_cast<char>(tooLarge >> 16), static_cast<char>(tooLarge >> 24)};
+    overlapping.replace(16, 4, overlappingSize, 4);
+    QBuffer overlappingBuffer(&overlapping);
+    QVERIFY(overlappingBuffer.open(QIODevice::ReadOnly));
+    QVERIFY(readFile.open(&overlappingBuffer, QIODevice::ReadOnly));
+    partial = readFile.readAll();
+    QVERIFY(data.startsWith(partial));
+    QVERIFY(!readFile.atEnd());
+    QCOMPARE(readFile.read(&c, 1), static_cast<qint64>(-1));
+    QCOMPARE(readFile.errorString(), QString::fromLatin1("data error"));
+    readFile.close();
+    curDir.remove("tmp/test.gz");
+    curDir.rmdir("tmp");
+}
+
+void TestQuaGzipFile::bgzf()
+{
+    QByteArray data;
+    for (int i = 0; i < 100000; ++i)
+        data.append(QByteArray::number(i * 17));
+    QByteArray buf;
+    QBuffer buffer(&buf);
+    QVERIFY(buffer.open(QIODevice::WriteOnly));
+    QuaGzipFile testFile;
+    testFile.setBgzfEnabled(true);
+    testFile.setThreadCount(2);
+    QVERIFY(testFile.isBgzfEnabled());
+    QVERIFY(testFile.open(&buffer, QIODevice::WriteOnly));
+    QCOMPARE(testFile.write(data), static_cast<qint64>(data.size()));
+    testFile.close();
+    buffer.close();
+    // BC subfield in the first block, the end-of-file marker at the end
+    QCOMPARE(buf.mid(12, 4), QByteArray("BC\x02\x00", 4));
+    QCOMPARE(buf.right(28), QByteArray("\x1f\x8b\x08\x04\x00\x00\x00\x00"
+            "\x00\xff\x06\x00\x42\x43\x02\x00\x1b\x00\x03\x00\x00\x00"
+            "\x00\x00\x00\x00\x00\x00", 28));
+    // the index of the blocks written
+    QByteArray gzi;
+    QBuffer gziBuffer(&gzi);
+    QVERIFY(gziBuffer.open(QIODevice::WriteOnly));
+    QVERIFY(testFile.saveBgzfIndex(&gziBuffer));
+    gziBuffer.close();
+    const int blocks = (data.size() + 0xff00 - 1) / 0xff00;
+    QCOMPARE(gzi.size(), 8 + (blocks - 1) * 16);
+    // an ordinary gzip reader reads it
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QuaGzipFile plainFile;
+    QVERIFY(plainFile.open(&buffer, QIODevice::ReadOnly));
+    QCOMPARE(plainFile.readAll(), data);
+    plainFile.close();
+    buffer.close();
+    // virtual offsets
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QuaGzipFile readFile;
+    readFile.setBgzfEnabled(true);
+    QVERIFY(readFile.open(&buffer, QIODevice::ReadOnly));
+    QCOMPARE(readFile.virtualOffset(), static_cast<quint64>(0));
+    QCOMPARE(readFile.read(70000), data.left(70000));
+    const quint64 offset = readFile.virtualOffset();
+    QVERIFY((offset >> 16) != 0);
+    QCOMPARE(readFile.read(100), data.mid(70000, 100));
+    QVERIFY(readFile.seekVirtualOffset(offset));
+    QCOMPARE(readFile.read(100), data.mid(70000, 100));
+    QVERIFY(readFile.seekVirtualOffset(0));
+    QCOMPARE(readFile.read(10), data.left(10));
+    // uncompressed positions, with the index built
+    QVERIFY(readFile.seek(123456));
+    QCOMPARE(readFile.read(50), data.mid(123456, 50));
+    QVERIFY(readFile.seek(5));
+    QCOMPARE(readFile.readAll(), data.mid(5));
+    QVERIFY(readFile.atEnd());
+    QVERIFY(!readFile.seek(data.size() + 100000));
+    readFile.close();
+    // and with the index loaded
+    QuaGzipFile indexedFile;
+    indexedFile.setBgzfEnabled(true);
+    QVERIFY(gziBuffer.open(QIODevice::ReadOnly));
+    QVERIFY(indexedFile.loadBgzfIndex(&gziBuffer));
+    gziBuffer.close();
+    QVERIFY(buffer.seek(0)); // the stream starts where the device is
+    QVERIFY(indexedFile.open(&buffer, QIODevice::ReadOnly));
+    QVERIFY(indexedFile.seek(data.size() - 10));
+    QCOMPARE(indexedFile.readAll(), data.right(10));
+    indexedFile.close();
+    buffer.close();
+}
+
 void TestQuaGzipFile::constructorDestructor()
 {
     QuaGzipFile *f1 = new QuaGzipFile();
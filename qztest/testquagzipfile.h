@@ -32,6 +32,9 @@ class TestQuaGzipFile: public QObject {
 private slots:
     void read();
     void write();
+    void device();
+    void parallel();
+    void bgzf();
     void constructorDestructor();
 };
 
@@ -112,3 +112,67 @@ void TestQuaZIODevice::write()
     QCOMPARE(static_cast<const char*>(outBuf), "test");
     delete testDevice; // Test D0 destructor
 }
+
+void TestQuaZIODevice::writeOptions()
+{
+    QByteArray data;
+    for (int i = 0; i < 10000; ++i)
+        data.append(QByteArray::number(i % 97).repeated(i % 7 + 1));
+    QByteArray buf;
+    QBuffer testBuffer(&buf);
+    testBuffer.open(QIODevice::WriteOnly);
+    QuaZIODevice testDevice(&testBuffer);
+    QCOMPARE(testDevice.getOutputBufferSize(), 4096);
+    QCOMPARE(testDevice.getWindowBits(), MAX_WBITS);
+    testDevice.setOutputBufferSize(64 * 1024);
+    testDevice.setCompressionLevel(Z_BEST_SPEED);
+    testDevice.setStrategy(Z_RLE);
+    testDevice.setMemLevel(9);
+    testDevice.setWindowBits(16 + MAX_WBITS); // gzip
+    QVERIFY(testDevice.open(QIODevice::WriteOnly));
+    QCOMPARE(testDevice.write(data), static_cast<qint64>(data.size()));
+    testDevice.close();
+    testBuffer.close();
+    // the gzip header
+    QVERIFY(buf.size() > 10);
+    QCOMPARE(static_cast<unsigned char>(buf.at(0)), 0x1fu);
+    QCOMPARE(static_cast<unsigned char>(buf.at(1)), 0x8bu);
+    // zlib with automatic header detection reads it all
+    z_stream zins;
+    zins.zalloc = (alloc_func) NULL;
+    zins.zfree = (free_func) NULL;
+    zins.opaque = NULL;
+    QCOMPARE(inflateInit2(&zins, 32 + MAX_WBITS), Z_OK);
+    QByteArray inflated(data.size() + 1, 0);
+    zins.next_in = reinterpret_cast<Bytef*>(buf.data());
+    zins.avail_in = buf.size();
+    zins.next_out = reinterpret_cast<Bytef*>(inflated.data());
+    zins.avail_out = inflated.size();
+    QCOMPARE(inflate(&zins, Z_FINISH), Z_STREAM_END);
+    inflateEnd(&zins);
+    inflated.resize(inflated.size() - zins.avail_out);
+    QCOMPARE(inflated, data);
+    // and so does QuaZIODevice with the same framing and a big buffer
+    testBuffer.open(QIODevice::ReadOnly);
+    QuaZIODevice readDevice(&testBuffer);
+    readDevice.setInputBufferSize(128 * 1024);
+    readDevice.setWindowBits(16 + MAX_WBITS);
+    QVERIFY(readDevice.open(QIODevice::ReadOnly));
+    QCOMPARE(readDevice.readAll(), data);
+    QVERIFY(readDevice.atEnd());
+    readDevice.close();
+    testBuffer.close();
+    // a raw deflate stream round-trips too
+    buf.clear();
+    testBuffer.open(QIODevice::WriteOnly);
+    testDevice.setWindowBits(-MAX_WBITS);
+    QVERIFY(testDevice.open(QIODevice::WriteOnly));
+    QCOMPARE(testDevice.write(data), static_cast<qint64>(data.size()));
+    testDevice.close();
+    testBuffer.close();
+    testBuffer.open(QIODevice::ReadOnly);
+    readDevice.setWindowBits(-MAX_WBITS);
+    QVERIFY(readDevice.open(QIODevice::ReadOnly));
+    QCOMPARE(readDevice.readAll(), data);
+    readDevice.close();
+}
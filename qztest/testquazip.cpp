@@ -32,6 +32,7 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include <QtCore/QHash>
 #ifdef QUAZIP_TEST_QSAVEFILE
 #include <QtCore/QSaveFile>
+#include <QtCore/QThread>
 #endif
 #include <QtNetwork/QTcpServer>
 #include <QtNetwork/QTcpSocket>
@@ -41,6 +42,7 @@ see quazip/(un)zip.h files for details. Basically it's the zlib license.
 #include <QtTest/QTest>
 
 #include <quazip.h>
+#include <quazipdir.h>
 #include <JlCompress.h>
 
 void TestQuaZip::getFileList_data()
@@ -107,6 +109,554 @@ void TestQuaZip::getFileList()
     curDir.remove(zipName);
 }
 
+void TestQuaZip::catalog_data()
+{
+    getFileList_data();
+}
+
+void TestQuaZip::catalog()
+{
+    QFETCH(QString, zipName);
+    QFETCH(QStringList, fileNames);
+    QDir curDir;
+    if (curDir.exists(zipName)) {
+        if (!curDir.remove(zipName))
+            QFAIL("Can't remove zip file");
+    }
+    if (!createTestFiles(fileNames)) {
+        QFAIL("Can't create test file");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    QuaZip plainZip(zipName);
+    QVERIFY(plainZip.open(QuaZip::mdUnzip));
+    QuaZip testZip(zipName);
+    QVERIFY(!testZip.isCatalogEnabled());
+    testZip.setCatalogEnabled(true);
+    QVERIFY(testZip.isCatalogEnabled());
+    QVERIFY(testZip.open(QuaZip::mdUnzip));
+    QVERIFY(testZip.setCurrentFile(fileNames.last()));
+    QCOMPARE(testZip.getEntriesCount(), plainZip.getEntriesCount());
+    QCOMPARE(testZip.getFileNameList(), plainZip.getFileNameList());
+    QList<QuaZipFileInfo64> catalogList = testZip.getFileInfoList64();
+    QList<QuaZipFileInfo64> plainList = plainZip.getFileInfoList64();
+    QCOMPARE(catalogList.size(), plainList.size());
+    for (int i = 0; i < catalogList.size(); ++i) {
+        QCOMPARE(catalogList[i].name, plainList[i].name);
+        QCOMPARE(catalogList[i].crc, plainList[i].crc);
+        QCOMPARE(catalogList[i].method, plainList[i].method);
+        QCOMPARE(catalogList[i].flags, plainList[i].flags);
+        QCOMPARE(catalogList[i].compressedSize, plainList[i].compressedSize);
+        QCOMPARE(catalogList[i].uncompressedSize, plainList[i].uncompressedSize);
+        QCOMPARE(catalogList[i].externalAttr, plainList[i].externalAttr);
+        QCOMPARE(catalogList[i].dateTime, plainList[i].dateTime);
+        QCOMPARE(catalogList[i].extra, plainList[i].extra);
+        QCOMPARE(catalogList[i].comment, plainList[i].comment);
+    }
+    QCOMPARE(QuaZipDir(&testZip).entryList(), QuaZipDir(&plainZip).entryList());
+    // prefix lookups find the same files in the same order as a walk
+    QStringList prefixes;
+    prefixes << QString() << "no/such/dir/";
+    for (const QString &fileName : fileNames) {
+        for (int slash = fileName.indexOf('/'); slash != -1;
+                slash = fileName.indexOf('/', slash + 1))
+            prefixes << fileName.left(slash + 1);
+    }
+    for (const QString &prefix : prefixes) {
+        QStringList catalogNames, plainNames;
+        for (const QuaZipFileInfo64 &info : testZip.getFileInfoList64(prefix))
+            catalogNames << info.name;
+        for (const QuaZipFileInfo64 &info : plainZip.getFileInfoList64(prefix))
+            plainNames << info.name;
+        QCOMPARE(catalogNames, plainNames);
+        QCOMPARE(QuaZipDir(&testZip, prefix).entryList(),
+                 QuaZipDir(&plainZip, prefix).entryList());
+    }
+    // listing must not move the current file
+    QCOMPARE(testZip.getCurrentFileName(), fileNames.last());
+    testZip.close();
+    plainZip.close();
+    removeTestFiles(fileNames);
+    curDir.remove(zipName);
+}
+
+void TestQuaZip::nameIndex_data()
+{
+    getFileList_data();
+}
+
+void TestQuaZip::nameIndex()
+{
+    QFETCH(QString, zipName);
+    QFETCH(QStringList, fileNames);
+    QDir curDir;
+    if (curDir.exists(zipName)) {
+        if (!curDir.remove(zipName))
+            QFAIL("Can't remove zip file");
+    }
+    if (!createTestFiles(fileNames)) {
+        QFAIL("Can't create test file");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    QuaZip testZip(zipName);
+    testZip.setNameIndexEnabled(true);
+    QVERIFY(testZip.isNameIndexEnabled());
+    QVERIFY(testZip.open(QuaZip::mdUnzip));
+    // walk backwards so that nothing is found by a forward scan by accident
+    for (int i = fileNames.size() - 1; i >= 0; --i) {
+        const QString &fileName = fileNames.at(i);
+        QVERIFY(testZip.setCurrentFile(fileName, QuaZip::csSensitive));
+        QCOMPARE(testZip.getCurrentFileName(), fileName);
+        QVERIFY(testZip.setCurrentFile(fileName.toUpper(), QuaZip::csInsensitive));
+        QCOMPARE(testZip.getCurrentFileName(), fileName);
+        if (fileName.toUpper() != fileName) {
+            QVERIFY(!testZip.setCurrentFile(fileName.toUpper(), QuaZip::csSensitive));
+            QVERIFY(!testZip.hasCurrentFile());
+            QCOMPARE(testZip.getZipError(), UNZ_OK);
+        }
+    }
+    QVERIFY(!testZip.setCurrentFile("nonexistent.txt"));
+    QCOMPARE(testZip.getZipError(), UNZ_OK);
+    testZip.close();
+    removeTestFiles(fileNames);
+    curDir.remove(zipName);
+}
+
+void TestQuaZip::nameIndexNonUtf8()
+{
+    // CP437 names, as old DOS and Windows archivers write them
+    QString zipName = "nameIndexNonUtf8.zip";
+    QDir curDir;
+    curDir.remove(zipName);
+    QuaZip creator(zipName);
+    QVERIFY(creator.open(QuaZip::mdCreate));
+    const char *rawNames[] = {"caf\x82.txt", "na\x8bve.txt", "plain.txt"};
+    for (const char *rawName : rawNames) {
+        QCOMPARE(zipOpenNewFileInZip(creator.getZipFile(), rawName, nullptr,
+                                     nullptr, 0, nullptr, 0, nullptr, 0, 0),
+                 ZIP_OK);
+        QCOMPARE(zipCloseFileInZip(creator.getZipFile()), ZIP_OK);
+    }
+    creator.close();
+    QCOMPARE(creator.getZipError(), ZIP_OK);
+    QuaZip plainZip(zipName);
+    QVERIFY(plainZip.open(QuaZip::mdUnzip));
+    QuaZip testZip(zipName);
+    testZip.setNameIndexEnabled(true);
+    QVERIFY(testZip.open(QuaZip::mdUnzip));
+    const QStringList fileNames = plainZip.getFileNameList();
+    QCOMPARE(fileNames.size(), 3);
+    QCOMPARE(testZip.getFileNameList(), fileNames);
+    // the names are found as they are listed, with or without the index
+    for (int i = fileNames.size() - 1; i >= 0; --i) {
+        const QString &fileName = fileNames.at(i);
+        QVERIFY(plainZip.setCurrentFile(fileName, QuaZip::csSensitive));
+        QVERIFY(testZip.setCurrentFile(fileName, QuaZip::csSensitive));
+        QCOMPARE(testZip.getCurrentFileName(), fileName);
+        QVERIFY(testZip.setCurrentFile(fileName.toUpper(), QuaZip::csInsensitive));
+        QCOMPARE(testZip.getCurrentFileName(), fileName);
+    }
+    testZip.close();
+    plainZip.close();
+    curDir.remove(zipName);
+}
+
+void TestQuaZip::catalogFile()
+{
+    QString zipName = "catalogFile.zip";
+    QString catalogName = "catalogFile.qzcat";
+    QStringList fileNames;
+    fileNames << "test0.txt" << "testdir1/test1.txt" << "testdir2/test2.txt";
+    QDir curDir;
+    curDir.remove(zipName);
+    curDir.remove(catalogName);
+    if (!createTestFiles(fileNames)) {
+        QFAIL("Can't create test file");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    // the first open writes the catalog file
+    {
+        QuaZip testZip(zipName);
+        testZip.setNameIndexEnabled(true);
+        testZip.setCatalogFileName(catalogName);
+        QCOMPARE(testZip.getCatalogFileName(), catalogName);
+        QVERIFY(testZip.open(QuaZip::mdUnzip));
+        QCOMPARE(testZip.getFileNameList(), fileNames);
+    }
+    QVERIFY(QFileInfo(catalogName).size() > 0);
+    QFile catalogFile(catalogName);
+    QVERIFY(catalogFile.open(QIODevice::ReadOnly));
+    QByteArray saved = catalogFile.readAll();
+    catalogFile.close();
+    // the second one loads it
+    {
+        QuaZip testZip(zipName);
+        testZip.setNameIndexEnabled(true);
+        testZip.setCatalogFileName(catalogName);
+        QVERIFY(testZip.open(QuaZip::mdUnzip));
+        QCOMPARE(testZip.getEntriesCount(), static_cast<int>(fileNames.size()));
+        QCOMPARE(testZip.getFileNameList(), fileNames);
+        QCOMPARE(QuaZipDir(&testZip, "testdir2").entryList(),
+                 QStringList() << "test2.txt");
+        for (const QString &fileName : fileNames) {
+            QVERIFY(testZip.setCurrentFile(fileName));
+            QCOMPARE(testZip.getCurrentFileName(), fileName);
+            QuaZipFile zipFile(&testZip);
+            QVERIFY(zipFile.open(QIODevice::ReadOnly));
+            QFile original("tmp/" + fileName);
+            QVERIFY(original.open(QIODevice::ReadOnly));
+            QCOMPARE(zipFile.readAll(), original.readAll());
+        }
+    }
+    QVERIFY(catalogFile.open(QIODevice::ReadOnly));
+    QCOMPARE(catalogFile.readAll(), saved);
+    catalogFile.close();
+    // a stale catalog is replaced
+    QStringList newFileNames = fileNames;
+    newFileNames << "testdir3/test3.txt";
+    if (!createTestFiles(newFileNames)) {
+        QFAIL("Can't create test file");
+    }
+    curDir.remove(zipName);
+    if (!createTestArchive(zipName, newFileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    {
+        QuaZip testZip(zipName);
+        testZip.setCatalogEnabled(true);
+        testZip.setCatalogFileName(catalogName);
+        QVERIFY(testZip.open(QuaZip::mdUnzip));
+        QCOMPARE(testZip.getFileNameList(), newFileNames);
+    }
+    QVERIFY(catalogFile.open(QIODevice::ReadOnly));
+    QVERIFY(catalogFile.readAll() != saved);
+    catalogFile.close();
+    // so is a corrupt one
+    QVERIFY(catalogFile.open(QIODevice::WriteOnly));
+    catalogFile.write("garbage");
+    catalogFile.close();
+    {
+        QuaZip testZip(zipName);
+        testZip.setCatalogEnabled(true);
+        testZip.setCatalogFileName(catalogName);
+        QVERIFY(testZip.open(QuaZip::mdUnzip));
+        QCOMPARE(testZip.getFileNameList(), newFileNames);
+    }
+    QVERIFY(QFileInfo(catalogName).size() > 7);
+    // and the same through a device
+    QBuffer catalogBuffer;
+    QVERIFY(catalogBuffer.open(QIODevice::ReadWrite));
+    for (int i = 0; i < 2; ++i) {
+        QuaZip testZip(zipName);
+        testZip.setNameIndexEnabled(true);
+        testZip.setCatalogDevice(&catalogBuffer);
+        QCOMPARE(testZip.getCatalogDevice(), &catalogBuffer);
+        QVERIFY(testZip.open(QuaZip::mdUnzip));
+        QVERIFY(catalogBuffer.size() > 0);
+        QCOMPARE(testZip.getFileNameList(), newFileNames);
+        QVERIFY(testZip.setCurrentFile("TESTDIR3/TEST3.TXT", QuaZip::csInsensitive));
+        QCOMPARE(testZip.getCurrentFileName(), QString("testdir3/test3.txt"));
+    }
+    removeTestFiles(newFileNames);
+    curDir.remove(zipName);
+    curDir.remove(catalogName);
+}
+
+void TestQuaZip::memoryMapping_data()
+{
+    getFileList_data();
+}
+
+void TestQuaZip::memoryMapping()
+{
+    QFETCH(QString, zipName);
+    QFETCH(QStringList, fileNames);
+    QDir curDir;
+    if (curDir.exists(zipName)) {
+        if (!curDir.remove(zipName))
+            QFAIL("Can't remove zip file");
+    }
+    if (!createTestFiles(fileNames)) {
+        QFAIL("Can't create test file");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    QFile zipFileDevice(zipName);
+    QVERIFY(zipFileDevice.open(QIODevice::ReadOnly));
+    QBuffer zipBuffer;
+    zipBuffer.setData(zipFileDevice.readAll());
+    zipFileDevice.close();
+    // a file is mapped, a buffer is read as usual
+    QuaZip fileZip(zipName);
+    QuaZip bufferZip(&zipBuffer);
+    QuaZip *zips[] = {&fileZip, &bufferZip};
+    for (QuaZip *testZip : zips) {
+        QVERIFY(!testZip->isMemoryMappingEnabled());
+        testZip->setMemoryMappingEnabled(true);
+        QVERIFY(testZip->isMemoryMappingEnabled());
+        QVERIFY(testZip->open(QuaZip::mdUnzip));
+        QCOMPARE(testZip->getFileNameList(), fileNames);
+        for (const QString &fileName : fileNames) {
+            QVERIFY(testZip->setCurrentFile(fileName));
+            QuaZipFile zipFile(testZip);
+            QVERIFY(zipFile.open(QIODevice::ReadOnly));
+            QFile original("tmp/" + fileName);
+            QVERIFY(original.open(QIODevice::ReadOnly));
+            QCOMPARE(zipFile.readAll(), original.readAll());
+            zipFile.close();
+            QCOMPARE(zipFile.getZipError(), UNZ_OK);
+        }
+        QCOMPARE(testZip->getComment(), QString("This is the test archive"));
+        testZip->close();
+        QCOMPARE(testZip->getZipError(), UNZ_OK);
+    }
+    removeTestFiles(fileNames);
+    curDir.remove(zipName);
+}
+
+void TestQuaZip::positionalRead()
+{
+    QString zipName = "positionalRead.zip";
+    QStringList fileNames;
+    for (int i = 0; i < 16; ++i)
+        fileNames << QString("test%1.txt").arg(i);
+    QDir curDir;
+    curDir.remove(zipName);
+    if (!createTestFiles(fileNames, 100000)) {
+        QFAIL("Can't create test file");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    QHash<QString, QByteArray> contents;
+    for (const QString &fileName : fileNames) {
+        QFile original("tmp/" + fileName);
+        QVERIFY(original.open(QIODevice::ReadOnly));
+        contents[fileName] = original.readAll();
+    }
+    QFile zipFileDevice(zipName);
+    QVERIFY(zipFileDevice.open(QIODevice::ReadOnly));
+    QBuffer zipBuffer;
+    zipBuffer.setData(zipFileDevice.readAll());
+    QVERIFY(zipBuffer.open(QIODevice::ReadOnly));
+    // a file is read with pread(), a buffer under a lock
+    QIODevice *devices[] = {&zipFileDevice, &zipBuffer};
+    for (QIODevice *device : devices) {
+        const int threadCount = 4;
+        QList<QuaZip*> zips;
+        QList<QThread*> threads;
+        QList<bool> results(threadCount, false);
+        for (int t = 0; t < threadCount; ++t) {
+            QuaZip *zip = new QuaZip(device);
+            zip->setAutoClose(false);
+            QVERIFY(!zip->isPositionalReadEnabled());
+            zip->setPositionalReadEnabled(true);
+            QVERIFY(zip->isPositionalReadEnabled());
+            QVERIFY(zip->open(QuaZip::mdUnzip));
+            zips << zip;
+            threads << QThread::create([zip, t, &fileNames, &contents, &results]() {
+                bool ok = true;
+                // start at different files to make the threads overlap
+                for (int i = 0; i < fileNames.size(); ++i) {
+                    const QString &fileName = fileNames.at((i + t * 4) % fileNames.size());
+                    QuaZipFile zipFile(zip);
+                    ok = ok && zip->setCurrentFile(fileName)
+                            && zipFile.open(QIODevice::ReadOnly)
+                            && zipFile.readAll() == contents.value(fileName);
+                    zipFile.close();
+                    ok = ok && zipFile.getZipError() == UNZ_OK;
+                }
+                results[t] = ok;
+            });
+        }
+        for (QThread *thread : threads)
+            thread->start();
+        for (QThread *thread : threads) {
+            QVERIFY(thread->wait());
+            delete thread;
+        }
+        for (QuaZip *zip : zips) {
+            zip->close();
+            QCOMPARE(zip->getZipError(), UNZ_OK);
+            delete zip;
+        }
+        QVERIFY(device->isOpen());
+        QCOMPARE(results, QList<bool>(threadCount, true));
+    }
+    zipFileDevice.close();
+    removeTestFiles(fileNames);
+    curDir.remove(zipName);
+}
+
+void TestQuaZip::readAhead_data()
+{
+    QTest::addColumn<int>("readAheadSize");
+    QTest::addColumn<bool>("prefetch");
+    QTest::newRow("tiny") << 100 << false;
+    QTest::newRow("small") << 64 * 1024 << false;
+    QTest::newRow("large") << 1024 * 1024 << false;
+    QTest::newRow("small prefetched") << 64 * 1024 << true;
+    QTest::newRow("large prefetched") << 1024 * 1024 << true;
+}
+
+void TestQuaZip::readAhead()
+{
+    QFETCH(int, readAheadSize);
+    QFETCH(bool, prefetch);
+    QString zipName = "readAhead.zip";
+    QStringList fileNames;
+    for (int i = 0; i < 32; ++i)
+        fileNames << QString("test%1.txt").arg(i);
+    QDir curDir;
+    curDir.remove(zipName);
+    if (!createTestFiles(fileNames, 50000)) {
+        QFAIL("Can't create test file");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    QHash<QString, QByteArray> contents;
+    for (const QString &fileName : fileNames) {
+        QFile original("tmp/" + fileName);
+        QVERIFY(original.open(QIODevice::ReadOnly));
+        contents[fileName] = original.readAll();
+    }
+    QFile zipFileDevice(zipName);
+    QVERIFY(zipFileDevice.open(QIODevice::ReadOnly));
+    QBuffer zipBuffer;
+    zipBuffer.setData(zipFileDevice.readAll());
+    zipFileDevice.close();
+    // a file has a handle to prefetch with, a buffer doesn't
+    QuaZip byName(zipName);
+    QuaZip byBuffer(&zipBuffer);
+    QuaZip *zips[] = {&byName, &byBuffer};
+    for (QuaZip *zip : zips) {
+        QCOMPARE(zip->getReadAheadSize(), 0);
+        QVERIFY(!zip->isPrefetchEnabled());
+        zip->setReadAheadSize(readAheadSize);
+        zip->setPrefetchEnabled(prefetch);
+        QCOMPARE(zip->getReadAheadSize(), readAheadSize);
+        QCOMPARE(zip->isPrefetchEnabled(), prefetch);
+        QVERIFY(zip->open(QuaZip::mdUnzip));
+        QStringList extracted;
+        for (bool more = zip->goToFirstFile(); more; more = zip->goToNextFile()) {
+            QuaZipFile zipFile(zip);
+            QVERIFY(zipFile.open(QIODevice::ReadOnly));
+            QCOMPARE(zipFile.readAll(), contents.value(zipFile.getActualFileName()));
+            zipFile.close();
+            QCOMPARE(zipFile.getZipError(), UNZ_OK);
+            extracted << zip->getCurrentFileName();
+        }
+        QCOMPARE(extracted, fileNames);
+        // backwards, so that every window is read in vain
+        for (int i = fileNames.size() - 1; i >= 0; --i) {
+            QVERIFY(zip->setCurrentFile(fileNames.at(i)));
+            QuaZipFile zipFile(zip);
+            QVERIFY(zipFile.open(QIODevice::ReadOnly));
+            QCOMPARE(zipFile.read(1000), contents.value(fileNames.at(i)).left(1000));
+            zipFile.close();
+        }
+        zip->close();
+        QCOMPARE(zip->getZipError(), UNZ_OK);
+    }
+    removeTestFiles(fileNames);
+    curDir.remove(zipName);
+}
+
+void TestQuaZip::openShared()
+{
+    QString zipName = "openShared.zip";
+    QStringList fileNames;
+    for (int i = 0; i < 16; ++i)
+        fileNames << QString("test%1.txt").arg(i);
+    QDir curDir;
+    curDir.remove(zipName);
+    if (!createTestFiles(fileNames, 100000)) {
+        QFAIL("Can't create test file");
+    }
+    if (!createTestArchive(zipName, fileNames)) {
+        QFAIL("Can't create test archive");
+    }
+    QHash<QString, QByteArray> contents;
+    for (const QString &fileName : fileNames) {
+        QFile original("tmp/" + fileName);
+        QVERIFY(original.open(QIODevice::ReadOnly));
+        contents[fileName] = original.readAll();
+    }
+    QuaZip mainZip(zipName);
+    QuaZip sharedZip;
+    QVERIFY(!sharedZip.openShared(mainZip));
+    mainZip.setNameIndexEnabled(true);
+    QVERIFY(mainZip.open(QuaZip::mdUnzip));
+    QVERIFY(sharedZip.openShared(mainZip));
+    QVERIFY(sharedZip.isOpen());
+    QCOMPARE(sharedZip.getMode(), QuaZip::mdUnzip);
+    QCOMPARE(sharedZip.getIoDevice(), mainZip.getIoDevice());
+    QCOMPARE(sharedZip.getEntriesCount(), mainZip.getEntriesCount());
+    QCOMPARE(sharedZip.getFileNameList(), fileNames);
+    // the current files are independent
+    QVERIFY(mainZip.setCurrentFile(fileNames.first()));
+    QVERIFY(sharedZip.setCurrentFile(fileNames.last()));
+    QCOMPARE(mainZip.getCurrentFileName(), fileNames.first());
+    QCOMPARE(sharedZip.getCurrentFileName(), fileNames.last());
+    sharedZip.close();
+    QCOMPARE(sharedZip.getZipError(), UNZ_OK);
+    QVERIFY(mainZip.getIoDevice()->isOpen());
+    // and so are the readers, even in different threads
+    const int threadCount = 8;
+    QList<QuaZip*> zips;
+    QList<QThread*> threads;
+    QList<bool> results(threadCount, false);
+    for (int t = 0; t < threadCount; ++t) {
+        QuaZip *zip = new QuaZip();
+        QVERIFY(zip->openShared(mainZip));
+        zips << zip;
+        threads << QThread::create([zip, t, &fileNames, &contents, &results]() {
+            bool ok = true;
+            for (int i = 0; ok && i < fileNames.size(); ++i) {
+                const QString &fileName = fileNames.at((i + t * 2) % fileNames.size());
+                QuaZipFile zipFile(zip);
+                ok = zip->setCurrentFile(fileName, QuaZip::csInsensitive)
+                        && zipFile.open(QIODevice::ReadOnly)
+                        && zipFile.readAll() == contents.value(fileName);
+                zipFile.close();
+                ok = ok && zipFile.getZipError() == UNZ_OK;
+            }
+            results[t] = ok;
+        });
+    }
+    for (QThread *thread : threads)
+        thread->start();
+    // the main handle stays usable meanwhile
+    QVERIFY(mainZip.setCurrentFile(fileNames.at(5)));
+    QuaZipFile mainFile(&mainZip);
+    QVERIFY(mainFile.open(QIODevice::ReadOnly));
+    QCOMPARE(mainFile.readAll(), contents.value(fileNames.at(5)));
+    mainFile.close();
+    for (QThread *thread : threads) {
+        QVERIFY(thread->wait());
+        delete thread;
+    }
+    for (QuaZip *zip : zips) {
+        zip->close();
+        QCOMPARE(zip->getZipError(), UNZ_OK);
+        // the device of mainZip must not be used after it is closed
+        QCOMPARE(zip->getIoDevice(), static_cast<QIODevice*>(nullptr));
+        delete zip;
+    }
+    QCOMPARE(results, QList<bool>(threadCount, true));
+    mainZip.close();
+    QCOMPARE(mainZip.getZipError(), UNZ_OK);
+    removeTestFiles(fileNames);
+    curDir.remove(zipName);
+}
+
 void TestQuaZip::add_data()
 {
     QTest::addColumn<QString>("zipName");
@@ -165,6 +715,119 @@ void TestQuaZip::add()
     curDir.remove(zipName);
 }
 
+void TestQuaZip::expectedEntryCount()
+{
+    QBuffer buffer;
+    QuaZip zip(&buffer);
+    QCOMPARE(zip.getExpectedEntryCount(), static_cast<qint64>(0));
+    // more entries than expected, so that the directory grows past the hint
+    zip.setExpectedEntryCount(1000);
+    QCOMPARE(zip.getExpectedEntryCount(), static_cast<qint64>(1000));
+    QVERIFY(zip.open(QuaZip::mdCreate));
+    QStringList names;
+    for (int i = 0; i < 3000; ++i) {
+        const QString name = QString("dir/file%1.txt").arg(i);
+        QuaZipFile file(&zip);
+        QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo(name)));
+        QCOMPARE(file.write(name.toUtf8()), static_cast<qint64>(name.size()));
+        file.close();
+        QCOMPARE(file.getZipError(), ZIP_OK);
+        names << name;
+    }
+    zip.setComment("comment");
+    zip.close();
+    QCOMPARE(zip.getZipError(), ZIP_OK);
+    // the loaded directory is kept in the same buffer
+    zip.setExpectedEntryCount(1);
+    QVERIFY(zip.open(QuaZip::mdAdd));
+    {
+        QuaZipFile file(&zip);
+        QVERIFY(file.open(QIODevice::WriteOnly, QuaZipNewInfo("added.txt")));
+        file.write("added");
+        file.close();
+    }
+    zip.close();
+    QCOMPARE(zip.getZipError(), ZIP_OK);
+    names << "added.txt";
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QCOMPARE(zip.getEntriesCount(), names.size());
+    QCOMPARE(zip.getFileNameList(), names);
+    QCOMPARE(zip.getComment(), QString("comment"));
+    QVERIFY(zip.setCurrentFile("dir/file2999.txt"));
+    QuaZipFile file(&zip);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("dir/file2999.txt"));
+    file.close();
+    zip.close();
+}
+
+void TestQuaZip::writeBuffer_data()
+{
+    QTest::addColumn<int>("bufferSize");
+    QTest::addColumn<bool>("dataDescriptor");
+    QTest::newRow("tiny") << 7 << true;
+    QTest::newRow("small") << 100 << true;
+    QTest::newRow("default") << 1024 * 1024 << true;
+    QTest::newRow("no descriptor") << 4096 << false;
+}
+
+void TestQuaZip::writeBuffer()
+{
+    QFETCH(int, bufferSize);
+    QFETCH(bool, dataDescriptor);
+    const QDateTime dateTime(QDate(2020, 1, 2), QTime(3, 4, 5));
+    QByteArray bigData(3 * 1024 * 1024, 'x');
+    for (int i = 0; i < bigData.size(); i += 97)
+        bigData[i] = static_cast<char>(i);
+    // the same archive, written with and without the buffer
+    QByteArray archives[2];
+    for (int buffered = 0; buffered < 2; ++buffered) {
+        QBuffer buffer(&archives[buffered]);
+        QuaZip zip(&buffer);
+        QCOMPARE(zip.getWriteBufferSize(), 0);
+        if (buffered) {
+            zip.setWriteBufferSize(bufferSize);
+            QCOMPARE(zip.getWriteBufferSize(), bufferSize);
+        }
+        zip.setDataDescriptorWritingEnabled(dataDescriptor);
+        QVERIFY(zip.open(QuaZip::mdCreate));
+        for (int i = 0; i < 1000; ++i) {
+            QuaZipNewInfo info(QString("dir/file%1.txt").arg(i));
+            info.dateTime = dateTime;
+            QuaZipFile file(&zip);
+            QVERIFY(file.open(QIODevice::WriteOnly, info, nullptr, 0,
+                              i % 2 == 0 ? 0 : Z_DEFLATED));
+            file.write(QByteArray::number(i).repeated(i % 10));
+            file.close();
+            QCOMPARE(file.getZipError(), ZIP_OK);
+        }
+        QuaZipNewInfo info("big.bin");
+        info.dateTime = dateTime;
+        QuaZipFile file(&zip);
+        QVERIFY(file.open(QIODevice::WriteOnly, info, nullptr, 0, 0));
+        QCOMPARE(file.write(bigData), static_cast<qint64>(bigData.size()));
+        file.close();
+        QCOMPARE(file.getZipError(), ZIP_OK);
+        zip.close();
+        QCOMPARE(zip.getZipError(), ZIP_OK);
+    }
+    QCOMPARE(archives[1], archives[0]);
+    QBuffer buffer(&archives[1]);
+    QuaZip zip(&buffer);
+    QVERIFY(zip.open(QuaZip::mdUnzip));
+    QCOMPARE(zip.getEntriesCount(), 1001);
+    QVERIFY(zip.setCurrentFile("dir/file999.txt"));
+    QuaZipFile file(&zip);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), QByteArray("999").repeated(9));
+    file.close();
+    QVERIFY(zip.setCurrentFile("big.bin"));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), bigData);
+    file.close();
+    zip.close();
+}
+
 void TestQuaZip::setFileNameCodec_data()
 {
     QTest::addColumn<QString>("zipName");
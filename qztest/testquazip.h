@@ -36,8 +36,23 @@ class TestQuaZip: public QObject {
 private slots:
     void getFileList_data();
     void getFileList();
+    void catalog_data();
+    void catalog();
+    void nameIndex_data();
+    void nameIndex();
+    void nameIndexNonUtf8();
+    void catalogFile();
+    void memoryMapping_data();
+    void memoryMapping();
+    void positionalRead();
+    void readAhead_data();
+    void readAhead();
+    void openShared();
     void add_data();
     void add();
+    void expectedEntryCount();
+    void writeBuffer_data();
+    void writeBuffer();
     void setFileNameCodec_data();
     void setFileNameCodec();
     void setOsCode_data();
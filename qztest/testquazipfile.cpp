@@ -718,3 +718,285 @@ void TestQuaZipFile::largeFile()
     fakeLargeZip.close();
     curDir.remove("tmp/large.zip");
 }
+
+void TestQuaZipFile::mappedData()
+{
+    QString zipName = "mappedData.zip";
+    QStringList fileNames;
+    fileNames << "stored.txt" << "deflated.txt";
+    QVERIFY(createTestFiles(fileNames));
+    QByteArray contents[2];
+    {
+        QuaZip testZip(zipName);
+        QVERIFY(testZip.open(QuaZip::mdCreate));
+        for (int i = 0; i < fileNames.size(); ++i) {
+            QFile original("tmp/" + fileNames.at(i));
+            QVERIFY(original.open(QIODevice::ReadOnly));
+            contents[i] = original.readAll();
+            QuaZipFile zipFile(&testZip);
+            QVERIFY(zipFile.open(QIODevice::WriteOnly,
+                                 QuaZipNewInfo(fileNames.at(i)), nullptr, 0,
+                                 i == 0 ? 0 : Z_DEFLATED));
+            QCOMPARE(zipFile.write(contents[i]), static_cast<qint64>(contents[i].size()));
+            zipFile.close();
+        }
+        testZip.close();
+    }
+    QuaZip testZip(zipName);
+    testZip.setMemoryMappingEnabled(true);
+    QVERIFY(testZip.open(QuaZip::mdUnzip));
+    QuaZipFile zipFile(&testZip);
+    // stored data is available as is, regardless of the position
+    QVERIFY(testZip.setCurrentFile(fileNames.at(0)));
+    QVERIFY(zipFile.open(QIODevice::ReadOnly));
+    QCOMPARE(zipFile.mappedData(), contents[0]);
+    QCOMPARE(zipFile.read(3), contents[0].left(3));
+    QCOMPARE(zipFile.mappedData(), contents[0]);
+    QCOMPARE(zipFile.readAll(), contents[0].mid(3));
+    zipFile.close();
+    QCOMPARE(zipFile.getZipError(), UNZ_OK);
+    // compressed data is only available in raw mode
+    QVERIFY(testZip.setCurrentFile(fileNames.at(1)));
+    QVERIFY(zipFile.open(QIODevice::ReadOnly));
+    QVERIFY(zipFile.mappedData().isNull());
+    QCOMPARE(zipFile.getZipError(), UNZ_OK);
+    QCOMPARE(zipFile.readAll(), contents[1]);
+    zipFile.close();
+    QCOMPARE(zipFile.getZipError(), UNZ_OK);
+    int method = 0;
+    QVERIFY(zipFile.open(QIODevice::ReadOnly, &method, nullptr, true));
+    QCOMPARE(method, static_cast<int>(Z_DEFLATED));
+    QByteArray raw = zipFile.mappedData();
+    QCOMPARE(static_cast<qint64>(raw.size()), zipFile.csize());
+    QCOMPARE(raw, zipFile.readAll());
+    zipFile.close();
+    testZip.close();
+    // and nothing is available without the mapping
+    QuaZipFile unmappedFile(zipName, fileNames.at(0));
+    QVERIFY(unmappedFile.open(QIODevice::ReadOnly));
+    QVERIFY(unmappedFile.mappedData().isNull());
+    unmappedFile.close();
+    removeTestFiles(fileNames);
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::compressionThreads()
+{
+    QString zipName = "compressionThreads.zip";
+    // compressible, but not too much, and not a whole number of blocks
+    QByteArray contents;
+    for (int i = 0; contents.size() < 1000000; ++i)
+        contents += QByteArray::number(i * 7919 % 10007) + (i % 13 ? " " : "\n");
+    {
+        QuaZip testZip(zipName);
+        QVERIFY(testZip.open(QuaZip::mdCreate));
+        QuaZipFile zipFile(&testZip);
+        zipFile.setCompressionThreadCount(4);
+        zipFile.setCompressionBlockSize(64 * 1024);
+        QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("blocks.txt")));
+        // in odd pieces, crossing the block boundaries
+        for (int pos = 0; pos < contents.size(); pos += 10007) {
+            QByteArray piece = contents.mid(pos, 10007);
+            QCOMPARE(zipFile.write(piece), static_cast<qint64>(piece.size()));
+        }
+        QCOMPARE(zipFile.pos(), static_cast<qint64>(contents.size()));
+        zipFile.close();
+        QCOMPARE(zipFile.getZipError(), ZIP_OK);
+        // an empty file still needs a valid stream
+        QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("empty.txt")));
+        zipFile.close();
+        QCOMPARE(zipFile.getZipError(), ZIP_OK);
+        testZip.close();
+        QCOMPARE(testZip.getZipError(), ZIP_OK);
+    }
+    QuaZipFile blocksFile(zipName, "blocks.txt");
+    QVERIFY(blocksFile.open(QIODevice::ReadOnly));
+    QuaZipFileInfo64 info;
+    QVERIFY(blocksFile.getFileInfo(&info));
+    QCOMPARE(info.method, static_cast<quint16>(Z_DEFLATED));
+    QCOMPARE(info.uncompressedSize, static_cast<quint64>(contents.size()));
+    QVERIFY(info.compressedSize < info.uncompressedSize / 2);
+    QCOMPARE(blocksFile.readAll(), contents);
+    blocksFile.close();
+    // the CRC is checked on close
+    QCOMPARE(blocksFile.getZipError(), UNZ_OK);
+    QuaZipFile emptyFile(zipName, "empty.txt");
+    QVERIFY(emptyFile.open(QIODevice::ReadOnly));
+    QVERIFY(emptyFile.readAll().isEmpty());
+    emptyFile.close();
+    QCOMPARE(emptyFile.getZipError(), UNZ_OK);
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::seekIndex()
+{
+    QString zipName = "seekIndex.zip";
+    QByteArray contents;
+    for (int i = 0; contents.size() < 2000000; ++i)
+        contents += QByteArray::number(i * 7919 % 10007) + (i % 13 ? " " : "\n");
+    {
+        QuaZip testZip(zipName);
+        QVERIFY(testZip.open(QuaZip::mdCreate));
+        QuaZipFile zipFile(&testZip);
+        QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("deflated.txt")));
+        QCOMPARE(zipFile.write(contents), static_cast<qint64>(contents.size()));
+        zipFile.close();
+        QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("stored.txt"),
+                    nullptr, 0, 0, 0));
+        QCOMPARE(zipFile.write(contents), static_cast<qint64>(contents.size()));
+        zipFile.close();
+        testZip.close();
+        QCOMPARE(testZip.getZipError(), ZIP_OK);
+    }
+    const qint64 positions[] = {1500000, 10, 1999999, 700000, 700001, 0, 65536};
+    QByteArray index;
+    {
+        QuaZipFile zipFile(zipName, "deflated.txt");
+        zipFile.setSeekIndexInterval(64 * 1024);
+        QVERIFY(zipFile.open(QIODevice::ReadOnly));
+        // some data in the QIODevice buffer
+        QCOMPARE(zipFile.read(100), contents.left(100));
+        QVERIFY(zipFile.buildSeekIndex());
+        QCOMPARE(zipFile.pos(), static_cast<qint64>(100));
+        QCOMPARE(zipFile.read(100), contents.mid(100, 100));
+        for (qint64 pos : positions) {
+            QVERIFY(zipFile.seek(pos));
+            QCOMPARE(zipFile.pos(), pos);
+            QCOMPARE(zipFile.read(1000), contents.mid(pos, 1000));
+        }
+        QVERIFY(!zipFile.seek(contents.size() + 1));
+        index = zipFile.getSeekIndex();
+        QVERIFY(!index.isEmpty());
+        QVERIFY(zipFile.seek(0));
+        QCOMPARE(zipFile.readAll(), contents);
+        zipFile.close();
+        // seeking back to the start makes the CRC checked again
+        QCOMPARE(zipFile.getZipError(), UNZ_OK);
+    }
+    {
+        // the saved index without recording anything
+        QuaZipFile zipFile(zipName, "deflated.txt");
+        QVERIFY(zipFile.open(QIODevice::ReadOnly));
+        QVERIFY(!zipFile.setSeekIndex(index.left(index.size() / 2)));
+        QVERIFY(zipFile.setSeekIndex(index));
+        QCOMPARE(zipFile.getSeekIndex(), index);
+        for (qint64 pos : positions) {
+            QVERIFY(zipFile.seek(pos));
+            QCOMPARE(zipFile.read(1000), contents.mid(pos, 1000));
+        }
+        zipFile.close();
+    }
+    {
+        QuaZipFile zipFile(zipName, "stored.txt");
+        QVERIFY(zipFile.open(QIODevice::ReadOnly));
+        QVERIFY(!zipFile.setSeekIndex(index));
+        for (qint64 pos : positions) {
+            QVERIFY(zipFile.seek(pos));
+            QCOMPARE(zipFile.pos(), pos);
+            QCOMPARE(zipFile.read(1000), contents.mid(pos, 1000));
+        }
+        QVERIFY(zipFile.seek(0));
+        QCOMPARE(zipFile.readAll(), contents);
+        zipFile.close();
+        QCOMPARE(zipFile.getZipError(), UNZ_OK);
+    }
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::restartPoints()
+{
+    QString zipName = "restartPoints.zip";
+    QByteArray contents;
+    for (int i = 0; contents.size() < 1000000; ++i)
+        contents += QByteArray::number(i * 7919 % 10007) + (i % 13 ? " " : "\n");
+    {
+        QuaZip testZip(zipName);
+        QVERIFY(testZip.open(QuaZip::mdCreate));
+        QuaZipFile zipFile(&testZip);
+        zipFile.setRestartPointInterval(64 * 1024);
+        QVERIFY(zipFile.open(QIODevice::WriteOnly, QuaZipNewInfo("restart.txt")));
+        QCOMPARE(zipFile.write(contents), static_cast<qint64>(contents.size()));
+        zipFile.close();
+        QCOMPARE(zipFile.getZipError(), ZIP_OK);
+        testZip.close();
+        QCOMPARE(testZip.getZipError(), ZIP_OK);
+    }
+    QuaZipFile zipFile(zipName, "restart.txt");
+    QVERIFY(zipFile.open(QIODevice::ReadOnly));
+    QuaZipFileInfo64 info;
+    QVERIFY(zipFile.getFileInfo(&info));
+    QCOMPARE(info.method, static_cast<quint16>(Z_DEFLATED));
+    QVERIFY(QuaZipFileInfo64::parseExtraField(info.extra)
+            .contains(QUAZIP_EXTRA_RESTART_POINTS_MAGIC));
+    // the points are there right away, with no seek index interval set
+    QVERIFY(!zipFile.getSeekIndex().isEmpty());
+    const qint64 positions[] = {900000, 65535, 65536, 131073, 0, 999999};
+    for (qint64 pos : positions) {
+        QVERIFY(zipFile.seek(pos));
+        QCOMPARE(zipFile.pos(), pos);
+        QCOMPARE(zipFile.read(1000), contents.mid(pos, 1000));
+    }
+    QVERIFY(zipFile.seek(0));
+    QCOMPARE(zipFile.readAll(), contents);
+    zipFile.close();
+    QCOMPARE(zipFile.getZipError(), UNZ_OK);
+    QDir().remove(zipName);
+}
+
+void TestQuaZipFile::copyToFrom()
+{
+    QString zipName = "copyToFrom.zip";
+    QDir curDir;
+    QVERIFY(curDir.mkpath("tmp"));
+    QByteArray contents;
+    for (int i = 0; contents.size() < 3000000; ++i)
+        contents += QByteArray::number(i * 7919 % 10007) + (i % 13 ? " " : "\n");
+    QFile source("tmp/copyToFrom.txt");
+    QVERIFY(source.open(QIODevice::WriteOnly));
+    QCOMPARE(source.write(contents), static_cast<qint64>(contents.size()));
+    source.close();
+    {
+        QuaZip testZip(zipName);
+        QVERIFY(testZip.open(QuaZip::mdCreate));
+        QuaZipFile zipFile(&testZip);
+        for (int method : {0, Z_DEFLATED}) {
+            QVERIFY(source.open(QIODevice::ReadOnly));
+            QVERIFY(zipFile.open(QIODevice::WriteOnly,
+                        QuaZipNewInfo(method == 0 ? "stored.txt" : "deflated.txt"),
+                        nullptr, 0, method));
+            // something buffered before the copy
+            QCOMPARE(zipFile.write(source.read(1000)), static_cast<qint64>(1000));
+            QVERIFY(zipFile.copyFrom(&source));
+            QCOMPARE(zipFile.pos(), static_cast<qint64>(contents.size()));
+            zipFile.close();
+            QCOMPARE(zipFile.getZipError(), ZIP_OK);
+            source.close();
+        }
+        testZip.close();
+        QCOMPARE(testZip.getZipError(), ZIP_OK);
+    }
+    for (const char *name : {"stored.txt", "deflated.txt"}) {
+        for (bool mapped : {false, true}) {
+            QuaZip testZip(zipName);
+            testZip.setMemoryMappingEnabled(mapped);
+            QVERIFY(testZip.open(QuaZip::mdUnzip));
+            QVERIFY(testZip.setCurrentFile(name));
+            QuaZipFile zipFile(&testZip);
+            QVERIFY(zipFile.open(QIODevice::ReadOnly));
+            QFile target("tmp/copyToFrom.out");
+            QVERIFY(target.open(QIODevice::WriteOnly));
+            QCOMPARE(target.write("head"), static_cast<qint64>(4));
+            QVERIFY(zipFile.copyTo(&target));
+            QVERIFY(zipFile.atEnd());
+            zipFile.close();
+            QCOMPARE(zipFile.getZipError(), UNZ_OK);
+            target.close();
+            QVERIFY(target.open(QIODevice::ReadOnly));
+            QVERIFY(target.readAll() == "head" + contents);
+            target.close();
+            QVERIFY(target.remove());
+        }
+    }
+    QVERIFY(source.remove());
+    curDir.remove(zipName);
+}
@@ -50,6 +50,11 @@ private slots:
     void constructorDestructor();
     void setFileAttrs();
     void largeFile();
+    void mappedData();
+    void compressionThreads();
+    void seekIndex();
+    void restartPoints();
+    void copyToFrom();
 };
 
 #endif // QUAZIP_TEST_QUAZIPFILE_H